@@ -37,6 +37,8 @@
 #    __builtin_clzll
 #    __builtin_complex
 #    __builtin_constant_p
+#    __builtin_cpu_init
+#    __builtin_cpu_supports
 #    __builtin_ctz
 #    __builtin_ctzl
 #    __builtin_ctzll
@@ -91,7 +93,7 @@
 #   and this notice are preserved.  This file is offered as-is, without any
 #   warranty.
 
-#serial 3
+#serial 4
 
 AC_DEFUN([AX_GCC_BUILTIN], [
     AS_VAR_PUSHDEF([ac_var], [ax_cv_have_$1])
@@ -113,6 +115,8 @@ AC_DEFUN([AX_GCC_BUILTIN], [
                 [__builtin_clzll], [$1(0)],
                 [__builtin_complex], [$1(0.0, 0.0)],
                 [__builtin_constant_p], [$1(0)],
+                [__builtin_cpu_init], [$1()],
+                [__builtin_cpu_supports], [$1("sse")],
                 [__builtin_ctz], [$1(0)],
                 [__builtin_ctzl], [$1(0)],
                 [__builtin_ctzll], [$1(0)],
@@ -52,6 +52,14 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+#if defined(__x86_64__) && defined(HAVE___BUILTIN_CPU_SUPPORTS)
+#define BITSTR_X86_SIMD 1
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 7))
+#define BITSTR_X86_AVX512 1
+#endif
+#include <immintrin.h>
+#endif
+
 /* word of the bitstring bit is in */
 #define	_bit_word(bit) 		(((bit) >> BITSTR_SHIFT) + BITSTR_OVERHEAD)
 
@@ -144,6 +152,9 @@ strong_alias(bit_fls,		slurm_bit_fls);
 strong_alias(bit_fill_gaps,	slurm_bit_fill_gaps);
 strong_alias(bit_super_set,	slurm_bit_super_set);
 strong_alias(bit_overlap,	slurm_bit_overlap);
+strong_alias(bit_overlap_any,	slurm_bit_overlap_any);
+strong_alias(bit_and_not_count,	slurm_bit_and_not_count);
+strong_alias(bit_and3_count,	slurm_bit_and3_count);
 strong_alias(bit_equal,		slurm_bit_equal);
 strong_alias(bit_copy,		slurm_bit_copy);
 strong_alias(bit_pick_cnt,	slurm_bit_pick_cnt);
@@ -153,6 +164,538 @@ strong_alias(bit_nffs,		slurm_bit_nffs);
 strong_alias(bit_copybits,	slurm_bit_copybits);
 strong_alias(bit_get_bit_num,	slurm_bit_get_bit_num);
 strong_alias(bit_get_pos_num,	slurm_bit_get_pos_num);
+strong_alias(bit_simd_name,	slurm_bit_simd_name);
+
+#ifdef HAVE___BUILTIN_POPCOUNTLL
+#define hweight __builtin_popcountll
+#else
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ * NOTE: This routine borrowed from Linux 4.9 <tools/lib/hweight.c>.
+ */
+static uint64_t
+hweight(uint64_t w)
+{
+        w -= (w >> 1) & 0x5555555555555555ul;
+        w =  (w & 0x3333333333333333ul) + ((w >> 2) & 0x3333333333333333ul);
+        w =  (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0ful;
+        return (w * 0x0101010101010101ul) >> 56;
+}
+#endif
+
+/*
+ * Word kernels used by the whole bitstring operations below. Each operates
+ * on the nwords data words following the BITSTR_OVERHEAD header. On x86_64
+ * the SIMD variants are selected once at run time from the CPU feature flags,
+ * otherwise (or if the CPU lacks them) the portable loops are used.
+ */
+typedef struct {
+	int64_t (*count)(const bitstr_t *w, int64_t nwords);
+	int64_t (*and_count)(const bitstr_t *w1, const bitstr_t *w2,
+			     int64_t nwords);
+	int64_t (*and_not_count)(const bitstr_t *w1, const bitstr_t *w2,
+				 int64_t nwords);
+	int64_t (*and3_count)(const bitstr_t *w1, const bitstr_t *w2,
+			      const bitstr_t *w3, int64_t nwords);
+	int (*any_and)(const bitstr_t *w1, const bitstr_t *w2,
+		       int64_t nwords);
+	void (*and)(bitstr_t *w1, const bitstr_t *w2, int64_t nwords);
+	void (*and_not)(bitstr_t *w1, const bitstr_t *w2, int64_t nwords);
+	void (*or)(bitstr_t *w1, const bitstr_t *w2, int64_t nwords);
+	int (*super_set)(const bitstr_t *w1, const bitstr_t *w2,
+			 int64_t nwords);
+	int64_t (*first_word)(const bitstr_t *w, int64_t nwords);
+	const char *name;
+} bit_word_ops_t;
+
+static int64_t _count_word(const bitstr_t *w, int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += hweight(w[i]);
+	return count;
+}
+
+static int64_t _and_count_word(const bitstr_t *w1, const bitstr_t *w2,
+			       int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += hweight(w1[i] & w2[i]);
+	return count;
+}
+
+static int64_t _and_not_count_word(const bitstr_t *w1, const bitstr_t *w2,
+				   int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += hweight(w1[i] & ~w2[i]);
+	return count;
+}
+
+static int64_t _and3_count_word(const bitstr_t *w1, const bitstr_t *w2,
+				const bitstr_t *w3, int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += hweight(w1[i] & w2[i] & w3[i]);
+	return count;
+}
+
+static int _any_and_word(const bitstr_t *w1, const bitstr_t *w2,
+			 int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; i < nwords; i++) {
+		if (w1[i] & w2[i])
+			return 1;
+	}
+	return 0;
+}
+
+static void _and_word(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; i < nwords; i++)
+		w1[i] &= w2[i];
+}
+
+static void _and_not_word(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; i < nwords; i++)
+		w1[i] &= ~w2[i];
+}
+
+static void _or_word(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; i < nwords; i++)
+		w1[i] |= w2[i];
+}
+
+static int _super_set_word(const bitstr_t *w1, const bitstr_t *w2,
+			   int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; i < nwords; i++) {
+		if (w1[i] & ~w2[i])
+			return 0;
+	}
+	return 1;
+}
+
+/* Return the index of the first non-zero word, -1 if none */
+static int64_t _first_word(const bitstr_t *w, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; i < nwords; i++) {
+		if (w[i])
+			return i;
+	}
+	return -1;
+}
+
+static const bit_word_ops_t word_ops_scalar = {
+	.count		= _count_word,
+	.and_count	= _and_count_word,
+	.and_not_count	= _and_not_count_word,
+	.and3_count	= _and3_count_word,
+	.any_and	= _any_and_word,
+	.and		= _and_word,
+	.and_not	= _and_not_word,
+	.or		= _or_word,
+	.super_set	= _super_set_word,
+	.first_word	= _first_word,
+	.name		= "scalar",
+};
+
+#ifdef BITSTR_X86_SIMD
+/*
+ * Hardware popcnt. The scalar kernels are otherwise built without -mpopcnt,
+ * so __builtin_popcountll() is a library call.
+ */
+__attribute__((target("popcnt")))
+static int64_t _count_popcnt(const bitstr_t *w, int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += __builtin_popcountll(w[i]);
+	return count;
+}
+
+__attribute__((target("popcnt")))
+static int64_t _and_count_popcnt(const bitstr_t *w1, const bitstr_t *w2,
+				 int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & w2[i]);
+	return count;
+}
+
+__attribute__((target("popcnt")))
+static int64_t _and_not_count_popcnt(const bitstr_t *w1, const bitstr_t *w2,
+				     int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & ~w2[i]);
+	return count;
+}
+
+__attribute__((target("popcnt")))
+static int64_t _and3_count_popcnt(const bitstr_t *w1, const bitstr_t *w2,
+				  const bitstr_t *w3, int64_t nwords)
+{
+	int64_t i, count = 0;
+
+	for (i = 0; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & w2[i] & w3[i]);
+	return count;
+}
+
+/* Count bits in each 64-bit lane using a nibble lookup table */
+__attribute__((target("avx2")))
+static inline __m256i _popcnt256(__m256i v)
+{
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low_mask = _mm256_set1_epi8(0x0f);
+	__m256i lo = _mm256_and_si256(v, low_mask);
+	__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+	__m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+				      _mm256_shuffle_epi8(lookup, hi));
+
+	return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static int64_t _sum256(__m256i acc)
+{
+	return _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+	       _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+}
+
+__attribute__((target("avx2,popcnt")))
+static int64_t _count_avx2(const bitstr_t *w, int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i, count;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (w + i));
+		acc = _mm256_add_epi64(acc, _popcnt256(v));
+	}
+	count = _sum256(acc);
+	for (; i < nwords; i++)
+		count += __builtin_popcountll(w[i]);
+	return count;
+}
+
+__attribute__((target("avx2,popcnt")))
+static int64_t _and_count_avx2(const bitstr_t *w1, const bitstr_t *w2,
+			       int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i, count;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_and_si256(
+			_mm256_loadu_si256((const __m256i *) (w1 + i)),
+			_mm256_loadu_si256((const __m256i *) (w2 + i)));
+		acc = _mm256_add_epi64(acc, _popcnt256(v));
+	}
+	count = _sum256(acc);
+	for (; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & w2[i]);
+	return count;
+}
+
+__attribute__((target("avx2,popcnt")))
+static int64_t _and_not_count_avx2(const bitstr_t *w1, const bitstr_t *w2,
+				   int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i, count;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_andnot_si256(
+			_mm256_loadu_si256((const __m256i *) (w2 + i)),
+			_mm256_loadu_si256((const __m256i *) (w1 + i)));
+		acc = _mm256_add_epi64(acc, _popcnt256(v));
+	}
+	count = _sum256(acc);
+	for (; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & ~w2[i]);
+	return count;
+}
+
+__attribute__((target("avx2,popcnt")))
+static int64_t _and3_count_avx2(const bitstr_t *w1, const bitstr_t *w2,
+				const bitstr_t *w3, int64_t nwords)
+{
+	__m256i acc = _mm256_setzero_si256();
+	int64_t i, count;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_and_si256(
+			_mm256_loadu_si256((const __m256i *) (w1 + i)),
+			_mm256_loadu_si256((const __m256i *) (w2 + i)));
+		v = _mm256_and_si256(
+			v, _mm256_loadu_si256((const __m256i *) (w3 + i)));
+		acc = _mm256_add_epi64(acc, _popcnt256(v));
+	}
+	count = _sum256(acc);
+	for (; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & w2[i] & w3[i]);
+	return count;
+}
+
+__attribute__((target("avx2")))
+static int _any_and_avx2(const bitstr_t *w1, const bitstr_t *w2,
+			 int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		/* testz is set if (w1 & w2) == 0 */
+		if (!_mm256_testz_si256(
+			    _mm256_loadu_si256((const __m256i *) (w1 + i)),
+			    _mm256_loadu_si256((const __m256i *) (w2 + i))))
+			return 1;
+	}
+	for (; i < nwords; i++) {
+		if (w1[i] & w2[i])
+			return 1;
+	}
+	return 0;
+}
+
+__attribute__((target("avx2")))
+static void _and_avx2(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_and_si256(
+			_mm256_loadu_si256((const __m256i *) (w1 + i)),
+			_mm256_loadu_si256((const __m256i *) (w2 + i)));
+		_mm256_storeu_si256((__m256i *) (w1 + i), v);
+	}
+	for (; i < nwords; i++)
+		w1[i] &= w2[i];
+}
+
+__attribute__((target("avx2")))
+static void _and_not_avx2(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		/* _mm256_andnot_si256(a, b) computes ~a & b */
+		__m256i v = _mm256_andnot_si256(
+			_mm256_loadu_si256((const __m256i *) (w2 + i)),
+			_mm256_loadu_si256((const __m256i *) (w1 + i)));
+		_mm256_storeu_si256((__m256i *) (w1 + i), v);
+	}
+	for (; i < nwords; i++)
+		w1[i] &= ~w2[i];
+}
+
+__attribute__((target("avx2")))
+static void _or_avx2(bitstr_t *w1, const bitstr_t *w2, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_or_si256(
+			_mm256_loadu_si256((const __m256i *) (w1 + i)),
+			_mm256_loadu_si256((const __m256i *) (w2 + i)));
+		_mm256_storeu_si256((__m256i *) (w1 + i), v);
+	}
+	for (; i < nwords; i++)
+		w1[i] |= w2[i];
+}
+
+__attribute__((target("avx2")))
+static int _super_set_avx2(const bitstr_t *w1, const bitstr_t *w2,
+			   int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		/* testc is set if (~w2 & w1) == 0 */
+		if (!_mm256_testc_si256(
+			    _mm256_loadu_si256((const __m256i *) (w2 + i)),
+			    _mm256_loadu_si256((const __m256i *) (w1 + i))))
+			return 0;
+	}
+	for (; i < nwords; i++) {
+		if (w1[i] & ~w2[i])
+			return 0;
+	}
+	return 1;
+}
+
+__attribute__((target("avx2")))
+static int64_t _first_word_avx2(const bitstr_t *w, int64_t nwords)
+{
+	int64_t i;
+
+	for (i = 0; (i + 4) <= nwords; i += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (w + i));
+		if (!_mm256_testz_si256(v, v))
+			break;
+	}
+	for (; i < nwords; i++) {
+		if (w[i])
+			return i;
+	}
+	return -1;
+}
+
+#ifdef BITSTR_X86_AVX512
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static int64_t _count_avx512(const bitstr_t *w, int64_t nwords)
+{
+	__m512i acc = _mm512_setzero_si512();
+	int64_t i, count;
+
+	for (i = 0; (i + 8) <= nwords; i += 8) {
+		__m512i v = _mm512_loadu_si512((const void *) (w + i));
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+	}
+	count = _mm512_reduce_add_epi64(acc);
+	for (; i < nwords; i++)
+		count += __builtin_popcountll(w[i]);
+	return count;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static int64_t _and_count_avx512(const bitstr_t *w1, const bitstr_t *w2,
+				 int64_t nwords)
+{
+	__m512i acc = _mm512_setzero_si512();
+	int64_t i, count;
+
+	for (i = 0; (i + 8) <= nwords; i += 8) {
+		__m512i v = _mm512_and_si512(
+			_mm512_loadu_si512((const void *) (w1 + i)),
+			_mm512_loadu_si512((const void *) (w2 + i)));
+		acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+	}
+	count = _mm512_reduce_add_epi64(acc);
+	for (; i < nwords; i++)
+		count += __builtin_popcountll(w1[i] & w2[i]);
+	return count;
+}
+#endif
+
+static const bit_word_ops_t word_ops_popcnt = {
+	.count		= _count_popcnt,
+	.and_count	= _and_count_popcnt,
+	.and_not_count	= _and_not_count_popcnt,
+	.and3_count	= _and3_count_popcnt,
+	.any_and	= _any_and_word,
+	.and		= _and_word,
+	.and_not	= _and_not_word,
+	.or		= _or_word,
+	.super_set	= _super_set_word,
+	.first_word	= _first_word,
+	.name		= "popcnt",
+};
+
+static const bit_word_ops_t word_ops_avx2 = {
+	.count		= _count_avx2,
+	.and_count	= _and_count_avx2,
+	.and_not_count	= _and_not_count_avx2,
+	.and3_count	= _and3_count_avx2,
+	.any_and	= _any_and_avx2,
+	.and		= _and_avx2,
+	.and_not	= _and_not_avx2,
+	.or		= _or_avx2,
+	.super_set	= _super_set_avx2,
+	.first_word	= _first_word_avx2,
+	.name		= "avx2",
+};
+
+#ifdef BITSTR_X86_AVX512
+static const bit_word_ops_t word_ops_avx512 = {
+	.count		= _count_avx512,
+	.and_count	= _and_count_avx512,
+	.and_not_count	= _and_not_count_avx2,
+	.and3_count	= _and3_count_avx2,
+	.any_and	= _any_and_avx2,
+	.and		= _and_avx2,
+	.and_not	= _and_not_avx2,
+	.or		= _or_avx2,
+	.super_set	= _super_set_avx2,
+	.first_word	= _first_word_avx2,
+	.name		= "avx512",
+};
+#endif
+#endif	/* BITSTR_X86_SIMD */
+
+static const bit_word_ops_t *word_ops = NULL;
+
+/*
+ * Select the word kernels for this CPU on first use. Concurrent callers may
+ * each run the selection, but they all store the same pointer.
+ */
+static const bit_word_ops_t *_select_word_ops(void)
+{
+	const bit_word_ops_t *ops = &word_ops_scalar;
+
+#ifdef BITSTR_X86_SIMD
+	__builtin_cpu_init();
+	if (getenv("SLURM_BITSTR_SCALAR")) {
+		ops = &word_ops_scalar;
+#ifdef BITSTR_X86_AVX512
+	} else if (__builtin_cpu_supports("avx512f") &&
+		   __builtin_cpu_supports("avx512vpopcntdq")) {
+		ops = &word_ops_avx512;
+#endif
+	} else if (__builtin_cpu_supports("avx2") &&
+		   __builtin_cpu_supports("popcnt")) {
+		ops = &word_ops_avx2;
+	} else if (__builtin_cpu_supports("popcnt")) {
+		ops = &word_ops_popcnt;
+	}
+#endif
+	word_ops = ops;
+	return ops;
+}
+
+#define _word_ops() (word_ops ? word_ops : _select_word_ops())
+
+/* Number of data words in a bitstring, including any partial last word */
+#define _bitstr_data_words(name) \
+	(_bitstr_words(_bitstr_bits(name)) - BITSTR_OVERHEAD)
+
+/*
+ * Return the name of the bitstring word kernels in use on this CPU
+ * ("scalar", "popcnt", "avx2" or "avx512").
+ */
+extern const char *bit_simd_name(void)
+{
+	return _word_ops()->name;
+}
 
 /*
  * Allocate a bitstring.
@@ -474,6 +1017,14 @@ bit_ffs(bitstr_t *b)
 
 	_assert_bitstr_valid(b);
 
+	if (_bitstr_bits(b) > 0) {
+		int64_t word = _word_ops()->first_word(b + BITSTR_OVERHEAD,
+						       _bitstr_data_words(b));
+		if (word == -1)
+			return -1;
+		bit = word << BITSTR_SHIFT;
+	}
+
 	while (bit < _bitstr_bits(b) && value == -1) {
 		int32_t word = _bit_word(bit);
 
@@ -577,19 +1128,13 @@ bit_fill_gaps(bitstr_t *b)
 int
 bit_super_set(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
-		                           b2[_bit_word(bit)]))
-			return 0;
-	}
-
-	return 1;
+	return _word_ops()->super_set(b1 + BITSTR_OVERHEAD,
+				      b2 + BITSTR_OVERHEAD,
+				      _bitstr_data_words(b1));
 }
 
 /*
@@ -624,14 +1169,12 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 void
 bit_and(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	_word_ops()->and(b1 + BITSTR_OVERHEAD, b2 + BITSTR_OVERHEAD,
+			  _bitstr_data_words(b1));
 }
 
 /*
@@ -641,14 +1184,12 @@ bit_and(bitstr_t *b1, bitstr_t *b2)
  */
 void bit_and_not(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= ~b2[_bit_word(bit)];
+	_word_ops()->and_not(b1 + BITSTR_OVERHEAD, b2 + BITSTR_OVERHEAD,
+			     _bitstr_data_words(b1));
 }
 
 /*
@@ -674,14 +1215,12 @@ bit_not(bitstr_t *b)
 void
 bit_or(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
-
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	_word_ops()->or(b1 + BITSTR_OVERHEAD, b2 + BITSTR_OVERHEAD,
+			  _bitstr_data_words(b1));
 }
 
 /*
@@ -735,23 +1274,6 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#ifdef HAVE___BUILTIN_POPCOUNTLL
-#define hweight __builtin_popcountll
-#else
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 4.9 <tools/lib/hweight.c>.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-        w -= (w >> 1) & 0x5555555555555555ul;
-        w =  (w & 0x3333333333333333ul) + ((w >> 2) & 0x3333333333333333ul);
-        w =  (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0ful;
-        return (w * 0x0101010101010101ul) >> 56;
-}
-#endif
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -767,10 +1289,8 @@ bit_set_count(bitstr_t *b)
 	_assert_bitstr_valid(b);
 
 	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; (bit + word_size) <= bit_cnt; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
+	count = _word_ops()->count(b + BITSTR_OVERHEAD, bit_cnt / word_size);
+	for (bit = (bit_cnt / word_size) * word_size; bit < bit_cnt; bit++) {
 		if (bit_test(b, bit))
 			count++;
 	}
@@ -826,13 +1346,95 @@ bit_overlap(bitstr_t *b1, bitstr_t *b2)
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
 	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b1[_bit_word(bit)] & b2[_bit_word(bit)]);
+	count = _word_ops()->and_count(b1 + BITSTR_OVERHEAD,
+				       b2 + BITSTR_OVERHEAD,
+				       bit_cnt / word_size);
+	for (bit = (bit_cnt / word_size) * word_size; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit) && bit_test(b2, bit))
+			count++;
 	}
-	for ( ; bit < bit_cnt; bit++) {
+
+	return count;
+}
+
+/*
+ * return 1 if any bit set in b1 is also set in b2, 0 otherwise.
+ * Unlike bit_overlap(), stop at the first common bit.
+ */
+extern int
+bit_overlap_any(bitstr_t *b1, bitstr_t *b2)
+{
+	bitoff_t bit, bit_cnt;
+	int32_t word_size = sizeof(bitstr_t) * 8;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	bit_cnt = _bitstr_bits(b1);
+	if (_word_ops()->any_and(b1 + BITSTR_OVERHEAD, b2 + BITSTR_OVERHEAD,
+				 bit_cnt / word_size))
+		return 1;
+	for (bit = (bit_cnt / word_size) * word_size; bit < bit_cnt; bit++) {
 		if (bit_test(b1, bit) && bit_test(b2, bit))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * return number of bits set in b1 that are not set in b2, without building
+ * the intermediate bitmap of bit_and_not()
+ */
+extern int32_t
+bit_and_not_count(bitstr_t *b1, bitstr_t *b2)
+{
+	int32_t count = 0;
+	bitoff_t bit, bit_cnt;
+	int32_t word_size = sizeof(bitstr_t) * 8;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	bit_cnt = _bitstr_bits(b1);
+	count = _word_ops()->and_not_count(b1 + BITSTR_OVERHEAD,
+					   b2 + BITSTR_OVERHEAD,
+					   bit_cnt / word_size);
+	for (bit = (bit_cnt / word_size) * word_size; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit) && !bit_test(b2, bit))
+			count++;
+	}
+
+	return count;
+}
+
+/*
+ * return number of bits set in all of b1, b2 and b3, without building the
+ * intermediate bitmap of bit_and()
+ */
+extern int32_t
+bit_and3_count(bitstr_t *b1, bitstr_t *b2, bitstr_t *b3)
+{
+	int32_t count = 0;
+	bitoff_t bit, bit_cnt;
+	int32_t word_size = sizeof(bitstr_t) * 8;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	_assert_bitstr_valid(b3);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+	assert(_bitstr_bits(b1) == _bitstr_bits(b3));
+
+	bit_cnt = _bitstr_bits(b1);
+	count = _word_ops()->and3_count(b1 + BITSTR_OVERHEAD,
+					b2 + BITSTR_OVERHEAD,
+					b3 + BITSTR_OVERHEAD,
+					bit_cnt / word_size);
+	for (bit = (bit_cnt / word_size) * word_size; bit < bit_cnt; bit++) {
+		if (bit_test(b1, bit) && bit_test(b2, bit) &&
+		    bit_test(b3, bit))
 			count++;
 	}
 
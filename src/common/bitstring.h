@@ -140,6 +140,9 @@ bitoff_t bit_fls(bitstr_t *b);
 void	bit_fill_gaps(bitstr_t *b);
 int	bit_super_set(bitstr_t *b1, bitstr_t *b2);
 int     bit_overlap(bitstr_t *b1, bitstr_t *b2);
+int     bit_overlap_any(bitstr_t *b1, bitstr_t *b2);
+int32_t	bit_and_not_count(bitstr_t *b1, bitstr_t *b2);
+int32_t	bit_and3_count(bitstr_t *b1, bitstr_t *b2, bitstr_t *b3);
 int     bit_equal(bitstr_t *b1, bitstr_t *b2);
 void    bit_copybits(bitstr_t *dest, bitstr_t *src);
 bitstr_t *bit_copy(bitstr_t *b);
@@ -147,6 +150,13 @@ bitstr_t *bit_pick_cnt(bitstr_t *b, bitoff_t nbits);
 bitoff_t bit_get_bit_num(bitstr_t *b, int32_t pos);
 int32_t	bit_get_pos_num(bitstr_t *b, bitoff_t pos);
 
+/*
+ * Name of the word kernels used for whole bitstring operations, selected at
+ * run time from the CPU features ("scalar", "popcnt", "avx2" or "avx512").
+ * Set SLURM_BITSTR_SCALAR in the environment to force the portable kernels.
+ */
+const char *bit_simd_name(void);
+
 #define FREE_NULL_BITMAP(_X)		\
 	do {				\
 		if (_X) bit_free (_X);	\
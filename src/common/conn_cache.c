@@ -0,0 +1,353 @@
+/*****************************************************************************\
+ *  conn_cache.c - keep connections to slurmd open between requests
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "src/common/conn_cache.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_auth.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/strlcpy.h"
+#include "src/common/xhash.h"
+#include "src/common/xmalloc.h"
+
+/* idle connections kept per address */
+#define CONN_CACHE_DEPTH 2
+
+/* longest a credential is repeated on a connection, in seconds */
+#define CONN_SESSION_TTL 60
+
+typedef struct {
+	char key[32];		/* "address:port" */
+	int cnt;		/* idle connections in fds[] */
+	int fds[CONN_CACHE_DEPTH];
+	conn_session_t *sessions[CONN_CACHE_DEPTH];
+	time_t used[CONN_CACHE_DEPTH];
+	uint64_t opened;
+	uint64_t reused;
+	uint64_t reconnects;
+} conn_entry_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *conn_hash = NULL;
+static int cache_idle_timeout = 0;
+static uint32_t cache_max = 0;		/* idle connections over all addresses */
+static time_t last_purge = 0;
+static conn_cache_stats_t cache_stats;
+
+static void _entry_id(void *item, const char **key, uint32_t *key_len)
+{
+	conn_entry_t *entry = item;
+
+	*key = entry->key;
+	*key_len = strlen(entry->key);
+}
+
+static void _entry_free(void *item)
+{
+	conn_entry_t *entry = item;
+	int i;
+
+	for (i = 0; i < entry->cnt; i++) {
+		(void) close(entry->fds[i]);
+		conn_session_destroy(entry->sessions[i]);
+	}
+	xfree(entry);
+}
+
+/* Find or create the entry for addr, call with cache_lock held */
+static conn_entry_t *_find_entry(slurm_addr_t *addr)
+{
+	conn_entry_t *entry;
+	char key[32];
+
+	slurm_print_slurm_addr(addr, key, sizeof(key));
+	if ((entry = xhash_get_str(conn_hash, key)))
+		return entry;
+
+	entry = xmalloc(sizeof(conn_entry_t));
+	strlcpy(entry->key, key, sizeof(entry->key));
+	xhash_add(conn_hash, entry);
+	return entry;
+}
+
+/* Remove connection i from entry, call with cache_lock held */
+static void _entry_drop(conn_entry_t *entry, int i, bool do_close)
+{
+	if (do_close) {
+		(void) close(entry->fds[i]);
+		conn_session_destroy(entry->sessions[i]);
+	}
+	entry->cnt--;
+	entry->fds[i] = entry->fds[entry->cnt];
+	entry->sessions[i] = entry->sessions[entry->cnt];
+	entry->used[i] = entry->used[entry->cnt];
+	cache_stats.cached--;
+}
+
+static void _purge_entry(void *item, void *arg)
+{
+	conn_entry_t *entry = item;
+	time_t *cutoff = arg;
+	int i;
+
+	for (i = entry->cnt - 1; i >= 0; i--) {
+		if (entry->used[i] < *cutoff)
+			_entry_drop(entry, i, true);
+	}
+}
+
+/*
+ * An idle connection the slurmd has given up on reads as end of file (or
+ * an error) without blocking. A live one has nothing to read.
+ */
+static bool _conn_alive(int fd)
+{
+	struct pollfd pfd;
+	char c;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, 0) == 0)
+		return true;
+	if ((pfd.revents & POLLIN) && !(pfd.revents & (POLLERR | POLLHUP)) &&
+	    (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) > 0))
+		return true;	/* unexpected data, but not closed */
+	return false;
+}
+
+extern void conn_cache_init(int idle_timeout)
+{
+	struct rlimit rlim;
+
+	slurm_mutex_lock(&cache_lock);
+	if (!conn_hash)
+		conn_hash = xhash_init(_entry_id, _entry_free);
+	cache_idle_timeout = idle_timeout;
+
+	/* Leave most descriptors for the connections that are in use */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim) &&
+	    (rlim.rlim_cur != RLIM_INFINITY))
+		cache_max = rlim.rlim_cur / 4;
+	else
+		cache_max = 4096;
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void conn_cache_fini(void)
+{
+	slurm_mutex_lock(&cache_lock);
+	xhash_free(conn_hash);
+	cache_stats.cached = 0;
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern bool conn_cache_msg_type(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_PING:
+	case REQUEST_HEALTH_CHECK:
+	case REQUEST_ACCT_GATHER_UPDATE:
+	case REQUEST_NODE_REGISTRATION_STATUS:
+		return true;
+	default:
+		return false;
+	}
+}
+
+extern bool conn_cache_wanted(slurm_msg_t *msg)
+{
+	/* conn_hash is only set or cleared by the daemon's main thread */
+	if (!conn_hash || msg->conn)
+		return false;
+	if (msg->protocol_version < SLURM_20_02_PROTOCOL_VERSION)
+		return false;
+	return conn_cache_msg_type(msg->msg_type);
+}
+
+extern int conn_cache_get(slurm_addr_t *addr, conn_session_t **session)
+{
+	conn_entry_t *entry;
+	time_t cutoff;
+	int fd = -1;
+
+	*session = NULL;
+	slurm_mutex_lock(&cache_lock);
+	if (!conn_hash) {
+		slurm_mutex_unlock(&cache_lock);
+		return -1;
+	}
+	entry = _find_entry(addr);
+	cutoff = time(NULL) - cache_idle_timeout;
+	while (entry->cnt) {
+		int i = entry->cnt - 1;		/* most recently used */
+
+		if ((entry->used[i] >= cutoff) && _conn_alive(entry->fds[i])) {
+			fd = entry->fds[i];
+			*session = entry->sessions[i];
+			_entry_drop(entry, i, false);
+			entry->reused++;
+			cache_stats.reused++;
+			break;
+		}
+		_entry_drop(entry, i, true);
+	}
+	slurm_mutex_unlock(&cache_lock);
+
+	return fd;
+}
+
+extern void conn_cache_put(slurm_addr_t *addr, int fd,
+			   conn_session_t *session)
+{
+	conn_entry_t *entry;
+	time_t now = time(NULL);
+
+	slurm_mutex_lock(&cache_lock);
+	if (!conn_hash || (cache_stats.cached >= cache_max)) {
+		slurm_mutex_unlock(&cache_lock);
+		(void) close(fd);
+		conn_session_destroy(session);
+		return;
+	}
+
+	if (now >= (last_purge + MAX(cache_idle_timeout / 2, 10))) {
+		time_t cutoff = now - cache_idle_timeout;
+
+		xhash_walk(conn_hash, _purge_entry, &cutoff);
+		last_purge = now;
+	}
+
+	entry = _find_entry(addr);
+	if (entry->cnt >= CONN_CACHE_DEPTH) {
+		slurm_mutex_unlock(&cache_lock);
+		(void) close(fd);
+		conn_session_destroy(session);
+		return;
+	}
+	entry->fds[entry->cnt] = fd;
+	entry->sessions[entry->cnt] = session;
+	entry->used[entry->cnt] = now;
+	entry->cnt++;
+	cache_stats.cached++;
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void conn_cache_opened(slurm_addr_t *addr)
+{
+	slurm_mutex_lock(&cache_lock);
+	if (conn_hash) {
+		_find_entry(addr)->opened++;
+		cache_stats.opened++;
+	}
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void conn_cache_reconnect(slurm_addr_t *addr)
+{
+	slurm_mutex_lock(&cache_lock);
+	if (conn_hash) {
+		_find_entry(addr)->reconnects++;
+		cache_stats.reconnects++;
+	}
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void conn_cache_get_stats(conn_cache_stats_t *stats, bool reset)
+{
+	slurm_mutex_lock(&cache_lock);
+	if (stats)
+		*stats = cache_stats;
+	if (reset) {
+		cache_stats.opened = 0;
+		cache_stats.reused = 0;
+		cache_stats.reconnects = 0;
+	}
+	slurm_mutex_unlock(&cache_lock);
+}
+
+static void _log_entry(void *item, void *arg)
+{
+	conn_entry_t *entry = item;
+
+	info("conn_cache: %s opened=%"PRIu64" reused=%"PRIu64" reconnects=%"PRIu64" idle=%d",
+	     entry->key, entry->opened, entry->reused, entry->reconnects,
+	     entry->cnt);
+}
+
+extern void conn_cache_log_stats(void)
+{
+	slurm_mutex_lock(&cache_lock);
+	if (conn_hash)
+		xhash_walk(conn_hash, _log_entry, NULL);
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern conn_session_t *conn_session_create(void *cred)
+{
+	conn_session_t *session;
+	int ttl = CONN_SESSION_TTL, auth_ttl = slurm_get_auth_ttl();
+
+	if (!cred)
+		return NULL;
+
+	/* Stay well inside the lifetime of the credential itself */
+	if (auth_ttl)
+		ttl = MIN(ttl, auth_ttl / 2);
+
+	session = xmalloc(sizeof(conn_session_t));
+	session->cred = cred;
+	session->expires = time(NULL) + ttl;
+	return session;
+}
+
+extern void conn_session_destroy(conn_session_t *session)
+{
+	if (!session)
+		return;
+	g_slurm_auth_destroy(session->cred);
+	xfree(session);
+}
+
+extern bool conn_session_valid(conn_session_t *session)
+{
+	return (session && (time(NULL) < session->expires));
+}
@@ -0,0 +1,131 @@
+/*****************************************************************************\
+ *  conn_cache.h - keep connections to slurmd open between requests
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _CONN_CACHE_H
+#define _CONN_CACHE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * A request sent with SLURM_MSG_KEEP_CONN asks the slurmd to leave the
+ * connection open once it has replied. The slurmd echoes the flag in its
+ * reply only if it will wait for another request on that connection, and
+ * only then is the connection put back in the cache for the next request
+ * to the same address. Each connection carries one request at a time.
+ *
+ * Messages on a kept connection repeat the authentication credential of
+ * the first one for up to a minute, so that only one credential is made
+ * and verified per connection and minute. The slurmd accepts the repeated
+ * credential only on the connection where it verified it.
+ */
+
+typedef struct {
+	void *cred;		/* credential created or verified for it */
+	time_t expires;		/* do not repeat cred from this time on */
+} conn_session_t;
+
+typedef struct {
+	uint64_t opened;	/* connections opened for cacheable requests */
+	uint64_t reused;	/* requests sent on a cached connection */
+	uint64_t reconnects;	/* cached connections found dead on use */
+	uint32_t cached;	/* idle connections currently cached */
+} conn_cache_stats_t;
+
+/*
+ * Enable the cache in this process, it is disabled by default.
+ * IN idle_timeout - seconds an unused connection stays cached
+ */
+extern void conn_cache_init(int idle_timeout);
+
+/* Close all cached connections and disable the cache */
+extern void conn_cache_fini(void);
+
+/*
+ * Return true if requests of this type may be sent on a kept connection.
+ * Only requests that are safe to send twice are listed, as a request on a
+ * connection that turns out to be dead is retried on a new one.
+ */
+extern bool conn_cache_msg_type(uint16_t msg_type);
+
+/*
+ * Return true if the cache is enabled and msg may use it.
+ */
+extern bool conn_cache_wanted(slurm_msg_t *msg);
+
+/*
+ * Take an idle connection to addr out of the cache.
+ * OUT session - authentication session of the connection, or NULL
+ * RET open file descriptor or -1 if none is cached
+ */
+extern int conn_cache_get(slurm_addr_t *addr, conn_session_t **session);
+
+/*
+ * Put a connection to addr back into the cache once its reply has been
+ * read. The connection is closed if the cache for addr is full.
+ * IN session - authentication session of the connection, the cache takes
+ *	ownership of it
+ */
+extern void conn_cache_put(slurm_addr_t *addr, int fd,
+			   conn_session_t *session);
+
+/* Record a new connection, or a cached one found dead, to addr */
+extern void conn_cache_opened(slurm_addr_t *addr);
+extern void conn_cache_reconnect(slurm_addr_t *addr);
+
+/*
+ * OUT stats - filled in with the current counters, may be NULL
+ * IN reset - clear the counters after reading them
+ */
+extern void conn_cache_get_stats(conn_cache_stats_t *stats, bool reset);
+
+/* Log the counters of every address in the cache */
+extern void conn_cache_log_stats(void);
+
+/*
+ * Start an authentication session with a credential that was just created
+ * or verified. The session takes ownership of cred.
+ * RET session or NULL if cred is NULL
+ */
+extern conn_session_t *conn_session_create(void *cred);
+extern void conn_session_destroy(conn_session_t *session);
+
+/* Return true if the credential of session may still be repeated */
+extern bool conn_session_valid(conn_session_t *session);
+
+#endif
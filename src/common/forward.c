@@ -52,6 +52,7 @@
 #include "src/common/slurm_route.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/timers.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -73,6 +74,120 @@ static void _forward_msg_internal(hostlist_t hl, hostlist_t* sp_hl,
 				  header_t *header, int timeout,
 				  int hl_count);
 
+/*
+ * Split hl as the route plugin does, then make the node expected to answer
+ * fastest the head (forwarder) of each part.
+ */
+static int _split_hostlist(hostlist_t hl, hostlist_t **sp_hl, int *count,
+			   uint16_t tree_width)
+{
+	if (route_g_split_hostlist(hl, sp_hl, count, tree_width))
+		return SLURM_ERROR;
+	route_plan_forwarders(*sp_hl, *count);
+	return SLURM_SUCCESS;
+}
+
+/* Note the other nodes that answered as part of a folded ping reply */
+static void _record_ping_tree(ret_data_info_t *ret_data_info)
+{
+	ping_tree_resp_msg_t *ping_tree = ret_data_info->data;
+	hostlist_t hl = hostlist_create(ping_tree->node_list);
+	char *host;
+
+	while ((host = hostlist_shift(hl))) {
+		if (xstrcmp(host, ret_data_info->node_name))
+			route_record_response(host, 0, -1, false);
+		free(host);
+	}
+	hostlist_destroy(hl);
+}
+
+/* Do not send again to the nodes that answered in a folded ping reply */
+static void _delete_ping_tree(hostlist_t hl, ret_data_info_t *ret_data_info)
+{
+	ping_tree_resp_msg_t *ping_tree = ret_data_info->data;
+
+	hostlist_delete(hl, ping_tree->node_list);
+}
+
+/*
+ * Note the nodes that answered through the head of a subtree, and how long
+ * the head itself took. Failed nodes were noted by mark_as_failed_forward().
+ */
+static void _record_responses(List ret_list, char *name, int fwd_cnt,
+			      int msec)
+{
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->type == RESPONSE_FORWARD_FAILED)
+			continue;
+		if (!ret_data_info->node_name ||
+		    !xstrcmp(ret_data_info->node_name, name))
+			route_record_response(name, fwd_cnt, msec, false);
+		else
+			route_record_response(ret_data_info->node_name, 0, -1,
+					      false);
+		if (ret_data_info->type == RESPONSE_PING_TREE)
+			_record_ping_tree(ret_data_info);
+	}
+	list_iterator_destroy(itr);
+}
+
+/*
+ * Remove every node from hl once it has been handed on, so that the
+ * hostlist_shift() loop of the caller ends rather than sending to them again
+ */
+static void _empty_hostlist(hostlist_t hl)
+{
+	char *range;
+
+	while ((range = hostlist_shift_range(hl)))
+		free(range);
+}
+
+/*
+ * The head of a subtree failed, send to the rest of it through new
+ * forwarders rather than to each node on its own, so that the nodes that
+ * answered best lately take over and the message still goes out in
+ * parallel. hl is empty on return.
+ */
+static void _reroute_forward(hostlist_t hl, forward_struct_t *fwd_struct,
+			     header_t *header)
+{
+	hostlist_t *sp_hl;
+	int hl_count = 0;
+
+	if (_split_hostlist(hl, &sp_hl, &hl_count,
+			    header->forward.tree_width)) {
+		_forward_msg_internal(hl, NULL, fwd_struct, header, 0,
+				      hostlist_count(hl));
+		return;
+	}
+	_empty_hostlist(hl);
+	_forward_msg_internal(NULL, sp_hl, fwd_struct, header, 0, hl_count);
+	xfree(sp_hl);
+}
+
+/* As _reroute_forward(), fwd_tree->tree_hl is empty on return */
+static void _reroute_tree(fwd_tree_t *fwd_tree)
+{
+	hostlist_t *sp_hl;
+	int hl_count = 0;
+
+	if (_split_hostlist(fwd_tree->tree_hl, &sp_hl, &hl_count,
+			    fwd_tree->orig_msg->forward.tree_width)) {
+		_start_msg_tree_internal(fwd_tree->tree_hl, NULL, fwd_tree,
+					 hostlist_count(fwd_tree->tree_hl));
+		return;
+	}
+	_empty_hostlist(fwd_tree->tree_hl);
+	_start_msg_tree_internal(NULL, sp_hl, fwd_tree, hl_count);
+	xfree(sp_hl);
+}
+
 void _destroy_tree_fwd(fwd_tree_t *fwd_tree)
 {
 	if (fwd_tree) {
@@ -106,6 +221,7 @@ void *_forward_thread(void *arg)
 	char *buf = NULL;
 	int steps = 0;
 	int start_timeout = fwd_msg->timeout;
+	DEF_TIMERS;
 
 	/* repeat until we are sure the message was sent */
 	while ((name = hostlist_shift(hl))) {
@@ -137,9 +253,8 @@ void *_forward_thread(void *arg)
 				 * don't have to time out for each
 				 * node serially.
 				 */
-				_forward_msg_internal(hl, NULL, fwd_struct,
-						      &fwd_msg->header, 0,
-						      hostlist_count(hl));
+				_reroute_forward(hl, fwd_struct,
+						 &fwd_msg->header);
 				continue;
 			}
 			goto cleanup;
@@ -178,6 +293,7 @@ void *_forward_thread(void *arg)
 		/*
 		 * forward message
 		 */
+		START_TIMER;
 		if (slurm_msg_sendto(fd,
 				     get_buf_data(buffer),
 				     get_buf_offset(buffer)) < 0) {
@@ -198,9 +314,8 @@ void *_forward_thread(void *arg)
 				 * don't have to time out for each
 				 * node serially.
 				 */
-				_forward_msg_internal(hl, NULL, fwd_struct,
-						      &fwd_msg->header, 0,
-						      hostlist_count(hl));
+				_reroute_forward(hl, fwd_struct,
+						 &fwd_msg->header);
 				continue;
 			}
 			goto cleanup;
@@ -248,11 +363,12 @@ void *_forward_thread(void *arg)
 		}
 
 		ret_list = slurm_receive_msgs(fd, steps, fwd_msg->timeout);
+		END_TIMER;
 		/* info("sent %d forwards got %d back", */
 		/*      fwd_msg->header.forward.cnt, list_count(ret_list)); */
 
 		if (!ret_list || (fwd_msg->header.forward.cnt != 0
-				  && list_count(ret_list) <= 1)) {
+				  && forward_resp_cnt(ret_list) <= 1)) {
 			slurm_mutex_lock(&fwd_struct->forward_mutex);
 			mark_as_failed_forward(&fwd_struct->ret_list, name,
 					       errno);
@@ -264,11 +380,13 @@ void *_forward_thread(void *arg)
 				slurm_mutex_unlock(&fwd_struct->forward_mutex);
 				close(fd);
 				fd = -1;
+				/* the next forwarder is the best one left */
+				route_plan_forwarders(&hl, 1);
 				continue;
 			}
 			goto cleanup;
 		} else if ((fwd_msg->header.forward.cnt+1)
-			  != list_count(ret_list)) {
+			  != forward_resp_cnt(ret_list)) {
 			/* this should never be called since the above
 			   should catch the failed forwards and pipe
 			   them back down, but this is here so we
@@ -282,7 +400,7 @@ void *_forward_thread(void *arg)
 			error("We shouldn't be here.  We forwarded to %d "
 			      "but only got %d back",
 			      (fwd_msg->header.forward.cnt+1),
-			      list_count(ret_list));
+			      forward_resp_cnt(ret_list));
 			while ((tmp = hostlist_next(host_itr))) {
 				int node_found = 0;
 				itr = list_iterator_create(ret_list);
@@ -317,6 +435,9 @@ void *_forward_thread(void *arg)
 		}
 		break;
 	}
+	if (ret_list)
+		_record_responses(ret_list, name, fwd_msg->header.forward.cnt,
+				  DELTA_TIMER / 1000);
 	slurm_mutex_lock(&fwd_struct->forward_mutex);
 	if (ret_list) {
 		while ((ret_data_info = list_pop(ret_list)) != NULL) {
@@ -350,6 +471,7 @@ void *_fwd_tree_thread(void *arg)
 	char *name = NULL;
 	char *buf = NULL;
 	slurm_msg_t send_msg;
+	DEF_TIMERS;
 
 	slurm_msg_t_init(&send_msg);
 	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
@@ -386,13 +508,18 @@ void *_fwd_tree_thread(void *arg)
 		} else
 			debug3("Tree sending to %s", name);
 
+		START_TIMER;
 		ret_list = slurm_send_addr_recv_msgs(&send_msg, name,
 						     fwd_tree->timeout);
+		END_TIMER;
 
 		xfree(send_msg.forward.nodelist);
 
 		if (ret_list) {
-			int ret_cnt = list_count(ret_list);
+			int ret_cnt = forward_resp_cnt(ret_list);
+
+			_record_responses(ret_list, name, send_msg.forward.cnt,
+					  DELTA_TIMER / 1000);
 			/* This is most common if a slurmd is running
 			   an older version of Slurm than the
 			   originator of the message.
@@ -409,8 +536,15 @@ void *_fwd_tree_thread(void *arg)
 						list_iterator_create(ret_list);
 					while ((ret_data_info =
 						list_next(itr))) {
-						if (xstrcmp(ret_data_info->
-							    node_name, name))
+						if (ret_data_info->type ==
+						    RESPONSE_PING_TREE)
+							_delete_ping_tree(
+								fwd_tree->
+								tree_hl,
+								ret_data_info);
+						else if (xstrcmp(ret_data_info->
+								 node_name,
+								 name))
 							hostlist_delete_host(
 								fwd_tree->
 								tree_hl,
@@ -434,10 +568,7 @@ void *_fwd_tree_thread(void *arg)
 				 * don't have to time out for each
 				 * node serially.
 				 */
-				_start_msg_tree_internal(
-					fwd_tree->tree_hl, NULL,
-					fwd_tree,
-					hostlist_count(fwd_tree->tree_hl));
+				_reroute_tree(fwd_tree);
 				continue;
 			}
 		} else {
@@ -461,8 +592,11 @@ void *_fwd_tree_thread(void *arg)
 		free(name);
 
 		/* check for error and try again */
-		if (errno == SLURM_COMMUNICATIONS_CONNECTION_ERROR)
+		if (errno == SLURM_COMMUNICATIONS_CONNECTION_ERROR) {
+			/* the next forwarder is the best one left */
+			route_plan_forwarders(&fwd_tree->tree_hl, 1);
  			continue;
+		}
 
 		break;
 	}
@@ -546,7 +680,7 @@ static void _forward_msg_internal(hostlist_t hl, hostlist_t* sp_hl,
 		       sizeof(slurm_addr_t));
 
 		fwd_msg->header.version = header->version;
-		fwd_msg->header.flags = header->flags;
+		fwd_msg->header.flags = header->flags & ~SLURM_MSG_KEEP_CONN;
 		fwd_msg->header.msg_type = header->msg_type;
 		fwd_msg->header.body_length = header->body_length;
 		fwd_msg->header.ret_list = NULL;
@@ -609,8 +743,8 @@ extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
 	hl = hostlist_create(header->forward.nodelist);
 	hostlist_uniq(hl);
 
-	if (route_g_split_hostlist(
-		    hl, &sp_hl, &hl_count, header->forward.tree_width)) {
+	if (_split_hostlist(hl, &sp_hl, &hl_count,
+			    header->forward.tree_width)) {
 		error("unable to split forward hostlist");
 		hostlist_destroy(hl);
 		return SLURM_ERROR;
@@ -654,8 +788,7 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 	hostlist_uniq(hl);
 	host_count = hostlist_count(hl);
 
-	if (route_g_split_hostlist(hl, &sp_hl, &hl_count,
-				   msg->forward.tree_width)) {
+	if (_split_hostlist(hl, &sp_hl, &hl_count, msg->forward.tree_width)) {
 		error("unable to split forward hostlist");
 		return NULL;
 	}
@@ -678,11 +811,11 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 
 	slurm_mutex_lock(&tree_mutex);
 
-	count = list_count(ret_list);
+	count = forward_resp_cnt(ret_list);
 	debug2("Tree head got back %d looking for %d", count, host_count);
 	while (thr_count > 0) {
 		slurm_cond_wait(&notify, &tree_mutex);
-		count = list_count(ret_list);
+		count = forward_resp_cnt(ret_list);
 		debug2("Tree head got back %d", count);
 	}
 	xassert(count >= host_count);	/* Tree head did not get all responses,
@@ -708,6 +841,7 @@ extern void mark_as_failed_forward(List *ret_list, char *node_name, int err)
 	ret_data_info_t *ret_data_info = NULL;
 
 	debug3("problems with %s", node_name);
+	route_record_response(node_name, 0, -1, true);
 	if (!*ret_list)
 		*ret_list = list_create(destroy_data_info);
 
@@ -728,18 +862,13 @@ extern void forward_wait(slurm_msg_t * msg)
 	if (msg->forward_struct) {
 		debug2("looking for %d", msg->forward_struct->fwd_cnt);
 		slurm_mutex_lock(&msg->forward_struct->forward_mutex);
-		count = 0;
-		if (msg->ret_list != NULL)
-			count = list_count(msg->ret_list);
+		count = forward_resp_cnt(msg->ret_list);
 
 		debug2("Got back %d", count);
 		while ((count < msg->forward_struct->fwd_cnt)) {
 			slurm_cond_wait(&msg->forward_struct->notify,
 					&msg->forward_struct->forward_mutex);
-
-			if (msg->ret_list != NULL) {
-				count = list_count(msg->ret_list);
-			}
+			count = forward_resp_cnt(msg->ret_list);
 			debug2("Got back %d", count);
 		}
 		debug2("Got them all");
@@ -750,6 +879,28 @@ extern void forward_wait(slurm_msg_t * msg)
 	return;
 }
 
+extern int forward_resp_cnt(List ret_list)
+{
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	int count = 0;
+
+	if (!ret_list)
+		return 0;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->type == RESPONSE_PING_TREE)
+			count += ((ping_tree_resp_msg_t *)
+				  ret_data_info->data)->node_cnt;
+		else
+			count++;
+	}
+	list_iterator_destroy(itr);
+
+	return count;
+}
+
 void destroy_data_info(void *object)
 {
 	ret_data_info_t *ret_data_info = (ret_data_info_t *)object;
@@ -113,6 +113,15 @@ extern void mark_as_failed_forward(List *ret_list, char *node_name, int err);
 
 extern void forward_wait(slurm_msg_t *msg);
 
+/*
+ * forward_resp_cnt - count the nodes that have a response in ret_list. This
+ * may be more than the entries in it, as a RESPONSE_PING_TREE entry stands
+ * for all the nodes of a subtree.
+ * IN: ret_list       - List     - ret_list of ret_data_info_t, may be NULL
+ * RET: count of nodes
+ */
+extern int forward_resp_cnt(List ret_list);
+
 /*
  * no_resp_forward - Used to respond for nodes not able to respond since
  *                   the parent had failed in some way
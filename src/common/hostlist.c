@@ -372,6 +372,7 @@ static int         hostlist_insert_range(hostlist_t, hostrange_t, int);
 static void        hostlist_delete_range(hostlist_t, int n);
 static void        hostlist_coalesce(hostlist_t hl);
 static void        hostlist_collapse(hostlist_t hl);
+static int         hostlist_is_sorted(hostlist_t hl);
 static hostlist_t _hostlist_create(const char *, char *, char *, int);
 static void        hostlist_shift_iterators(hostlist_t, int, int, int);
 static int        _attempt_range_join(hostlist_t, int);
@@ -1391,8 +1392,6 @@ hostlist_push_hr(hostlist_t hl, char *prefix, unsigned long lo,
  */
 static int hostlist_insert_range(hostlist_t hl, hostrange_t hr, int n)
 {
-	int i;
-	hostrange_t tmp;
 	hostlist_iterator_t hli;
 
 	assert(hl != NULL);
@@ -1405,16 +1404,11 @@ static int hostlist_insert_range(hostlist_t hl, hostrange_t hr, int n)
 	if (hl->size == hl->nranges && !hostlist_expand(hl))
 		return 0;
 
-	/* copy new hostrange into slot "n" in array */
-	tmp = hl->hr[n];
+	/* push remaining hostrange entries up, then copy new hostrange
+	 * into slot "n" in array */
+	memmove(&hl->hr[n + 1], &hl->hr[n],
+		(hl->nranges - n) * sizeof(hostrange_t));
 	hl->hr[n] = hostrange_copy(hr);
-
-	/* push remaining hostrange entries up */
-	for (i = n + 1; i < hl->nranges + 1; i++) {
-		hostrange_t last = hl->hr[i];
-		hl->hr[i] = tmp;
-		tmp = last;
-	}
 	hl->nranges++;
 
 	/* adjust hostlist iterators if needed */
@@ -1431,7 +1425,6 @@ static int hostlist_insert_range(hostlist_t hl, hostrange_t hr, int n)
  */
 static void hostlist_delete_range(hostlist_t hl, int n)
 {
-	int i;
 	hostrange_t old;
 
 	assert(hl != NULL);
@@ -1439,8 +1432,8 @@ static void hostlist_delete_range(hostlist_t hl, int n)
 	assert((n < hl->nranges) && (n >= 0));
 
 	old = hl->hr[n];
-	for (i = n; i < hl->nranges - 1; i++)
-		hl->hr[i] = hl->hr[i + 1];
+	memmove(&hl->hr[n], &hl->hr[n + 1],
+		(hl->nranges - n - 1) * sizeof(hostrange_t));
 	hl->nranges--;
 	hl->hr[hl->nranges] = NULL;
 	hostlist_shift_iterators(hl, n, 0, 1);
@@ -2458,6 +2451,20 @@ int _cmp(const void *hr1, const void *hr2)
 }
 
 
+/* return 1 if the ranges in hl are already in hostrange_cmp() order
+ * assumes that the hostlist hl has been locked by caller
+ */
+static int hostlist_is_sorted(hostlist_t hl)
+{
+	int i;
+
+	for (i = 1; i < hl->nranges; i++) {
+		if (hostrange_cmp(hl->hr[i - 1], hl->hr[i]) > 0)
+			return 0;
+	}
+	return 1;
+}
+
 void hostlist_sort(hostlist_t hl)
 {
 	hostlist_iterator_t i;
@@ -2468,7 +2475,9 @@ void hostlist_sort(hostlist_t hl)
 		return;
 	}
 
-	qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
+	/* most lists are built from node tables and are already sorted */
+	if (!hostlist_is_sorted(hl))
+		qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
 
 	/* reset all iterators */
 	for (i = hl->ilist; i; i = i->next)
@@ -2483,22 +2492,32 @@ void hostlist_sort(hostlist_t hl)
 
 /* search through hostlist for ranges that can be collapsed
  * does =not= delete any hosts
+ * ranges are compacted in a single pass rather than deleted one at a time
  */
 static void hostlist_collapse(hostlist_t hl)
 {
-	int i;
+	int i, j;
+	hostlist_iterator_t hli;
 
 	LOCK_HOSTLIST(hl);
-	for (i = hl->nranges - 1; i > 0; i--) {
-		hostrange_t hprev = hl->hr[i - 1];
+	for (i = 1, j = 0; i < hl->nranges; i++) {
+		hostrange_t hprev = hl->hr[j];
 		hostrange_t hnext = hl->hr[i];
 
 		if (hprev->hi == hnext->lo - 1 &&
 		    hostrange_prefix_cmp(hprev, hnext) == 0 &&
 		    hostrange_width_combine(hprev, hnext)) {
 			hprev->hi = hnext->hi;
-			hostlist_delete_range(hl, i);
-		}
+			hostrange_destroy(hnext);
+		} else
+			hl->hr[++j] = hnext;
+	}
+	if (hl->nranges > (j + 1)) {
+		for (i = j + 1; i < hl->nranges; i++)
+			hl->hr[i] = NULL;
+		hl->nranges = j + 1;
+		for (hli = hl->ilist; hli; hli = hli->next)
+			hostlist_iterator_reset(hli);
 	}
 	UNLOCK_HOSTLIST(hl);
 }
@@ -2577,19 +2596,28 @@ static int _attempt_range_join(hostlist_t hl, int loc)
 
 void hostlist_uniq(hostlist_t hl)
 {
-	int i = 1;
+	int i, j, ndup;
 	hostlist_iterator_t hli;
 	LOCK_HOSTLIST(hl);
 	if (hl->nranges <= 1) {
 		UNLOCK_HOSTLIST(hl);
 		return;
 	}
-	qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
+	if (!hostlist_is_sorted(hl))
+		qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
 
-	while (i < hl->nranges) {
-		if (_attempt_range_join(hl, i) < 0) /* No range join occurred */
-			i++;
+	/* join each range into the last kept one, compacting as we go */
+	for (i = 1, j = 0; i < hl->nranges; i++) {
+		ndup = hostrange_join(hl->hr[j], hl->hr[i]);
+		if (ndup >= 0) {
+			hostrange_destroy(hl->hr[i]);
+			hl->nhosts -= ndup;
+		} else
+			hl->hr[++j] = hl->hr[i];
 	}
+	for (i = j + 1; i < hl->nranges; i++)
+		hl->hr[i] = NULL;
+	hl->nranges = j + 1;
 
 	/* reset all iterators */
 	for (hli = hl->ilist; hli; hli = hli->next)
@@ -3578,7 +3606,7 @@ void hostset_destroy(hostset_t set)
  */
 static int hostset_insert_range(hostset_t set, hostrange_t hr)
 {
-	int i = 0;
+	int i = 0, lo, hi;
 	int inserted = 0;
 	int nhosts = 0;
 	int ndups = 0;
@@ -3591,7 +3619,19 @@ static int hostset_insert_range(hostset_t set, hostrange_t hr)
 
 	nhosts = hostrange_count(hr);
 
-	for (i = 0; i < hl->nranges; i++) {
+	/* ranges in a hostset are kept sorted, binary search for the
+	 * first range that hr sorts before */
+	lo = 0;
+	hi = hl->nranges;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (hostrange_cmp(hr, hl->hr[mid]) <= 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	for (i = lo; i < hl->nranges; i++) {
 		if (hostrange_cmp(hr, hl->hr[i]) <= 0) {
 
 			if ((ndups = hostrange_join(hr, hl->hr[i])) >= 0)
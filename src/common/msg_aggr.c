@@ -55,6 +55,7 @@
 
 typedef struct {
 	pthread_mutex_t	aggr_mutex;
+	uint64_t	arrival_gap;	/* average usec between messages */
 	pthread_cond_t	cond;
 	uint32_t        debug_flags;
 	bool		max_msgs;
@@ -64,6 +65,7 @@ typedef struct {
 	pthread_mutex_t	mutex;
 	slurm_addr_t    node_addr;
 	bool            running;
+	struct timeval	last_arrival;
 	pthread_t       thread_id;
 	uint64_t        window;
 } msg_collection_type_t;
@@ -181,6 +183,47 @@ static int _send_to_next_collector(slurm_msg_t *msg)
 	return rc;
 }
 
+/*
+ * Note the arrival of a message in the average time between messages,
+ * call with msg_collection.mutex held. A long quiet period counts as
+ * twice the window so that a burst is noticed after a few messages.
+ */
+static void _note_arrival(void)
+{
+	struct timeval now;
+	uint64_t gap, max_gap = msg_collection.window * USEC_IN_MSEC * 2;
+
+	gettimeofday(&now, NULL);
+	if (msg_collection.last_arrival.tv_sec) {
+		gap = ((now.tv_sec - msg_collection.last_arrival.tv_sec) *
+		       USEC_IN_SEC) +
+		      now.tv_usec - msg_collection.last_arrival.tv_usec;
+		gap = MIN(gap, max_gap);
+	} else
+		gap = max_gap;
+	msg_collection.last_arrival = now;
+
+	msg_collection.arrival_gap =
+		((msg_collection.arrival_gap * 3) + gap) / 4;
+}
+
+/*
+ * How long to collect messages once one has arrived, in usec. The window
+ * is only as long as it takes to collect max_msg_cnt messages at the
+ * recent arrival rate, and none at all if no other message is expected
+ * within the configured window, so that a lone message is not delayed.
+ * Call with msg_collection.mutex held.
+ */
+static uint64_t _window_usec(void)
+{
+	uint64_t window = msg_collection.window * USEC_IN_MSEC;
+	uint64_t gap = msg_collection.arrival_gap;
+
+	if (gap >= window)
+		return 0;
+	return MIN(window, gap * msg_collection.max_msg_cnt);
+}
+
 /*
  * _msg_aggregation_sender()
  *
@@ -194,6 +237,7 @@ static void * _msg_aggregation_sender(void *arg)
 	struct timespec timeout;
 	slurm_msg_t msg;
 	composite_msg_t cmp;
+	uint64_t window;
 
 	slurm_mutex_lock(&msg_collection.mutex);
 	msg_collection.running = 1;
@@ -208,16 +252,22 @@ static void * _msg_aggregation_sender(void *arg)
 			break;
 
 		/* A msg has been collected; start new window */
-		gettimeofday(&now, NULL);
-		timeout.tv_sec = now.tv_sec +
-			(msg_collection.window / MSEC_IN_SEC);
-		timeout.tv_nsec = (now.tv_usec * NSEC_IN_USEC) +
-			(NSEC_IN_MSEC * (msg_collection.window % MSEC_IN_SEC));
-		timeout.tv_sec += timeout.tv_nsec / NSEC_IN_SEC;
-		timeout.tv_nsec %= NSEC_IN_SEC;
-
-		slurm_cond_timedwait(&msg_collection.cond,
-				     &msg_collection.mutex, &timeout);
+		window = _window_usec();
+		if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE)
+			info("msg aggr: collecting for %"PRIu64" usec, messages arrive every %"PRIu64" usec",
+			     window, msg_collection.arrival_gap);
+		if (window && !msg_collection.max_msgs) {
+			gettimeofday(&now, NULL);
+			timeout.tv_sec = now.tv_sec + (window / USEC_IN_SEC);
+			timeout.tv_nsec = (now.tv_usec +
+					   (window % USEC_IN_SEC)) *
+					  NSEC_IN_USEC;
+			timeout.tv_sec += timeout.tv_nsec / NSEC_IN_SEC;
+			timeout.tv_nsec %= NSEC_IN_SEC;
+
+			slurm_cond_timedwait(&msg_collection.cond,
+					     &msg_collection.mutex, &timeout);
+		}
 
 		if (!msg_collection.running &&
 		    !list_count(msg_collection.msg_list))
@@ -275,6 +325,7 @@ extern void msg_aggr_sender_init(char *host, uint16_t port, uint64_t window,
 	slurm_set_addr(&msg_collection.node_addr, port, host);
 	msg_collection.window = window;
 	msg_collection.max_msg_cnt = max_msg_cnt;
+	msg_collection.arrival_gap = window * USEC_IN_MSEC * 2;
 	msg_collection.msg_aggr_list = list_create(_msg_aggr_free);
 	msg_collection.msg_list = list_create(slurm_free_comp_msg_list);
 	msg_collection.max_msgs = false;
@@ -343,6 +394,7 @@ extern void msg_aggr_add_msg(slurm_msg_t *msg, bool wait,
 	}
 
 	msg->msg_index = msg_index++;
+	_note_arrival();
 
 	/* Add msg to message collection */
 	list_append(msg_collection.msg_list, msg);
@@ -680,6 +680,7 @@ extern struct node_record *create_node_record (
 	node_ptr->owner = NO_VAL;
 	node_ptr->mcs_label = NULL;
 	node_ptr->next_state = NO_VAL;
+	node_ptr->leaf_switch = -1;
 	node_ptr->protocol_version = SLURM_MIN_PROTOCOL_VERSION;
 	xassert (node_ptr->magic = NODE_MAGIC)  /* set value */;
 	return node_ptr;
@@ -169,6 +169,10 @@ struct node_record {
 	char *tres_fmt_str;		/* tres this node has */
 	uint64_t *tres_cnt;		/* tres this node has. NO_PACK*/
 	char *mcs_label;		/* mcs_label if mcs plugin in use */
+	int leaf_switch;		/* index of leaf switch in
+					 * switch_record_table, -1 if none,
+					 * -2 if on multiple leaf switches.
+					 * NO_PACK, set by topology/tree */
 };
 extern struct node_record *node_record_table_ptr;  /* ptr to node records */
 extern int node_record_count;		/* count in node_record_table_ptr */
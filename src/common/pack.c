@@ -45,6 +45,7 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -66,6 +67,17 @@
 #define MAX_ARRAY_LEN_MEDIUM	1000000
 #define MAX_ARRAY_LEN_LARGE	10000000
 
+/*
+ * Buffer pool size classes are BUF_SIZE << class, so 16KB through 1MB.
+ * Each class keeps at most BUF_POOL_CLASS_BYTES worth of buffers (but no
+ * fewer than BUF_POOL_MIN_DEPTH of them) so a burst of large responses
+ * does not leave the daemon holding on to a lot of memory.
+ */
+#define BUF_POOL_CLASSES	7
+#define BUF_POOL_CLASS_BYTES	(1024 * 1024)
+#define BUF_POOL_MIN_DEPTH	4
+#define BUF_POOL_MAX_DEPTH	(BUF_POOL_CLASS_BYTES / BUF_SIZE)
+
 /*
  * Define slurm-specific aliases for use by plugins, see slurm_xlator.h
  * for details.
@@ -110,6 +122,145 @@ strong_alias(unpackstr_array,	slurm_unpackstr_array);
 strong_alias(packmem_array,	slurm_packmem_array);
 strong_alias(unpackmem_array,	slurm_unpackmem_array);
 
+typedef struct {
+	char *head[BUF_POOL_MAX_DEPTH];
+	int count;
+	int depth;
+} buf_pool_class_t;
+
+static pthread_mutex_t buf_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static buf_pool_class_t buf_pool[BUF_POOL_CLASSES];
+static buf_pool_stats_t buf_pool_stats_rec;
+static bool buf_pool_inited = false;
+
+static void _buf_pool_atfork_child(void)
+{
+	slurm_mutex_init(&buf_pool_lock);
+}
+
+/* Call with buf_pool_lock held */
+static void _buf_pool_init(void)
+{
+	int i;
+
+	if (buf_pool_inited)
+		return;
+	for (i = 0; i < BUF_POOL_CLASSES; i++) {
+		buf_pool[i].depth = MAX(BUF_POOL_MIN_DEPTH,
+					BUF_POOL_CLASS_BYTES / (BUF_SIZE << i));
+	}
+	pthread_atfork(NULL, NULL, _buf_pool_atfork_child);
+	buf_pool_inited = true;
+}
+
+/*
+ * _buf_pool_get - return an xmalloc()'d block of at least size bytes,
+ * reusing a block released by free_buf() when one of the right size class
+ * is available. The contents are not initialized.
+ */
+static char *_buf_pool_get(uint32_t size)
+{
+	char *head = NULL;
+	int i;
+
+	/* Small and huge requests go straight to the allocator */
+	if ((size < BUF_SIZE) ||
+	    (size > (BUF_SIZE << (BUF_POOL_CLASSES - 1))))
+		return xmalloc_nz(size);
+
+	for (i = 0; (BUF_SIZE << i) < size; i++)
+		;
+
+	slurm_mutex_lock(&buf_pool_lock);
+	_buf_pool_init();
+	if (buf_pool[i].count) {
+		head = buf_pool[i].head[--buf_pool[i].count];
+		buf_pool_stats_rec.cached--;
+		buf_pool_stats_rec.hits++;
+	} else
+		buf_pool_stats_rec.misses++;
+	slurm_mutex_unlock(&buf_pool_lock);
+
+	/*
+	 * Round misses up to the class size so the block lands back in
+	 * this class when it is released.
+	 */
+	if (!head)
+		head = xmalloc_nz(BUF_SIZE << i);
+
+	return head;
+}
+
+/*
+ * _buf_pool_put - keep a block released by free_buf() for reuse, or xfree()
+ * it if it is outside the pooled sizes or its size class is full.
+ */
+static void _buf_pool_put(char *head)
+{
+	size_t size = xsize(head);
+	int i;
+
+	/*
+	 * A block of size [BUF_SIZE << i, BUF_SIZE << (i + 1)) can satisfy
+	 * any request of class i. Blocks grown well past the largest class
+	 * are not worth holding on to.
+	 */
+	if ((size < BUF_SIZE) ||
+	    (size >= (BUF_SIZE << BUF_POOL_CLASSES))) {
+		xfree(head);
+		return;
+	}
+	for (i = BUF_POOL_CLASSES - 1; (BUF_SIZE << i) > size; i--)
+		;
+
+	slurm_mutex_lock(&buf_pool_lock);
+	_buf_pool_init();
+	if (buf_pool[i].count < buf_pool[i].depth) {
+		buf_pool[i].head[buf_pool[i].count++] = head;
+		head = NULL;
+		buf_pool_stats_rec.returns++;
+		buf_pool_stats_rec.cached++;
+		if (buf_pool_stats_rec.cached > buf_pool_stats_rec.cached_max)
+			buf_pool_stats_rec.cached_max =
+				buf_pool_stats_rec.cached;
+	} else
+		buf_pool_stats_rec.drops++;
+	slurm_mutex_unlock(&buf_pool_lock);
+
+	xfree(head);
+}
+
+/*
+ * get_buf_pool_stats - report buffer pool activity since the last reset
+ * IN/OUT stats - filled in with the current counters
+ * IN reset - clear the counters after reading them, the high-water mark
+ *	      restarts from the number of buffers currently cached
+ */
+void get_buf_pool_stats(buf_pool_stats_t *stats, bool reset)
+{
+	slurm_mutex_lock(&buf_pool_lock);
+	if (stats)
+		memcpy(stats, &buf_pool_stats_rec, sizeof(buf_pool_stats_t));
+	if (reset) {
+		buf_pool_stats_rec.hits = 0;
+		buf_pool_stats_rec.misses = 0;
+		buf_pool_stats_rec.returns = 0;
+		buf_pool_stats_rec.drops = 0;
+		buf_pool_stats_rec.cached_max = buf_pool_stats_rec.cached;
+	}
+	slurm_mutex_unlock(&buf_pool_lock);
+}
+
+/*
+ * alloc_buf_data - return xmalloc()'d, uninitialized memory of at least
+ * size bytes for use as the data of a buffer later passed to create_buf(),
+ * drawing from the buffer pool when possible.
+ */
+char *alloc_buf_data(uint32_t size)
+{
+	return _buf_pool_get(size);
+}
+
 /* Basic buffer management routines */
 /* create_buf - create a buffer with the supplied contents, contents must
  * be xalloc'ed */
@@ -183,8 +334,8 @@ void free_buf(Buf my_buf)
 	assert(my_buf->magic == BUF_MAGIC);
 	if (my_buf->mmaped)
 		munmap(my_buf->head, my_buf->size);
-	else
-		xfree(my_buf->head);
+	else if (my_buf->head)
+		_buf_pool_put(my_buf->head);
 
 	xfree(my_buf);
 }
@@ -204,6 +355,21 @@ void grow_buf (Buf buffer, uint32_t size)
 	xrealloc_nz(buffer->head, buffer->size);
 }
 
+/*
+ * _expand_buf - grow a buffer by at least size bytes. Large buffers grow by
+ * half of their current size so that packing a multi-hundred MB response
+ * is not copied again for every additional BUF_SIZE. The caller has already
+ * verified that buffer->size + size does not exceed MAX_BUF_SIZE.
+ */
+static void _expand_buf(Buf buffer, uint32_t size)
+{
+	uint64_t new_size = (uint64_t) buffer->size +
+			    MAX(size, buffer->size / 2);
+
+	buffer->size = MIN(new_size, MAX_BUF_SIZE);
+	xrealloc_nz(buffer->head, buffer->size);
+}
+
 /* init_buf - create an empty buffer of the given size */
 Buf init_buf(uint32_t size)
 {
@@ -220,7 +386,8 @@ Buf init_buf(uint32_t size)
 	my_buf->magic = BUF_MAGIC;
 	my_buf->size = size;
 	my_buf->processed = 0;
-	my_buf->head = xmalloc(size);
+	my_buf->head = _buf_pool_get(size);
+	memset(my_buf->head, 0, size);
 	my_buf->mmaped = false;
 	return my_buf;
 }
@@ -256,8 +423,7 @@ void pack_time(time_t val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &n64, sizeof(n64));
@@ -305,8 +471,7 @@ void 	packdouble(double val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
@@ -431,8 +596,7 @@ void pack64(uint64_t val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
@@ -470,8 +634,7 @@ void pack32(uint32_t val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
@@ -717,8 +880,7 @@ void pack16(uint16_t val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
@@ -755,8 +917,7 @@ void pack8(uint8_t val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &val, sizeof(uint8_t));
@@ -827,8 +988,7 @@ void packmem(char *valp, uint32_t size_val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, size_val + BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
@@ -1077,8 +1237,7 @@ void packstr_array(char **valp, uint32_t size_val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
@@ -1144,8 +1303,7 @@ void packmem_array(char *valp, uint32_t size_val, Buf buffer)
 			      MAX_BUF_SIZE);
 			return;
 		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc_nz(buffer->head, buffer->size);
+		_expand_buf(buffer, size_val + BUF_SIZE);
 	}
 
 	memcpy(&buffer->head[buffer->processed], valp, size_val);
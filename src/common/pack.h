@@ -70,6 +70,15 @@ struct slurm_buf {
 
 typedef struct slurm_buf * Buf;
 
+typedef struct {
+	uint64_t hits;		/* init_buf() served from the pool */
+	uint64_t misses;	/* pooled size, but no buffer was cached */
+	uint64_t returns;	/* free_buf() kept the buffer for reuse */
+	uint64_t drops;		/* free_buf() found the size class full */
+	uint32_t cached;	/* buffers currently held by the pool */
+	uint32_t cached_max;	/* high-water mark of cached */
+} buf_pool_stats_t;
+
 #define get_buf_data(__buf)		(__buf->head)
 #define get_buf_offset(__buf)		(__buf->processed)
 #define set_buf_offset(__buf,__val)	(__buf->processed = __val)
@@ -82,6 +91,8 @@ void	free_buf(Buf my_buf);
 Buf	init_buf(uint32_t size);
 void    grow_buf (Buf my_buf, uint32_t size);
 void	*xfer_buf_data(Buf my_buf);
+char	*alloc_buf_data(uint32_t size);
+void	get_buf_pool_stats(buf_pool_stats_t *stats, bool reset);
 
 void	pack_time(time_t val, Buf buffer);
 int	unpack_time(time_t *valp, Buf buffer);
@@ -40,6 +40,8 @@
 \*****************************************************************************/
 
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <regex.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -1109,9 +1111,13 @@ static char *_parse_for_format(s_p_hashtbl_t *f_hashtbl, char *path)
  * directive but the included file contained errors.  Returns 0 if
  * no include directive is found.
  */
+static int _parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
+		       char *filename, bool ignore_new, List files);
+
 static int _parse_include_directive(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
 				    const char *line, char **leftover,
-				    bool ignore_new, char *slurm_conf_path)
+				    bool ignore_new, char *slurm_conf_path,
+				    List files)
 {
 	char *ptr;
 	char *fn_start, *fn_stop;
@@ -1139,7 +1145,8 @@ static int _parse_include_directive(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
 			return -1;
 		path_name = _add_full_path(file_name, slurm_conf_path);
 		xfree(file_name);
-		rc = s_p_parse_file(hashtbl, hash_val, path_name, ignore_new);
+		rc = _parse_file(hashtbl, hash_val, path_name, ignore_new,
+				 files);
 		xfree(path_name);
 		if (rc == SLURM_SUCCESS)
 			return 1;
@@ -1150,8 +1157,8 @@ static int _parse_include_directive(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
 	}
 }
 
-int s_p_parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val, char *filename,
-		   bool ignore_new)
+static int _parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
+		       char *filename, bool ignore_new, List files)
 {
 	FILE *f;
 	char *leftover = NULL;
@@ -1180,6 +1187,8 @@ int s_p_parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val, char *filename,
 		if (stat(filename, &stat_buf) >= 0)
 			break;
 	}
+	if (files)
+		list_append(files, xstrdup(filename));
 	if (stat_buf.st_size == 0) {
 		info("s_p_parse_file: file \"%s\" is empty", filename);
 		return SLURM_SUCCESS;
@@ -1204,7 +1213,7 @@ int s_p_parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val, char *filename,
 
 		inc_rc = _parse_include_directive(hashtbl, hash_val,
 						  line, &leftover, ignore_new,
-						  filename);
+						  filename, files);
 		if (inc_rc == 0) {
 			_parse_next_key(hashtbl, line, &leftover, ignore_new);
 		} else if (inc_rc < 0) {
@@ -1237,6 +1246,49 @@ int s_p_parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val, char *filename,
 	return rc;
 }
 
+int s_p_parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val, char *filename,
+		   bool ignore_new)
+{
+	return _parse_file(hashtbl, hash_val, filename, ignore_new, NULL);
+}
+
+extern int s_p_parse_file_list(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
+			       char *filename, bool ignore_new, List files)
+{
+	return _parse_file(hashtbl, hash_val, filename, ignore_new, files);
+}
+
+extern int s_p_hash_file(char *filename, uint32_t *hash_val)
+{
+	struct stat stat_buf;
+	char *data;
+	ssize_t len;
+	size_t offset = 0;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) < 0)
+		return SLURM_ERROR;
+	if (fstat(fd, &stat_buf) < 0) {
+		close(fd);
+		return SLURM_ERROR;
+	}
+	data = xmalloc(stat_buf.st_size + 1);
+	while (offset < stat_buf.st_size) {
+		len = read(fd, data + offset, stat_buf.st_size - offset);
+		if ((len < 0) && (errno == EINTR))
+			continue;
+		if (len <= 0)
+			break;
+		offset += len;
+	}
+	close(fd);
+
+	*hash_val = 0;
+	_compute_hash_val(hash_val, data);
+	xfree(data);
+	return (offset == stat_buf.st_size) ? SLURM_SUCCESS : SLURM_ERROR;
+}
+
 int s_p_parse_buffer(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
 		     Buf buffer, bool ignore_new)
 {
@@ -2307,6 +2359,193 @@ unpack_error:
 	return NULL;
 }
 
+/* Return true if s_p_pack_values() can pack the value of p */
+static bool _value_packable(s_p_values_t *p)
+{
+	if (!p->key || !p->data_count || (p->type == S_P_IGNORE))
+		return false;
+	return true;
+}
+
+extern int s_p_pack_values(const s_p_hashtbl_t *hashtbl,
+			   void (*pack_array)(const char *key, void *data,
+					      Buf buffer),
+			   Buf buffer)
+{
+	s_p_values_t *p;
+	uint32_t cnt = 0;
+	int i, j;
+
+	for (i = 0; i < CONF_HASH_LEN; i++) {
+		for (p = hashtbl[i]; p; p = p->next) {
+			if (!_value_packable(p))
+				continue;
+			/* the format of handler data is not known here */
+			if (p->handler && (p->type != S_P_ARRAY))
+				return SLURM_ERROR;
+			cnt++;
+		}
+	}
+	pack32(cnt, buffer);
+
+	for (i = 0; i < CONF_HASH_LEN; i++) {
+		for (p = hashtbl[i]; p; p = p->next) {
+			if (!_value_packable(p))
+				continue;
+			packstr(p->key, buffer);
+			pack16((uint16_t) p->type, buffer);
+			pack16((uint16_t) p->operator, buffer);
+			pack32((uint32_t) p->data_count, buffer);
+
+			switch (p->type) {
+			case S_P_STRING:
+			case S_P_PLAIN_STRING:
+				packstr((char *) p->data, buffer);
+				break;
+			case S_P_LONG:
+				pack64((uint64_t) *(long *) p->data, buffer);
+				break;
+			case S_P_UINT16:
+				pack16(*(uint16_t *) p->data, buffer);
+				break;
+			case S_P_UINT32:
+				pack32(*(uint32_t *) p->data, buffer);
+				break;
+			case S_P_UINT64:
+				pack64(*(uint64_t *) p->data, buffer);
+				break;
+			case S_P_BOOLEAN:
+				packbool(*(bool *) p->data, buffer);
+				break;
+			case S_P_FLOAT:
+				packfloat(*(float *) p->data, buffer);
+				break;
+			case S_P_DOUBLE:
+				packdouble(*(double *) p->data, buffer);
+				break;
+			case S_P_LONG_DOUBLE:
+				packlongdouble(*(long double *) p->data,
+					       buffer);
+				break;
+			case S_P_ARRAY:
+				if (!p->handler) {
+					for (j = 0; j < p->data_count; j++)
+						packstr(((char **) p->data)[j],
+							buffer);
+					break;
+				}
+				if (!pack_array)
+					return SLURM_ERROR;
+				for (j = 0; j < p->data_count; j++)
+					pack_array(p->key,
+						   ((void **) p->data)[j],
+						   buffer);
+				break;
+			default:
+				/* S_P_POINTER, S_P_LINE and S_P_EXPLINE */
+				return SLURM_ERROR;
+			}
+		}
+	}
+
+	return SLURM_SUCCESS;
+}
+
+extern int s_p_unpack_values(s_p_hashtbl_t *hashtbl,
+			     int (*unpack_array)(const char *key, void **data,
+						 Buf buffer),
+			     Buf buffer)
+{
+	s_p_values_t *p;
+	uint32_t cnt, data_count, uint32_tmp;
+	uint16_t type, operator;
+	uint64_t uint64_tmp;
+	char *key = NULL;
+	void **array;
+	int i, j;
+
+	safe_unpack32(&cnt, buffer);
+	for (i = 0; i < cnt; i++) {
+		safe_unpackstr_xmalloc(&key, &uint32_tmp, buffer);
+		safe_unpack16(&type, buffer);
+		safe_unpack16(&operator, buffer);
+		safe_unpack32(&data_count, buffer);
+
+		if (!key || !(p = _conf_hashtbl_lookup(hashtbl, key)) ||
+		    (p->type != type) || p->data_count || !data_count)
+			goto unpack_error;
+		p->operator = operator;
+		/* set first, so that s_p_hashtbl_destroy() frees the data */
+		if (p->type != S_P_ARRAY)
+			p->data_count = data_count;
+
+		switch (p->type) {
+		case S_P_STRING:
+		case S_P_PLAIN_STRING:
+			safe_unpackstr_xmalloc((char **) &p->data,
+					       &uint32_tmp, buffer);
+			break;
+		case S_P_LONG:
+			safe_unpack64(&uint64_tmp, buffer);
+			p->data = xmalloc(sizeof(long));
+			*(long *) p->data = (long) uint64_tmp;
+			break;
+		case S_P_UINT16:
+			p->data = xmalloc(sizeof(uint16_t));
+			safe_unpack16((uint16_t *) p->data, buffer);
+			break;
+		case S_P_UINT32:
+			p->data = xmalloc(sizeof(uint32_t));
+			safe_unpack32((uint32_t *) p->data, buffer);
+			break;
+		case S_P_UINT64:
+			p->data = xmalloc(sizeof(uint64_t));
+			safe_unpack64((uint64_t *) p->data, buffer);
+			break;
+		case S_P_BOOLEAN:
+			p->data = xmalloc(sizeof(bool));
+			safe_unpackbool((bool *) p->data, buffer);
+			break;
+		case S_P_FLOAT:
+			p->data = xmalloc(sizeof(float));
+			safe_unpackfloat((float *) p->data, buffer);
+			break;
+		case S_P_DOUBLE:
+			p->data = xmalloc(sizeof(double));
+			safe_unpackdouble((double *) p->data, buffer);
+			break;
+		case S_P_LONG_DOUBLE:
+			p->data = xmalloc(sizeof(long double));
+			safe_unpacklongdouble((long double *) p->data,
+					      buffer);
+			break;
+		case S_P_ARRAY:
+			if (p->handler && !unpack_array)
+				goto unpack_error;
+			p->data = array = xcalloc(data_count, sizeof(void *));
+			for (j = 0; j < data_count; j++) {
+				if (!p->handler)
+					safe_unpackstr_xmalloc(
+						(char **) &array[j],
+						&uint32_tmp, buffer);
+				else if (unpack_array(key, &array[j], buffer))
+					goto unpack_error;
+				p->data_count++;
+			}
+			break;
+		default:
+			goto unpack_error;
+		}
+		xfree(key);
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	xfree(key);
+	return SLURM_ERROR;
+}
+
 extern void transfer_s_p_options(s_p_options_t **full_options,
 				 s_p_options_t *options,
 				 int *full_options_cnt)
@@ -310,6 +310,21 @@ void s_p_hashtbl_destroy(s_p_hashtbl_t *hashtbl);
 int s_p_parse_file(s_p_hashtbl_t *hashtbl, uint32_t *hash_val, char *filename,
 		   bool ignore_new);
 
+/*
+ * Same as s_p_parse_file(), also recording the files read.
+ * IN/OUT files - list of xstrdup()'ed paths, filename and every file it
+ *	includes are appended to it
+ */
+extern int s_p_parse_file_list(s_p_hashtbl_t *hashtbl, uint32_t *hash_val,
+			       char *filename, bool ignore_new, List files);
+
+/*
+ * Compute the hash_val of a single file, as s_p_parse_file() would if the
+ * file did not include any other.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the file can not be read
+ */
+extern int s_p_hash_file(char *filename, uint32_t *hash_val);
+
 /* Returns SLURM_SUCCESS if buffer was opened and parse correctly.
  * buffer must be a valid Buf bufferonly containing strings.The parsing
  * stops at the first non string content extracted.
@@ -638,6 +653,29 @@ extern Buf s_p_pack_hashtbl(const s_p_hashtbl_t *hashtbl,
  */
 extern s_p_hashtbl_t *s_p_unpack_hashtbl(Buf buffer);
 
+/*
+ * Pack the values set in hashtbl, so that s_p_unpack_values() can restore
+ * them without parsing the file again. Each element of an S_P_ARRAY with a
+ * handler is packed with pack_array().
+ * RET SLURM_SUCCESS or SLURM_ERROR if a value can not be packed: it is of
+ *	type S_P_POINTER, S_P_LINE or S_P_EXPLINE, or was set by a handler
+ *	for another type than S_P_ARRAY
+ */
+extern int s_p_pack_values(const s_p_hashtbl_t *hashtbl,
+			   void (*pack_array)(const char *key, void *data,
+					      Buf buffer),
+			   Buf buffer);
+
+/*
+ * Unpack values packed by s_p_pack_values() into hashtbl, which must have
+ * been created from the same options and not hold any value yet.
+ * RET SLURM_SUCCESS or SLURM_ERROR, the caller must then destroy hashtbl
+ */
+extern int s_p_unpack_values(s_p_hashtbl_t *hashtbl,
+			     int (*unpack_array)(const char *key, void **data,
+						 Buf buffer),
+			     Buf buffer);
+
 /*
  * copy options onto the end of full_options
  * IN/OUT full_options
@@ -79,6 +79,7 @@
 #include "src/common/slurm_accounting_storage.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
+#include "src/common/slurm_protocol_pack.h"
 #include "src/common/slurm_resource_info.h"
 #include "src/common/slurm_rlimits_info.h"
 #include "src/common/slurm_selecttype_info.h"
@@ -119,11 +120,13 @@ static s_p_hashtbl_t *default_partition_tbl;
 static bool	local_test_config = false;
 static int	local_test_config_rc = SLURM_SUCCESS;
 static bool     no_addr_cache = false;
+static uint32_t compress_min_size = 0;	/* CompressMinSize, 0 if unset */
 
 inline static void _normalize_debug_level(uint16_t *level);
 static int _init_slurm_conf(const char *file_name);
 
 #define NAME_HASH_LEN 512
+#define CONF_CACHE_VERSION "CONF_CACHE_002"
 typedef struct names_ll_s {
 	char *alias;	/* NodeName */
 	char *hostname;	/* NodeHostname */
@@ -2550,6 +2553,16 @@ extern char *slurm_conf_get_nodename_from_addr(const char *node_addr)
 	return ret_name;
 }
 
+/*
+ * slurm_conf_compress_min_size - Return CommunicationParameters
+ * CompressMinSize as parsed when the configuration was last loaded,
+ * 0 if not configured
+ */
+extern uint32_t slurm_conf_compress_min_size(void)
+{
+	return compress_min_size;
+}
+
 /*
  * slurm_conf_get_aliased_nodename - Return the NodeName for the
  * complete hostname string returned by gethostname if there is
@@ -3217,11 +3230,493 @@ end:
 	return (rc);
 }
 
+static void _pack_conf_downnodes(slurm_conf_downnodes_t *n, Buf buffer)
+{
+	packstr(n->nodenames, buffer);
+	packstr(n->reason, buffer);
+	packstr(n->state, buffer);
+}
+
+static int _unpack_conf_downnodes(void **out, Buf buffer)
+{
+	slurm_conf_downnodes_t *n = xmalloc(sizeof(slurm_conf_downnodes_t));
+	uint32_t uint32_tmp;
+
+	safe_unpackstr_xmalloc(&n->nodenames, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->reason, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->state, &uint32_tmp, buffer);
+	*out = n;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	_destroy_downnodes(n);
+	return SLURM_ERROR;
+}
+
+static void _pack_conf_frontend(slurm_conf_frontend_t *n, Buf buffer)
+{
+	packstr(n->allow_groups, buffer);
+	packstr(n->allow_users, buffer);
+	packstr(n->deny_groups, buffer);
+	packstr(n->deny_users, buffer);
+	packstr(n->frontends, buffer);
+	packstr(n->addresses, buffer);
+	pack16(n->port, buffer);
+	packstr(n->reason, buffer);
+	pack16(n->node_state, buffer);
+}
+
+static int _unpack_conf_frontend(void **out, Buf buffer)
+{
+	slurm_conf_frontend_t *n = xmalloc(sizeof(slurm_conf_frontend_t));
+	uint32_t uint32_tmp;
+
+	safe_unpackstr_xmalloc(&n->allow_groups, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->allow_users, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->deny_groups, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->deny_users, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->frontends, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->addresses, &uint32_tmp, buffer);
+	safe_unpack16(&n->port, buffer);
+	safe_unpackstr_xmalloc(&n->reason, &uint32_tmp, buffer);
+	safe_unpack16(&n->node_state, buffer);
+	*out = n;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	destroy_frontend(n);
+	return SLURM_ERROR;
+}
+
+static void _pack_conf_node(slurm_conf_node_t *n, Buf buffer)
+{
+	packstr(n->nodenames, buffer);
+	packstr(n->hostnames, buffer);
+	packstr(n->addresses, buffer);
+	packstr(n->gres, buffer);
+	packstr(n->feature, buffer);
+	packstr(n->port_str, buffer);
+	pack32(n->cpu_bind, buffer);
+	pack16(n->cpus, buffer);
+	packstr(n->cpu_spec_list, buffer);
+	pack16(n->boards, buffer);
+	pack16(n->sockets, buffer);
+	pack16(n->cores, buffer);
+	pack16(n->core_spec_cnt, buffer);
+	pack16(n->threads, buffer);
+	pack64(n->real_memory, buffer);
+	pack64(n->mem_spec_limit, buffer);
+	packstr(n->reason, buffer);
+	packstr(n->state, buffer);
+	pack32(n->tmp_disk, buffer);
+	packstr(n->tres_weights_str, buffer);
+	pack32(n->weight, buffer);
+}
+
+static int _unpack_conf_node(void **out, Buf buffer)
+{
+	slurm_conf_node_t *n = xmalloc(sizeof(slurm_conf_node_t));
+	uint32_t uint32_tmp;
+
+	safe_unpackstr_xmalloc(&n->nodenames, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->hostnames, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->addresses, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->gres, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->feature, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->port_str, &uint32_tmp, buffer);
+	safe_unpack32(&n->cpu_bind, buffer);
+	safe_unpack16(&n->cpus, buffer);
+	safe_unpackstr_xmalloc(&n->cpu_spec_list, &uint32_tmp, buffer);
+	safe_unpack16(&n->boards, buffer);
+	safe_unpack16(&n->sockets, buffer);
+	safe_unpack16(&n->cores, buffer);
+	safe_unpack16(&n->core_spec_cnt, buffer);
+	safe_unpack16(&n->threads, buffer);
+	safe_unpack64(&n->real_memory, buffer);
+	safe_unpack64(&n->mem_spec_limit, buffer);
+	safe_unpackstr_xmalloc(&n->reason, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&n->state, &uint32_tmp, buffer);
+	safe_unpack32(&n->tmp_disk, buffer);
+	safe_unpackstr_xmalloc(&n->tres_weights_str, &uint32_tmp, buffer);
+	safe_unpack32(&n->weight, buffer);
+	*out = n;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	_destroy_nodename(n);
+	return SLURM_ERROR;
+}
+
+static void _pack_conf_partition(slurm_conf_partition_t *p, Buf buffer)
+{
+	packstr(p->allow_alloc_nodes, buffer);
+	packstr(p->allow_accounts, buffer);
+	packstr(p->allow_groups, buffer);
+	packstr(p->allow_qos, buffer);
+	packstr(p->alternate, buffer);
+	packstr(p->billing_weights_str, buffer);
+	pack32(p->cpu_bind, buffer);
+	pack16(p->cr_type, buffer);
+	pack64(p->def_mem_per_cpu, buffer);
+	packbool(p->default_flag, buffer);
+	pack32(p->default_time, buffer);
+	packstr(p->deny_accounts, buffer);
+	packstr(p->deny_qos, buffer);
+	pack16(p->disable_root_jobs, buffer);
+	pack16(p->exclusive_user, buffer);
+	pack32(p->grace_time, buffer);
+	packbool(p->hidden_flag, buffer);
+	(void) slurm_pack_list(p->job_defaults_list, job_defaults_pack,
+			       buffer, SLURM_PROTOCOL_VERSION);
+	packbool(p->lln_flag, buffer);
+	pack32(p->max_cpus_per_node, buffer);
+	pack16(p->max_share, buffer);
+	pack32(p->max_time, buffer);
+	pack64(p->max_mem_per_cpu, buffer);
+	pack32(p->max_nodes, buffer);
+	pack32(p->min_nodes, buffer);
+	packstr(p->name, buffer);
+	packstr(p->nodes, buffer);
+	pack16(p->over_time_limit, buffer);
+	pack16(p->preempt_mode, buffer);
+	pack16(p->priority_job_factor, buffer);
+	pack16(p->priority_tier, buffer);
+	packstr(p->qos_char, buffer);
+	packbool(p->req_resv_flag, buffer);
+	packbool(p->root_only_flag, buffer);
+	pack16(p->state_up, buffer);
+	pack32(p->total_nodes, buffer);
+	pack32(p->total_cpus, buffer);
+}
+
+static int _unpack_conf_partition(void **out, Buf buffer)
+{
+	slurm_conf_partition_t *p = xmalloc(sizeof(slurm_conf_partition_t));
+	uint32_t uint32_tmp;
+
+	safe_unpackstr_xmalloc(&p->allow_alloc_nodes, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->allow_accounts, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->allow_groups, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->allow_qos, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->alternate, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->billing_weights_str, &uint32_tmp, buffer);
+	safe_unpack32(&p->cpu_bind, buffer);
+	safe_unpack16(&p->cr_type, buffer);
+	safe_unpack64(&p->def_mem_per_cpu, buffer);
+	safe_unpackbool(&p->default_flag, buffer);
+	safe_unpack32(&p->default_time, buffer);
+	safe_unpackstr_xmalloc(&p->deny_accounts, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->deny_qos, &uint32_tmp, buffer);
+	safe_unpack16(&p->disable_root_jobs, buffer);
+	safe_unpack16(&p->exclusive_user, buffer);
+	safe_unpack32(&p->grace_time, buffer);
+	safe_unpackbool(&p->hidden_flag, buffer);
+	if (slurm_unpack_list(&p->job_defaults_list, job_defaults_unpack,
+			      job_defaults_free, buffer,
+			      SLURM_PROTOCOL_VERSION) != SLURM_SUCCESS)
+		goto unpack_error;
+	safe_unpackbool(&p->lln_flag, buffer);
+	safe_unpack32(&p->max_cpus_per_node, buffer);
+	safe_unpack16(&p->max_share, buffer);
+	safe_unpack32(&p->max_time, buffer);
+	safe_unpack64(&p->max_mem_per_cpu, buffer);
+	safe_unpack32(&p->max_nodes, buffer);
+	safe_unpack32(&p->min_nodes, buffer);
+	safe_unpackstr_xmalloc(&p->name, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->nodes, &uint32_tmp, buffer);
+	safe_unpack16(&p->over_time_limit, buffer);
+	safe_unpack16(&p->preempt_mode, buffer);
+	safe_unpack16(&p->priority_job_factor, buffer);
+	safe_unpack16(&p->priority_tier, buffer);
+	safe_unpackstr_xmalloc(&p->qos_char, &uint32_tmp, buffer);
+	safe_unpackbool(&p->req_resv_flag, buffer);
+	safe_unpackbool(&p->root_only_flag, buffer);
+	safe_unpack16(&p->state_up, buffer);
+	safe_unpack32(&p->total_nodes, buffer);
+	safe_unpack32(&p->total_cpus, buffer);
+	*out = p;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	_destroy_partitionname(p);
+	return SLURM_ERROR;
+}
+
+static void _pack_conf_slurmctld_host(slurm_conf_server_t *p, Buf buffer)
+{
+	packstr(p->hostname, buffer);
+	packstr(p->addr, buffer);
+}
+
+static int _unpack_conf_slurmctld_host(void **out, Buf buffer)
+{
+	slurm_conf_server_t *p = xmalloc(sizeof(slurm_conf_server_t));
+	uint32_t uint32_tmp;
+
+	safe_unpackstr_xmalloc(&p->hostname, &uint32_tmp, buffer);
+	safe_unpackstr_xmalloc(&p->addr, &uint32_tmp, buffer);
+	*out = p;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	_destroy_slurmctld_host(p);
+	return SLURM_ERROR;
+}
+
+/* Pack one line of the S_P_ARRAY options of slurm_conf_options */
+static void _pack_conf_array(const char *key, void *data, Buf buffer)
+{
+	if (!xstrcasecmp(key, "DownNodes"))
+		_pack_conf_downnodes(data, buffer);
+	else if (!xstrcasecmp(key, "FrontendName"))
+		_pack_conf_frontend(data, buffer);
+	else if (!xstrcasecmp(key, "NodeName"))
+		_pack_conf_node(data, buffer);
+	else if (!xstrcasecmp(key, "PartitionName"))
+		_pack_conf_partition(data, buffer);
+	else if (!xstrcasecmp(key, "SlurmctldHost"))
+		_pack_conf_slurmctld_host(data, buffer);
+	else
+		fatal("%s: no pack function for %s", __func__, key);
+}
+
+static int _unpack_conf_array(const char *key, void **data, Buf buffer)
+{
+	if (!xstrcasecmp(key, "DownNodes"))
+		return _unpack_conf_downnodes(data, buffer);
+	if (!xstrcasecmp(key, "FrontendName"))
+		return _unpack_conf_frontend(data, buffer);
+	if (!xstrcasecmp(key, "NodeName"))
+		return _unpack_conf_node(data, buffer);
+	if (!xstrcasecmp(key, "PartitionName"))
+		return _unpack_conf_partition(data, buffer);
+	if (!xstrcasecmp(key, "SlurmctldHost"))
+		return _unpack_conf_slurmctld_host(data, buffer);
+	return SLURM_ERROR;
+}
+
+/*
+ * Pack what tells if a file changed: its size, modification time and
+ * hash_val. Checking the size and time first also means the file only has
+ * to be read once they match.
+ */
+static int _pack_conf_file_id(char *file, Buf buffer)
+{
+	struct stat stat_buf;
+	uint32_t hash_val;
+
+	if (stat(file, &stat_buf) ||
+	    (s_p_hash_file(file, &hash_val) != SLURM_SUCCESS))
+		return SLURM_ERROR;
+	packstr(file, buffer);
+	pack64(stat_buf.st_size, buffer);
+	pack_time(stat_buf.st_mtim.tv_sec, buffer);
+	pack32(stat_buf.st_mtim.tv_nsec, buffer);
+	pack32(hash_val, buffer);
+	return SLURM_SUCCESS;
+}
+
+/* RET true if the file packed by _pack_conf_file_id() has not changed */
+static bool _conf_file_unchanged(char *file, uint64_t size, time_t mtime,
+				 uint32_t mtime_nsec, uint32_t hash_val)
+{
+	struct stat stat_buf;
+	uint32_t cur_hash;
+
+	if (stat(file, &stat_buf) ||
+	    (stat_buf.st_size != size) ||
+	    (stat_buf.st_mtim.tv_sec != mtime) ||
+	    (stat_buf.st_mtim.tv_nsec != mtime_nsec))
+		return false;
+	if ((s_p_hash_file(file, &cur_hash) != SLURM_SUCCESS) ||
+	    (cur_hash != hash_val))
+		return false;
+	return true;
+}
+
+/*
+ * Check the header of a configuration cache: it must have been written by
+ * this version of Slurm, and none of the files it was built from may have
+ * changed since.
+ * IN name - path of slurm.conf
+ * OUT hash_val - hash_val of the files, as computed by s_p_parse_file()
+ * RET true if the values that follow can be used
+ */
+static bool _conf_cache_valid(Buf buffer, char *name, uint32_t *hash_val)
+{
+	char *str = NULL;
+	uint32_t i, cnt, file_hash, uint32_tmp, mtime_nsec;
+	uint64_t size;
+	time_t mtime;
+	bool valid = false;
+
+	safe_unpackstr_xmalloc(&str, &uint32_tmp, buffer);
+	if (xstrcmp(str, CONF_CACHE_VERSION))
+		goto unpack_error;
+	xfree(str);
+	safe_unpackstr_xmalloc(&str, &uint32_tmp, buffer);
+	if (xstrcmp(str, SLURM_VERSION_STRING))
+		goto unpack_error;
+	xfree(str);
+
+	safe_unpack32(&cnt, buffer);
+	for (i = 0; i < cnt; i++) {
+		safe_unpackstr_xmalloc(&str, &uint32_tmp, buffer);
+		safe_unpack64(&size, buffer);
+		safe_unpack_time(&mtime, buffer);
+		safe_unpack32(&mtime_nsec, buffer);
+		safe_unpack32(&file_hash, buffer);
+		if (((i == 0) && xstrcmp(str, name)) ||
+		    !_conf_file_unchanged(str, size, mtime, mtime_nsec,
+					  file_hash)) {
+			debug2("%s: %s changed", __func__, str);
+			goto unpack_error;
+		}
+		xfree(str);
+	}
+	safe_unpack32(hash_val, buffer);
+	valid = (cnt > 0);
+
+unpack_error:
+	xfree(str);
+	return valid;
+}
+
+/*
+ * Load the values of slurm.conf from its configuration cache, if that is
+ * still valid. Caller must lock conf_lock.
+ * IN name - path of slurm.conf
+ * RET SLURM_SUCCESS if conf_hashtbl and conf_ptr->hash_val were set
+ */
+static int _load_conf_cache(char *name)
+{
+	char *cache_file = xstrdup_printf("%s.cache", name);
+	s_p_hashtbl_t *hashtbl = NULL;
+	uint32_t hash_val;
+	Buf buffer;
+	int rc = SLURM_ERROR;
+
+	if (!(buffer = create_mmap_buf(cache_file))) {
+		xfree(cache_file);
+		return rc;
+	}
+	if (_conf_cache_valid(buffer, name, &hash_val)) {
+		hashtbl = s_p_hashtbl_create(slurm_conf_options);
+		rc = s_p_unpack_values(hashtbl, _unpack_conf_array, buffer);
+		if ((rc == SLURM_SUCCESS) && remaining_buf(buffer))
+			rc = SLURM_ERROR;
+	}
+	if (rc == SLURM_SUCCESS) {
+		s_p_hashtbl_destroy(conf_hashtbl);
+		conf_hashtbl = hashtbl;
+		conf_ptr->hash_val = hash_val;
+		debug("Read slurm.conf values from %s", cache_file);
+	} else {
+		s_p_hashtbl_destroy(hashtbl);
+		debug2("%s: not using %s", __func__, cache_file);
+	}
+	free_buf(buffer);
+	xfree(cache_file);
+	return rc;
+}
+
+/*
+ * Write the values just parsed from slurm.conf to its configuration cache,
+ * unless the cache is already up to date. Caller must lock conf_lock.
+ * IN name - path of slurm.conf
+ * IN files - path of slurm.conf and every file it includes
+ */
+static void _write_conf_cache(char *name, List files)
+{
+	char *cache_file = xstrdup_printf("%s.cache", name);
+	char *tmp_file = NULL, *file;
+	ListIterator iter;
+	uint32_t hash_val;
+	Buf buffer;
+	int fd = -1;
+
+	if ((buffer = create_mmap_buf(cache_file))) {
+		bool valid = _conf_cache_valid(buffer, name, &hash_val) &&
+			     (hash_val == conf_ptr->hash_val);
+		free_buf(buffer);
+		if (valid) {
+			xfree(cache_file);
+			return;
+		}
+	}
+
+	buffer = init_buf(BUF_SIZE);
+	packstr(CONF_CACHE_VERSION, buffer);
+	packstr(SLURM_VERSION_STRING, buffer);
+	pack32(list_count(files), buffer);
+	iter = list_iterator_create(files);
+	while ((file = list_next(iter))) {
+		if (_pack_conf_file_id(file, buffer) != SLURM_SUCCESS)
+			break;
+	}
+	list_iterator_destroy(iter);
+	if (file)
+		goto fini;
+	pack32(conf_ptr->hash_val, buffer);
+	if (s_p_pack_values(conf_hashtbl, _pack_conf_array, buffer) !=
+	    SLURM_SUCCESS)
+		goto fini;
+
+	/* Write to a new file and rename it, readers never see a part */
+	tmp_file = xstrdup_printf("%s.XXXXXX", cache_file);
+	if ((fd = mkstemp(tmp_file)) < 0) {
+		debug("%s: can not create %s: %m", __func__, tmp_file);
+		goto fini;
+	}
+	if (fchmod(fd, 0644))
+		goto rwfail;
+	safe_write(fd, get_buf_data(buffer), get_buf_offset(buffer));
+	if (close(fd)) {
+		fd = -1;
+		goto rwfail;
+	}
+	fd = -1;
+	if (rename(tmp_file, cache_file))
+		goto rwfail;
+	debug("Wrote slurm.conf values to %s", cache_file);
+	goto fini;
+
+rwfail:
+	debug("%s: can not write %s: %m", __func__, cache_file);
+	if (fd >= 0)
+		(void) close(fd);
+	(void) unlink(tmp_file);
+fini:
+	free_buf(buffer);
+	xfree(tmp_file);
+	xfree(cache_file);
+}
+
+extern void slurm_conf_pack_node_lines(Buf buffer)
+{
+	static char *keys[] = {
+		"DownNodes", "FrontendName", "NodeName", "PartitionName", NULL
+	};
+	void **ptr;
+	int count, i, j;
+
+	for (i = 0; keys[i]; i++) {
+		if (!s_p_get_array(&ptr, &count, keys[i], conf_hashtbl))
+			count = 0;
+		pack32(count, buffer);
+		for (j = 0; j < count; j++)
+			_pack_conf_array(keys[i], ptr[j], buffer);
+	}
+}
+
 /* caller must lock conf_lock */
 static int _init_slurm_conf(const char *file_name)
 {
-	char *name = (char *)file_name;
+	char *name = (char *)file_name, *tmp_ptr;
 	int rc = SLURM_SUCCESS;
+	/* daemons parse the file, to report errors, and refresh the cache */
+	bool daemon = run_in_daemon("slurmctld,slurmd");
+	List files = NULL;
 
 	if (name == NULL) {
 		name = getenv("SLURM_CONF");
@@ -3236,21 +3731,33 @@ static int _init_slurm_conf(const char *file_name)
 
 	/* init hash to 0 */
 	conf_ptr->hash_val = 0;
-	if ((_config_is_storage(conf_hashtbl, name) < 0) &&
-	    (s_p_parse_file(conf_hashtbl, &conf_ptr->hash_val, name, false)
-	     == SLURM_ERROR)) {
-		rc = SLURM_ERROR;
+	if (_config_is_storage(conf_hashtbl, name) >= 0) {
+		;
+	} else if (!daemon && (_load_conf_cache(name) == SLURM_SUCCESS)) {
+		;
+	} else {
+		files = list_create(slurm_destroy_char);
+		if (s_p_parse_file_list(conf_hashtbl, &conf_ptr->hash_val,
+					name, false, files) == SLURM_ERROR)
+			rc = SLURM_ERROR;
 	}
 	/* s_p_dump_values(conf_hashtbl, slurm_conf_options); */
 
 	if (_validate_and_set_defaults(conf_ptr, conf_hashtbl) == SLURM_ERROR)
 		rc = SLURM_ERROR;
+	if (files && daemon && (rc == SLURM_SUCCESS))
+		_write_conf_cache(name, files);
+	FREE_NULL_LIST(files);
 	conf_ptr->slurm_conf = xstrdup(name);
 
 	no_addr_cache = false;
 	if (xstrcasestr("NoAddrCache", conf_ptr->comm_params))
 		no_addr_cache = true;
 
+	compress_min_size = 0;
+	if ((tmp_ptr = xstrcasestr(conf_ptr->comm_params, "CompressMinSize=")))
+		compress_min_size = strtoul(tmp_ptr + 16, NULL, 10);
+
 	return rc;
 }
 
@@ -420,6 +420,13 @@ extern int slurm_conf_partition_array(slurm_conf_partition_t **ptr_array[]);
  */
 extern int slurm_conf_downnodes_array(slurm_conf_downnodes_t **ptr_array[]);
 
+/*
+ * Pack the DownNodes, FrontendName, NodeName and PartitionName lines of
+ * slurm.conf as they were read, to find out whether they changed from one
+ * read of the file to the next.
+ */
+extern void slurm_conf_pack_node_lines(Buf buffer);
+
 /*
  * slurm_reset_alias - Reset the address and hostname of a specific node name
  */
@@ -470,6 +477,13 @@ extern char *slurm_conf_get_nodeaddr(const char *node_hostname);
  */
 extern char *slurm_conf_get_nodename_from_addr(const char *node_addr);
 
+/*
+ * slurm_conf_compress_min_size - Return CommunicationParameters
+ * CompressMinSize, 0 if not configured. Parsed when the configuration is
+ * loaded, so it does not take slurm_conf_lock().
+ */
+extern uint32_t slurm_conf_compress_min_size(void);
+
 /*
  * slurm_conf_get_aliased_nodename - Return the NodeName matching an alias
  * of the local hostname
@@ -71,6 +71,8 @@ typedef struct {
 	int		(*pack)		(void *cred, Buf buf,
 					 uint16_t protocol_version);
 	void *		(*unpack)	(Buf buf, uint16_t protocol_version);
+	void *		(*dup)		(void *cred);
+	int		(*verify_session) (void *cred, void *session);
 } slurm_auth_ops_t;
 /*
  * These strings must be kept in the same order as the fields
@@ -87,6 +89,8 @@ static const char *syms[] = {
 	"slurm_auth_get_host",
 	"slurm_auth_pack",
 	"slurm_auth_unpack",
+	"slurm_auth_dup",
+	"slurm_auth_verify_session",
 };
 
 /*
@@ -256,6 +260,31 @@ int g_slurm_auth_verify(void *cred, char *auth_info)
 	return (*(ops[wrap->index].verify))(cred, auth_info);
 }
 
+void *g_slurm_auth_dup(void *cred)
+{
+	cred_wrapper_t *wrap = (cred_wrapper_t *) cred, *copy;
+
+	if (!wrap || slurm_auth_init(NULL) < 0)
+		return NULL;
+
+	copy = (*(ops[wrap->index].dup))(cred);
+	if (copy)
+		copy->index = wrap->index;
+	return copy;
+}
+
+int g_slurm_auth_verify_session(void *cred, void *session)
+{
+	cred_wrapper_t *wrap = (cred_wrapper_t *) cred;
+	cred_wrapper_t *swrap = (cred_wrapper_t *) session;
+
+	if (!wrap || !swrap || (wrap->index != swrap->index) ||
+	    slurm_auth_init(NULL) < 0)
+		return SLURM_ERROR;
+
+	return (*(ops[wrap->index].verify_session))(cred, session);
+}
+
 uid_t g_slurm_auth_get_uid(void *cred)
 {
 	cred_wrapper_t *wrap = (cred_wrapper_t *) cred;
@@ -92,6 +92,8 @@ extern int slurm_auth_index(void *cred);
 extern void *g_slurm_auth_create(int index, char *auth_info);
 extern int g_slurm_auth_destroy(void *cred);
 extern int g_slurm_auth_verify(void *cred, char *auth_info);
+extern void *g_slurm_auth_dup(void *cred);
+extern int g_slurm_auth_verify_session(void *cred, void *session);
 extern uid_t g_slurm_auth_get_uid(void *cred);
 extern gid_t g_slurm_auth_get_gid(void *cred);
 extern char *g_slurm_auth_get_host(void *cred);
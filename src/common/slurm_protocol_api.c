@@ -55,8 +55,13 @@
 #include <time.h>
 #include <unistd.h>
 
+#if HAVE_LZ4
+#  include <lz4.h>
+#endif
+
 /* PROJECT INCLUDES */
 #include "src/common/assoc_mgr.h"
+#include "src/common/conn_cache.h"
 #include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/log.h"
@@ -89,12 +94,17 @@ strong_alias(get_unit_type, slurm_get_unit_type);
 
 /* STATIC VARIABLES */
 static int message_timeout = -1;
+static pthread_mutex_t compress_lock = PTHREAD_MUTEX_INITIALIZER;
+static rpc_compress_stats_t compress_stats;
 
 /* STATIC FUNCTIONS */
 static char *_global_auth_key(void);
 static void  _remap_slurmctld_errno(void);
 static int   _unpack_msg_uid(Buf buffer, uint16_t protocol_version);
 static bool  _is_port_ok(int, uint16_t, bool);
+static List  _receive_msgs(int fd, int steps, int timeout,
+			   uint16_t *resp_flags);
+static int   _send_node_msg(int fd, slurm_msg_t *msg, void *session_cred);
 
 #if _DEBUG
 static void _print_data(char *data, int len);
@@ -3388,6 +3398,126 @@ fini:	_slurm_api_free_comm_config(proto_conf);
 	return rc;
 }
 
+/*
+ * _compress_body - LZ4 compress a message body of at least CompressMinSize
+ *	bytes. The result is the uncompressed size (network byte order)
+ *	followed by the compressed data.
+ * IN data - body to compress
+ * IN size - size of data
+ * OUT zsize - size of the returned body
+ * RET xmalloc()'d compressed body, NULL if the body should be sent as is
+ */
+static char *_compress_body(char *data, uint32_t size, uint32_t *zsize)
+{
+#if HAVE_LZ4
+	uint32_t min_size = slurm_conf_compress_min_size(), nsize;
+	int bound, len;
+	char *zdata;
+
+	if (!min_size || (size < min_size) || (size > LZ4_MAX_INPUT_SIZE))
+		return NULL;
+
+	bound = LZ4_compressBound(size);
+	zdata = xmalloc_nz(sizeof(nsize) + bound);
+	len = LZ4_compress_default(data, zdata + sizeof(nsize), size, bound);
+
+	/* Not worth making the peer decompress unless it saves an eighth */
+	if ((len <= 0) || (len > (size - (size / 8)))) {
+		xfree(zdata);
+		return NULL;
+	}
+
+	nsize = htonl(size);
+	memcpy(zdata, &nsize, sizeof(nsize));
+	*zsize = sizeof(nsize) + len;
+
+	slurm_mutex_lock(&compress_lock);
+	compress_stats.msg_cnt++;
+	compress_stats.bytes_raw += size;
+	compress_stats.bytes_sent += *zsize;
+	slurm_mutex_unlock(&compress_lock);
+
+	return zdata;
+#else
+	return NULL;
+#endif
+}
+
+/*
+ * _decompress_body - decompress a body built by _compress_body()
+ * IN buffer - received message, positioned at the start of the body
+ * IN zsize - size of the compressed body
+ * RET buffer holding the uncompressed body, NULL on error
+ */
+static Buf _decompress_body(Buf buffer, uint32_t zsize)
+{
+#if HAVE_LZ4
+	uint32_t size;
+	char *data;
+	int len;
+
+	if (unpack32(&size, buffer) ||
+	    (zsize < sizeof(size)) || (size > LZ4_MAX_INPUT_SIZE)) {
+		error("%s: invalid compressed message body", __func__);
+		return NULL;
+	}
+
+	data = alloc_buf_data(size);
+	len = LZ4_decompress_safe(get_buf_data(buffer) +
+				  get_buf_offset(buffer), data,
+				  zsize - sizeof(size), size);
+	if (len != size) {
+		error("%s: lz4 decompression error", __func__);
+		xfree(data);
+		return NULL;
+	}
+
+	return create_buf(data, size);
+#else
+	error("%s: compressed message received, but lz4 support is not built",
+	      __func__);
+	return NULL;
+#endif
+}
+
+/*
+ * Unpack the body of a received message, decompressing it first if the
+ * sender set SLURM_MSG_COMPRESSED
+ */
+static int _unpack_msg_body(slurm_msg_t *msg, header_t *header, Buf buffer)
+{
+	Buf body = buffer;
+	int rc;
+
+	if (header->body_length > remaining_buf(buffer))
+		return SLURM_ERROR;
+	if ((header->flags & SLURM_MSG_COMPRESSED) &&
+	    !(body = _decompress_body(buffer, header->body_length)))
+		return SLURM_ERROR;
+
+	rc = unpack_msg(msg, body);
+
+	if (body != buffer)
+		free_buf(body);
+	return rc;
+}
+
+/*
+ * slurm_get_compress_stats - report RPC body compression done by this
+ *	process
+ * OUT stats - filled in with the current counters, may be NULL
+ * IN reset - clear the counters after reading them
+ */
+extern void slurm_get_compress_stats(rpc_compress_stats_t *stats, bool reset)
+{
+	slurm_mutex_lock(&compress_lock);
+	if (stats)
+		memcpy(stats, &compress_stats, sizeof(rpc_compress_stats_t));
+	if (reset)
+		memset(&compress_stats, 0, sizeof(rpc_compress_stats_t));
+	slurm_mutex_unlock(&compress_lock);
+}
+
 extern int slurm_unpack_received_msg(slurm_msg_t *msg, int fd, Buf buffer)
 {
 	header_t header;
@@ -3464,8 +3594,7 @@ extern int slurm_unpack_received_msg(slurm_msg_t *msg, int fd, Buf buffer)
 
 	msg->body_offset =  get_buf_offset(buffer);
 
-	if ((header.body_length > remaining_buf(buffer)) ||
-	    (unpack_msg(msg, buffer) != SLURM_SUCCESS)) {
+	if (_unpack_msg_body(msg, &header, buffer) != SLURM_SUCCESS) {
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
 		(void) g_slurm_auth_destroy(auth_cred);
 		goto total_return;
@@ -3494,6 +3623,37 @@ total_return:
  * receive message functions
 \**********************************************************************/
 
+/*
+ * Receive the additional chunks of a message sent with
+ * slurm_send_node_msg_chunked(), up to and including the empty frame that
+ * ends them, adding each to the already unpacked msg. Every chunk is
+ * released as soon as it is unpacked.
+ * RET SLURM_SUCCESS or error code
+ */
+static int _receive_msg_chunks(int fd, slurm_msg_t *msg, int timeout)
+{
+	char *buf = NULL;
+	size_t buflen = 0;
+	Buf buffer;
+	int rc;
+
+	while (1) {
+		if (slurm_msg_recvfrom_timeout(fd, &buf, &buflen, 0,
+					       timeout) < 0)
+			return errno;
+		if (!buflen) {
+			xfree(buf);
+			return SLURM_SUCCESS;
+		}
+
+		buffer = create_buf(buf, buflen);
+		rc = unpack_msg_chunk(msg, buffer);
+		free_buf(buffer);
+		if (rc != SLURM_SUCCESS)
+			return ESLURM_PROTOCOL_INCOMPLETE_PACKET;
+	}
+}
+
 /*
  * NOTE: memory is allocated for the returned msg must be freed at
  *       some point using the slurm_free_functions.
@@ -3583,6 +3743,15 @@ int slurm_receive_msg(int fd, slurm_msg_t *msg, int timeout)
 	else
 		free_buf(buffer);
 
+	if (!rc && (msg->flags & SLURM_MSG_CHUNKED) &&
+	    ((rc = _receive_msg_chunks(fd, msg, timeout)) != SLURM_SUCCESS)) {
+		error("%s: %s", __func__, slurm_strerror(rc));
+		slurm_free_msg_data(msg->msg_type, msg->data);
+		msg->data = NULL;
+		(void) g_slurm_auth_destroy(msg->auth_cred);
+		msg->auth_cred = NULL;
+	}
+
 endit:
 	slurm_seterrno(rc);
 
@@ -3600,6 +3769,16 @@ endit:
  *		  (ret_data_info_t).
  */
 List slurm_receive_msgs(int fd, int steps, int timeout)
+{
+	return _receive_msgs(fd, steps, timeout, NULL);
+}
+
+/*
+ * As slurm_receive_msgs(), also returning the header flags of the reply
+ * in resp_flags if it was received intact.
+ */
+static List _receive_msgs(int fd, int steps, int timeout,
+			  uint16_t *resp_flags)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
@@ -3736,8 +3915,7 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 	msg.msg_type = header.msg_type;
 	msg.flags = header.flags;
 
-	if ((header.body_length > remaining_buf(buffer)) ||
-	    (unpack_msg(&msg, buffer) != SLURM_SUCCESS)) {
+	if (_unpack_msg_body(&msg, &header, buffer) != SLURM_SUCCESS) {
 		(void) g_slurm_auth_destroy(auth_cred);
 		free_buf(buffer);
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
@@ -3747,6 +3925,8 @@ List slurm_receive_msgs(int fd, int steps, int timeout)
 
 	free_buf(buffer);
 	rc = SLURM_SUCCESS;
+	if (resp_flags)
+		*resp_flags = header.flags;
 
 total_return:
 	destroy_forward(&header.forward);
@@ -3807,10 +3987,13 @@ static int _unpack_msg_uid(Buf buffer, uint16_t protocol_version)
  * IN/OUT msg	- a slurm_msg struct to be filled in by the function
  *		  we use the orig_addr from this var for forwarding.
  * IN timeout	- how long to wait in milliseconds
+ * IN session_cred - credential already verified on this connection, a
+ *		  message repeating it is not verified again, may be NULL
  * RET int	- returns 0 on success, -1 on failure and sets errno
  */
 int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
-				  slurm_msg_t *msg, int timeout)
+				  slurm_msg_t *msg, int timeout,
+				  void *session_cred)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
@@ -3950,7 +4133,11 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
 		goto total_return;
 	}
 	msg->auth_index = slurm_auth_index(auth_cred);
-	if (header.flags & SLURM_GLOBAL_AUTH_KEY) {
+	if (session_cred &&
+	    (g_slurm_auth_verify_session(auth_cred, session_cred) ==
+	     SLURM_SUCCESS)) {
+		rc = SLURM_SUCCESS;
+	} else if (header.flags & SLURM_GLOBAL_AUTH_KEY) {
 		rc = g_slurm_auth_verify(auth_cred, _global_auth_key());
 	} else {
 		char *auth_info = slurm_get_auth_info();
@@ -3978,8 +4165,7 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
 		goto total_return;
 	}
 
-	if ( (header.body_length > remaining_buf(buffer)) ||
-	     (unpack_msg(msg, buffer) != SLURM_SUCCESS) ) {
+	if (_unpack_msg_body(msg, &header, buffer) != SLURM_SUCCESS) {
 		(void) g_slurm_auth_destroy(auth_cred);
 		free_buf(buffer);
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
@@ -4013,26 +4199,70 @@ total_return:
 \**********************************************************************/
 
 /*
- *  Do the wonderful stuff that needs be done to pack msg
- *  and hdr into buffer
- */
-static void
-_pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
+ *  Do the wonderful stuff that needs be done to pack the header, the
+ *  auth_cred and msg into buffer, starting at its current offset. This is
+ *  the one packing path of slurm_send_node_msg() and slurm_pack_node_msg().
+ *  If the body is already packed (see pack_msg_is_raw()) only the header is
+ *  updated with raw_size, the caller is responsible for sending the body
+ *  after buffer.
+ * IN flags - header flags, SLURM_MSG_ACCEPT_COMPRESS is set here
+ * RET SLURM_SUCCESS or SLURM_ERROR with errno set
+ */
+static int _pack_node_msg(slurm_msg_t *msg, void *auth_cred, uint16_t flags,
+			  uint32_t raw_size, Buf buffer)
 {
-	unsigned int tmplen, msglen;
+	header_t header;
+	unsigned int hdr_offset = get_buf_offset(buffer), tmplen, msglen;
 
-	tmplen = get_buf_offset(buffer);
-	pack_msg(msg, buffer);
-	msglen = get_buf_offset(buffer) - tmplen;
+#if HAVE_LZ4
+	flags |= SLURM_MSG_ACCEPT_COMPRESS;
+#else
+	flags &= ~SLURM_MSG_ACCEPT_COMPRESS;
+#endif
+	init_header(&header, msg, flags);
+	pack_header(&header, buffer);
+
+	if (g_slurm_auth_pack(auth_cred, buffer, header.version)) {
+		error("authentication: %m");
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return SLURM_ERROR;
+	}
+
+	if (pack_msg_is_raw(msg)) {
+		msglen = raw_size;
+	} else {
+		tmplen = get_buf_offset(buffer);
+		pack_msg(msg, buffer);
+		msglen = get_buf_offset(buffer) - tmplen;
+	}
 
 	/* update header with correct cred and msg lengths */
-	update_header(hdr, msglen);
+	update_header(&header, msglen);
 
 	/* repack updated header */
 	tmplen = get_buf_offset(buffer);
-	set_buf_offset(buffer, 0);
-	pack_header(hdr, buffer);
+	set_buf_offset(buffer, hdr_offset);
+	pack_header(&header, buffer);
 	set_buf_offset(buffer, tmplen);
+
+	return SLURM_SUCCESS;
+}
+
+/* Create a new authentication credential for msg */
+static void *_create_auth_cred(slurm_msg_t *msg)
+{
+	void *auth_cred;
+
+	if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
+		auth_cred = g_slurm_auth_create(msg->auth_index,
+						_global_auth_key());
+	} else {
+		char *auth_info = slurm_get_auth_info();
+		auth_cred = g_slurm_auth_create(msg->auth_index, auth_info);
+		xfree(auth_info);
+	}
+
+	return auth_cred;
 }
 
 /*
@@ -4041,11 +4271,22 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
  */
 int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 {
-	header_t header;
+	return _send_node_msg(fd, msg, NULL);
+}
+
+/*
+ * As slurm_send_node_msg(), authenticating with session_cred instead of a
+ * new credential if it is not NULL. session_cred is not freed.
+ */
+static int _send_node_msg(int fd, slurm_msg_t *msg, void *session_cred)
+{
 	Buf      buffer;
 	int      rc;
 	void *   auth_cred;
 	time_t   start_time = time(NULL);
+	uint16_t flags = msg->flags;
+	char    *zdata = NULL;
+	uint32_t zsize = 0;
 
 	if (msg->conn) {
 		persist_msg_t persist_msg;
@@ -4088,14 +4329,10 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	 * but we may need to generate the credential again later if we
 	 * wait too long for the incoming message.
 	 */
-	if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
-		auth_cred = g_slurm_auth_create(msg->auth_index,
-						_global_auth_key());
-	} else {
-		char *auth_info = slurm_get_auth_info();
-		auth_cred = g_slurm_auth_create(msg->auth_index, auth_info);
-		xfree(auth_info);
-	}
+	if (session_cred)
+		auth_cred = session_cred;
+	else
+		auth_cred = _create_auth_cred(msg);
 
 	if (msg->forward.init != FORWARD_INIT) {
 		forward_init(&msg->forward, NULL);
@@ -4107,55 +4344,61 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 
 	forward_wait(msg);
 
-	if (difftime(time(NULL), start_time) >= 60) {
+	if (!session_cred && (difftime(time(NULL), start_time) >= 60)) {
 		(void) g_slurm_auth_destroy(auth_cred);
-		if (msg->flags & SLURM_GLOBAL_AUTH_KEY) {
-			auth_cred = g_slurm_auth_create(msg->auth_index,
-							_global_auth_key());
-		} else {
-			char *auth_info = slurm_get_auth_info();
-			auth_cred = g_slurm_auth_create(msg->auth_index,
-							auth_info);
-			xfree(auth_info);
-		}
+		auth_cred = _create_auth_cred(msg);
 	}
 	if (auth_cred == NULL) {
 		error("authentication: %m");
 		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
 	}
 
-	init_header(&header, msg, msg->flags);
-
 	/*
-	 * Pack header into buffer for transmission
+	 * Pre-packed info responses are compressed if the request they
+	 * answer said the peer can decompress them (response_init() copies
+	 * the request's flags). Every message advertises that we can.
 	 */
-	buffer = init_buf(BUF_SIZE);
-	pack_header(&header, buffer);
+	if ((flags & SLURM_MSG_ACCEPT_COMPRESS) && pack_msg_is_raw(msg) &&
+	    (zdata = _compress_body(msg->data, msg->data_size, &zsize)))
+		flags |= SLURM_MSG_COMPRESSED;
+	else
+		flags &= ~SLURM_MSG_COMPRESSED;
 
 	/*
-	 * Pack auth credential
+	 * Pack header, auth credential and message into buffer
 	 */
-	rc = g_slurm_auth_pack(auth_cred, buffer, header.version);
-	(void) g_slurm_auth_destroy(auth_cred);
+	buffer = init_buf(BUF_SIZE);
+	rc = _pack_node_msg(msg, auth_cred, flags,
+			    zdata ? zsize : msg->data_size, buffer);
+	if (!session_cred)
+		(void) g_slurm_auth_destroy(auth_cred);
 	if (rc) {
-		error("authentication: %m");
 		free_buf(buffer);
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		xfree(zdata);
+		return SLURM_ERROR;
 	}
 
-	/*
-	 * Pack message into buffer
-	 */
-	_pack_msg(msg, &header, buffer);
-
 #if	_DEBUG
 	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
 #endif
 	/*
-	 * Send message
+	 * Send message. A pre-packed body (e.g. job or node info) can be
+	 * hundreds of MB, send it from where it is instead of copying it
+	 * into the buffer behind the header.
 	 */
-	rc = slurm_msg_sendto(fd, get_buf_data(buffer),
-			      get_buf_offset(buffer));
+	if (pack_msg_is_raw(msg)) {
+		struct iovec iov[2];
+
+		iov[0].iov_base = get_buf_data(buffer);
+		iov[0].iov_len  = get_buf_offset(buffer);
+		iov[1].iov_base = zdata ? zdata : msg->data;
+		iov[1].iov_len  = zdata ? zsize : msg->data_size;
+		rc = slurm_msg_sendv(fd, iov, 2);
+		xfree(zdata);
+	} else {
+		rc = slurm_msg_sendto(fd, get_buf_data(buffer),
+				      get_buf_offset(buffer));
+	}
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
@@ -4182,6 +4425,47 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	return rc;
 }
 
+/*
+ *  Send a slurm message whose body continues in a list of additional
+ *    chunks. Each chunk (a Buf holding a self-contained body of the same
+ *    message type) goes out as its own length-prefixed frame once the
+ *    message itself has been sent, followed by an empty frame. The receiver
+ *    adds each chunk to the message with unpack_msg_chunk(). This keeps
+ *    every frame well below MAX_BUF_SIZE no matter how large the complete
+ *    response is. Chunks are removed from the list and freed as they are
+ *    sent. Not supported on persistent connections.
+ *    Returns SLURM_SUCCESS, or SLURM_ERROR on failure.
+ */
+int slurm_send_node_msg_chunked(int fd, slurm_msg_t *msg, List chunks)
+{
+	int rc, timeout = slurm_get_msg_timeout() * 1000;
+	Buf chunk;
+
+	xassert(!msg->conn);
+
+	if (!chunks || !list_count(chunks))
+		return (slurm_send_node_msg(fd, msg) < 0) ?
+			SLURM_ERROR : SLURM_SUCCESS;
+
+	msg->flags |= SLURM_MSG_CHUNKED;
+	rc = slurm_send_node_msg(fd, msg);
+	msg->flags &= ~SLURM_MSG_CHUNKED;
+
+	while ((rc >= 0) && (chunk = list_pop(chunks))) {
+		rc = slurm_msg_sendto_timeout(fd, get_buf_data(chunk),
+					      get_buf_offset(chunk), timeout);
+		free_buf(chunk);
+	}
+	if (rc >= 0)
+		rc = slurm_msg_sendto_timeout(fd, NULL, 0, timeout);
+
+	if (rc < 0) {
+		error("%s: msg_type=%u: %m", __func__, msg->msg_type);
+		return SLURM_ERROR;
+	}
+	return SLURM_SUCCESS;
+}
+
 /**********************************************************************\
  * stream functions
 \**********************************************************************/
@@ -4555,22 +4839,32 @@ _send_and_recv_msg(int fd, slurm_msg_t *req,
  * IN fd	- file descriptor to receive msg on
  * IN req	- a slurm_msg struct to be sent by the function
  * IN timeout	- how long to wait in milliseconds
+ * OUT keep	- if not NULL, set true when the peer agreed to keep the
+ *		  connection open, which is then left open for the caller
+ * IN session	- authentication session of a cached connection, or NULL
  * RET List	- List containing the responses of the children (if any) we
  *		  forwarded the message to. List containing type
  *		  (ret_data_info_t).
  */
 static List
-_send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout)
+_send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout, bool *keep,
+		    conn_session_t *session)
 {
 	List ret_list = NULL;
 	int steps = 0;
+	uint16_t resp_flags = 0;
+	void *session_cred = NULL;
+
+	/* Nodes we forward to verify the credential too, never repeat it */
+	if (session && !req->forward.cnt)
+		session_cred = session->cred;
 
 	if (!req->forward.timeout) {
 		if (!timeout)
 			timeout = slurm_get_msg_timeout() * 1000;
 		req->forward.timeout = timeout;
 	}
-	if (slurm_send_node_msg(fd, req) >= 0) {
+	if (_send_node_msg(fd, req, session_cred) >= 0) {
 		if (req->forward.cnt > 0) {
 			/* figure out where we are in the tree and set
 			 * the timeout for to wait for our children
@@ -4591,10 +4885,13 @@ _send_and_recv_msgs(int fd, slurm_msg_t *req, int timeout)
 
 			timeout += (req->forward.timeout*steps);
 		}
-		ret_list = slurm_receive_msgs(fd, steps, timeout);
+		ret_list = _receive_msgs(fd, steps, timeout, &resp_flags);
 	}
 
-	(void) close(fd);
+	if (keep && ret_list && (resp_flags & SLURM_MSG_KEEP_CONN))
+		*keep = true;
+	else
+		(void) close(fd);
 
 	return ret_list;
 }
@@ -4903,6 +5200,46 @@ void slurm_send_msg_maybe(slurm_msg_t *req)
 	(void) close(fd);
 }
 
+extern Buf slurm_pack_node_msg(slurm_msg_t *req)
+{
+	Buf buffer;
+	void *auth_cred;
+	uint16_t flags = req->flags & ~SLURM_MSG_COMPRESSED;
+	uint32_t len;
+	int rc;
+
+	xassert(!pack_msg_is_raw(req));
+
+	if (req->forward.init != FORWARD_INIT) {
+		forward_init(&req->forward, NULL);
+		req->ret_list = NULL;
+	}
+	xassert(!req->forward.cnt);
+
+	if (!(auth_cred = _create_auth_cred(req))) {
+		error("authentication: %m");
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
+	}
+
+	/* Room for the length, prepended as slurm_msg_sendto() does */
+	buffer = init_buf(BUF_SIZE);
+	pack32(0, buffer);
+	rc = _pack_node_msg(req, auth_cred, flags, req->data_size, buffer);
+	(void) g_slurm_auth_destroy(auth_cred);
+	if (rc) {
+		free_buf(buffer);
+		return NULL;
+	}
+
+	len = get_buf_offset(buffer) - sizeof(uint32_t);
+	set_buf_offset(buffer, 0);
+	pack32(len, buffer);
+	set_buf_offset(buffer, len + sizeof(uint32_t));
+
+	return buffer;
+}
+
 /*
  *  Send a message to the nodelist specificed using fanout
  *    Then return List containing type (ret_data_info_t).
@@ -4937,6 +5274,25 @@ List slurm_send_recv_msgs(const char *nodelist, slurm_msg_t *msg,
 	return ret_list;
 }
 
+/*
+ * Return true if err says a kept connection was closed by the peer, as
+ * opposed to the peer not answering in time.
+ */
+static bool _conn_lost(int err)
+{
+	switch (err) {
+	case ENOTCONN:
+	case ECONNRESET:
+	case EPIPE:
+	case SLURM_PROTOCOL_SOCKET_ZERO_BYTES_SENT:
+	case SLURM_COMMUNICATIONS_SEND_ERROR:
+	case SLURM_COMMUNICATIONS_RECEIVE_ERROR:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /*
  *  Send a message to msg->address
  *    Then return List containing type (ret_data_info_t).
@@ -4955,12 +5311,47 @@ List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 	ret_data_info_t *ret_data_info = NULL;
 	ListIterator itr;
 	int i;
+	bool cache = conn_cache_wanted(msg), keep = false;
+	conn_session_t *session = NULL;
 
 	slurm_mutex_lock(&conn_lock);
 	if (conn_timeout == NO_VAL16)
 		conn_timeout = MIN(slurm_get_msg_timeout(), 10);
 	slurm_mutex_unlock(&conn_lock);
 
+	if (cache) {
+		msg->flags |= SLURM_MSG_KEEP_CONN;
+		if ((fd = conn_cache_get(&msg->address, &session)) >= 0) {
+			if (!conn_session_valid(session) &&
+			    !msg->forward.cnt) {
+				conn_session_destroy(session);
+				session = conn_session_create(
+					_create_auth_cred(msg));
+			}
+			msg->ret_list = NULL;
+			msg->forward_struct = NULL;
+			ret_list = _send_and_recv_msgs(fd, msg, timeout, &keep,
+						       session);
+			/* errno may be left over when a reply was read */
+			if (ret_list || !_conn_lost(errno))
+				goto done;
+			/*
+			 * The slurmd closed the connection before reading
+			 * the request, send it again on a new one.
+			 */
+			debug2("%s: cached connection to %s lost: %m",
+			       __func__, name);
+			if (keep) {
+				(void) close(fd);
+				keep = false;
+			}
+			conn_session_destroy(session);
+			session = NULL;
+			conn_cache_reconnect(&msg->address);
+		}
+	} else
+		msg->flags &= ~SLURM_MSG_KEEP_CONN;
+
 	/* This connect retry logic permits Slurm hierarchical communications
 	 * to better survive slurmd restarts */
 	for (i = 0; i <= conn_timeout; i++) {
@@ -4979,9 +5370,23 @@ List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 		return ret_list;
 	}
 
+	if (cache) {
+		conn_cache_opened(&msg->address);
+		if (!msg->forward.cnt)
+			session = conn_session_create(_create_auth_cred(msg));
+	}
+
 	msg->ret_list = NULL;
 	msg->forward_struct = NULL;
-	if (!(ret_list = _send_and_recv_msgs(fd, msg, timeout))) {
+	ret_list = _send_and_recv_msgs(fd, msg, timeout, cache ? &keep : NULL,
+				       session);
+
+done:
+	if (keep)
+		conn_cache_put(&msg->address, fd, session);
+	else
+		conn_session_destroy(session);
+	if (!ret_list) {
 		mark_as_failed_forward(&ret_list, name, errno);
 		errno = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
 		return ret_list;
@@ -72,6 +72,12 @@ enum {
 	UNIT_UNKNOWN
 };
 
+typedef struct {
+	uint64_t msg_cnt;	/* message bodies sent compressed */
+	uint64_t bytes_raw;	/* their size before compression */
+	uint64_t bytes_sent;	/* their size after compression */
+} rpc_compress_stats_t;
+
 /**********************************************************************\
  * protocol configuration functions
 \**********************************************************************/
@@ -1105,10 +1111,21 @@ List slurm_receive_msgs(int fd, int steps, int timeout);
  * IN open_fd	- file descriptor to receive msg on
  * OUT resp	- a slurm_msg struct to be filled in by the function
  * IN timeout	- how long to wait in milliseconds
+ * IN session_cred - credential already verified on this connection, a
+ *		  message repeating it is not verified again, may be NULL
  * RET int	- returns 0 on success, -1 on failure and sets errno
  */
 int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
-				  slurm_msg_t *resp, int timeout);
+				  slurm_msg_t *resp, int timeout,
+				  void *session_cred);
+
+/*
+ * slurm_get_compress_stats - report RPC body compression done by this
+ *	process (see CommunicationParameters=CompressMinSize)
+ * OUT stats - filled in with the current counters, may be NULL
+ * IN reset - clear the counters after reading them
+ */
+extern void slurm_get_compress_stats(rpc_compress_stats_t *stats, bool reset);
 
 /**********************************************************************\
  * send message functions
@@ -1122,6 +1139,16 @@ int slurm_receive_msg_and_forward(int fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(int open_fd, slurm_msg_t *msg);
 
+/* sends a message whose body continues in a list of additional chunks,
+ *	see slurm_send_node_msg_chunked() in slurm_protocol_api.c
+ *
+ * IN open_fd		- file descriptor to send msg on
+ * IN msg		- a slurm msg struct to be sent
+ * IN chunks		- list of Buf with further body chunks, emptied
+ * RET int		- SLURM_SUCCESS or SLURM_ERROR
+ */
+int slurm_send_node_msg_chunked(int open_fd, slurm_msg_t *msg, List chunks);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
@@ -1376,6 +1403,16 @@ extern int slurm_send_only_node_msg(slurm_msg_t *request_msg);
  */
 extern void slurm_send_msg_maybe(slurm_msg_t *request_msg);
 
+/*
+ * slurm_pack_node_msg
+ * pack a message as slurm_send_node_msg() would send it, length prefix
+ * included, so the same bytes can be written to several connections.
+ * Forwarding and pre-packed message bodies are not supported.
+ * IN request_msg	- slurm_msg request
+ * RET Buf		- packed message to free_buf(), NULL on error
+ */
+extern Buf slurm_pack_node_msg(slurm_msg_t *request_msg);
+
 /* Send and recv a slurm request and response on the open slurm descriptor
  * Doesn't close the connection.
  * IN fd	- file descriptor to receive msg on
@@ -104,5 +104,9 @@
 #define SLURMDBD_CONNECTION     0x0002
 #define SLURM_MSG_KEEP_BUFFER   0x0004
 #define SLURM_DROP_PRIV		0x0008
+#define SLURM_MSG_CHUNKED	0x0010	/* body continues in further frames */
+#define SLURM_MSG_ACCEPT_COMPRESS 0x0020 /* sender can decompress replies */
+#define SLURM_MSG_COMPRESSED	0x0040	/* body is LZ4 compressed */
+#define SLURM_MSG_KEEP_CONN	0x0080	/* leave connection open after reply */
 
 #endif
@@ -125,6 +125,8 @@ extern void slurm_msg_t_copy(slurm_msg_t *dest, slurm_msg_t *src)
 {
 	slurm_msg_t_init(dest);
 	dest->protocol_version = src->protocol_version;
+	/* A reply tells the sender if its connection was kept open */
+	dest->flags = src->flags & SLURM_MSG_KEEP_CONN;
 	dest->forward = src->forward;
 	dest->ret_list = src->ret_list;
 	dest->forward_struct = src->forward_struct;
@@ -1582,6 +1584,25 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		for (i = 0; i < msg->lock_type_size; i++)
+			xfree(msg->lock_type_name[i]);
+		xfree(msg->lock_type_name);
+		xfree(msg->lock_type_cnt);
+		xfree(msg->lock_type_wait);
+		xfree(msg->lock_type_wait_max);
+		xfree(msg->lock_type_hold);
+		xfree(msg->lock_type_hold_max);
+		for (i = 0; i < msg->lock_caller_size; i++)
+			xfree(msg->lock_caller_name[i]);
+		xfree(msg->lock_caller_name);
+		xfree(msg->lock_caller_levels);
+		xfree(msg->lock_caller_cnt);
+		xfree(msg->lock_caller_wait);
+		xfree(msg->lock_caller_wait_max);
+		xfree(msg->lock_caller_hold);
+		xfree(msg->lock_caller_hold_max);
+		xfree(msg->rpc_type_latency);
+		xfree(msg->rpc_user_latency);
 		xfree(msg);
 	}
 }
@@ -2519,6 +2540,25 @@ extern void slurm_free_ping_slurmd_resp(ping_slurmd_resp_msg_t *msg)
 	xfree(msg);
 }
 
+extern void slurm_free_ping_tree_resp(ping_tree_resp_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->node_list);
+		xfree(msg->cpu_load);
+		xfree(msg->free_mem);
+		xfree(msg);
+	}
+}
+
+extern void slurm_free_state_stream_msg(state_stream_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->name);
+		xfree(msg->data);
+		xfree(msg);
+	}
+}
+
 /*
  * structured as a static lookup table, which allows this
  * to be thread safe while avoiding any heap allocation
@@ -4928,6 +4968,12 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case RESPONSE_PING_SLURMD:
 		slurm_free_ping_slurmd_resp(data);
 		break;
+	case RESPONSE_PING_TREE:
+		slurm_free_ping_tree_resp(data);
+		break;
+	case REQUEST_STATE_STREAM:
+		slurm_free_state_stream_msg(data);
+		break;
 	case RESPONSE_JOB_ARRAY_ERRORS:
 		slurm_free_job_array_resp(data);
 		break;
@@ -4943,6 +4989,8 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 		break;
 	case MESSAGE_COMPOSITE:
 	case RESPONSE_MESSAGE_COMPOSITE:
+	case REQUEST_AGENT_COMPOSITE:
+	case RESPONSE_AGENT_COMPOSITE:
 		slurm_free_composite_msg(data);
 		break;
 	case REQUEST_JOB_NOTIFY:
@@ -5058,6 +5106,7 @@ extern uint32_t slurm_get_return_code(slurm_msg_type_t type, void *data)
 		rc = ((return_code_msg_t *)data)->return_code;
 		break;
 	case RESPONSE_PING_SLURMD:
+	case RESPONSE_PING_TREE:
 		rc = SLURM_SUCCESS;
 		break;
 	case RESPONSE_ACCT_GATHER_UPDATE:
@@ -5184,6 +5233,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_REBOOT_NODES";
 	case RESPONSE_PING_SLURMD:
 		return "RESPONSE_PING_SLURMD";
+	case RESPONSE_PING_TREE:
+		return "RESPONSE_PING_TREE";
+	case REQUEST_STATE_STREAM:
+		return "REQUEST_STATE_STREAM";
 	case REQUEST_ACCT_GATHER_UPDATE:
 		return "REQUEST_ACCT_GATHER_UPDATE";
 	case RESPONSE_ACCT_GATHER_UPDATE:
@@ -5563,6 +5616,10 @@ rpc_num2string(uint16_t opcode)
 		return "MESSAGE_COMPOSITE";
 	case RESPONSE_MESSAGE_COMPOSITE:
 		return "RESPONSE_MESSAGE_COMPOSITE";
+	case REQUEST_AGENT_COMPOSITE:
+		return "REQUEST_AGENT_COMPOSITE";
+	case RESPONSE_AGENT_COMPOSITE:
+		return "RESPONSE_AGENT_COMPOSITE";
 
 	case REQUEST_PERSIST_INIT:
 		return "REQUEST_PERSIST_INIT";
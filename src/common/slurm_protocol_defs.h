@@ -166,6 +166,7 @@
 #define USEC_IN_SEC 1000000
 #define NSEC_IN_SEC 1000000000
 #define NSEC_IN_USEC 1000
+#define USEC_IN_MSEC 1000
 #define NSEC_IN_MSEC 1000000
 
 #define SLURMD_REG_FLAG_STARTUP  0x0001
@@ -215,6 +216,8 @@ typedef enum {
 	RESPONSE_LICENSE_INFO,
 	REQUEST_SET_FS_DAMPENING_FACTOR,
 	RESPONSE_NODE_REGISTRATION,
+	RESPONSE_PING_TREE,
+	REQUEST_STATE_STREAM,
 
 	PERSIST_RC = 1433, /* To mirror the DBD_RC this is replacing */
 	/* Don't make any messages in this range as this is what the DBD uses
@@ -421,6 +424,8 @@ typedef enum {
 
 	MESSAGE_COMPOSITE = 11001,
 	RESPONSE_MESSAGE_COMPOSITE,
+	REQUEST_AGENT_COMPOSITE,
+	RESPONSE_AGENT_COMPOSITE,
 } slurm_msg_type_t;
 
 /*****************************************************************************\
@@ -1218,6 +1223,26 @@ typedef struct ping_slurmd_resp_msg {
 	uint64_t free_mem;	/* Free memory in MiB */
 } ping_slurmd_resp_msg_t;
 
+/*
+ * Ping replies of a forwarding subtree folded into one. Nodes that failed
+ * to answer are still listed on their own in the ret_list.
+ */
+typedef struct ping_tree_resp_msg {
+	char *node_list;	/* nodes that answered */
+	uint32_t node_cnt;	/* hosts in node_list */
+	uint32_t *cpu_load;	/* CPU load * 100, in node_list order */
+	uint64_t *free_mem;	/* Free memory in MiB, in node_list order */
+} ping_tree_resp_msg_t;
+
+/* A state save file as just written by the primary slurmctld */
+typedef struct state_stream_msg {
+	char *name;		/* file name in StateSaveLocation */
+	time_t write_time;	/* mtime of the file written by the primary */
+	uint32_t write_nsec;	/* nanoseconds of write_time */
+	uint32_t size;
+	char *data;		/* file contents */
+} state_stream_msg_t;
+
 typedef struct license_info_request_msg {
 	time_t last_update;
 	uint16_t show_flags;
@@ -1399,6 +1424,8 @@ extern void slurm_free_forward_data_msg(forward_data_msg_t *msg);
 extern void slurm_free_comp_msg_list(void *x);
 extern void slurm_free_composite_msg(composite_msg_t *msg);
 extern void slurm_free_ping_slurmd_resp(ping_slurmd_resp_msg_t *msg);
+extern void slurm_free_ping_tree_resp(ping_tree_resp_msg_t *msg);
+extern void slurm_free_state_stream_msg(state_stream_msg_t *msg);
 
 #define	slurm_free_timelimit_msg(msg) \
 	slurm_free_kill_job_msg(msg)
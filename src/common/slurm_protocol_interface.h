@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "src/common/macros.h"
@@ -95,6 +96,20 @@ extern ssize_t slurm_msg_sendto_timeout(int open_fd,
 					size_t size,
 					int timeout);
 
+/* slurm_msg_sendv
+ * Send one message gathered from several buffers over the given
+ *	connection, default timeout value
+ * IN open_fd - an open file descriptor
+ * IN iov - array of buffers to transmit, in order
+ * IN iovcnt - number of elements in iov
+ * RET number of bytes written
+ */
+extern ssize_t slurm_msg_sendv(int open_fd, struct iovec *iov, int iovcnt);
+/* slurm_msg_sendv_timeout is identical to slurm_msg_sendv except
+ * IN timeout - maximum time to wait for a message in milliseconds */
+extern ssize_t slurm_msg_sendv_timeout(int open_fd, struct iovec *iov,
+				       int iovcnt, int timeout);
+
 /********************/
 /* stream functions */
 /********************/
@@ -132,6 +147,8 @@ extern int slurm_get_stream_addr(int open_fd, slurm_addr_t *address);
 
 extern int slurm_send_timeout(int open_fd, char *buffer, size_t size,
 			      uint32_t flags, int timeout);
+extern int slurm_sendv_timeout(int open_fd, struct iovec *iov, int iovcnt,
+			       uint32_t flags, int timeout);
 extern int slurm_recv_timeout(int open_fd, char *buffer, size_t size,
 			      uint32_t flags, int timeout);
 
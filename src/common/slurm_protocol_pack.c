@@ -705,6 +705,14 @@ static void _pack_ping_slurmd_resp(ping_slurmd_resp_msg_t *msg,
 				   Buf buffer, uint16_t protocol_version);
 static int _unpack_ping_slurmd_resp(ping_slurmd_resp_msg_t **msg_ptr,
 				    Buf buffer, uint16_t protocol_version);
+static void _pack_ping_tree_resp(ping_tree_resp_msg_t *msg, Buf buffer,
+				 uint16_t protocol_version);
+static int _unpack_ping_tree_resp(ping_tree_resp_msg_t **msg_ptr,
+				  Buf buffer, uint16_t protocol_version);
+static void _pack_state_stream_msg(state_stream_msg_t *msg, Buf buffer,
+				   uint16_t protocol_version);
+static int _unpack_state_stream_msg(state_stream_msg_t **msg_ptr,
+				    Buf buffer, uint16_t protocol_version);
 
 static void _pack_license_info_request_msg(license_info_request_msg_t *msg,
 					   Buf buffer,
@@ -731,6 +739,10 @@ static void _pack_composite_msg(composite_msg_t *msg, Buf buffer,
 				uint16_t protocol_version);
 static int  _unpack_composite_msg(composite_msg_t **msg, Buf buffer,
 				  uint16_t protocol_version);
+static void _pack_agent_composite_msg(composite_msg_t *msg, Buf buffer,
+				      uint16_t protocol_version);
+static int  _unpack_agent_composite_msg(composite_msg_t **msg, Buf buffer,
+					uint16_t protocol_version);
 static int
 _unpack_burst_buffer_info_msg(burst_buffer_info_msg_t **burst_buffer_info,
 			      Buf buffer,
@@ -892,6 +904,34 @@ unpack_error:
 }
 
 
+/* pack_msg_is_raw
+ * IN msg - the body structure to pack (note: includes message type)
+ * RET true if pack_msg() would only copy the already packed msg->data
+ *	(msg->data_size bytes) into the buffer, see _pack_buffer_msg()
+ */
+extern bool pack_msg_is_raw(slurm_msg_t const *msg)
+{
+	if (msg->protocol_version < SLURM_MIN_PROTOCOL_VERSION)
+		return false;
+
+	switch (msg->msg_type) {
+	case RESPONSE_ASSOC_MGR_INFO:
+	case RESPONSE_BURST_BUFFER_INFO:
+	case RESPONSE_FRONT_END_INFO:
+	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_STEP_INFO:
+	case RESPONSE_LAYOUT_INFO:
+	case RESPONSE_LICENSE_INFO:
+	case RESPONSE_NODE_INFO:
+	case RESPONSE_PARTITION_INFO:
+	case RESPONSE_RESERVATION_INFO:
+	case RESPONSE_STATS_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* pack_msg
  * packs a generic slurm protocol message body
  * IN msg - the body structure to pack (note: includes message type)
@@ -1519,6 +1559,14 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		_pack_ping_slurmd_resp((ping_slurmd_resp_msg_t *)msg->data,
 				       buffer, msg->protocol_version);
 		break;
+	case RESPONSE_PING_TREE:
+		_pack_ping_tree_resp((ping_tree_resp_msg_t *)msg->data,
+				     buffer, msg->protocol_version);
+		break;
+	case REQUEST_STATE_STREAM:
+		_pack_state_stream_msg((state_stream_msg_t *)msg->data,
+				       buffer, msg->protocol_version);
+		break;
 	case REQUEST_LICENSE_INFO:
 		 _pack_license_info_request_msg((license_info_request_msg_t *)
 						msg->data,
@@ -1528,6 +1576,11 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	case RESPONSE_LICENSE_INFO:
 		_pack_license_info_msg((slurm_msg_t *) msg, buffer);
 		break;
+	case REQUEST_AGENT_COMPOSITE:
+	case RESPONSE_AGENT_COMPOSITE:
+		_pack_agent_composite_msg((composite_msg_t *) msg->data,
+					  buffer, msg->protocol_version);
+		break;
 	case MESSAGE_COMPOSITE:
 	case RESPONSE_MESSAGE_COMPOSITE:
 		_pack_composite_msg((composite_msg_t *) msg->data, buffer,
@@ -2267,6 +2320,16 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					      &msg->data, buffer,
 					      msg->protocol_version);
 		break;
+	case RESPONSE_PING_TREE:
+		rc = _unpack_ping_tree_resp((ping_tree_resp_msg_t **)
+					    &msg->data, buffer,
+					    msg->protocol_version);
+		break;
+	case REQUEST_STATE_STREAM:
+		rc = _unpack_state_stream_msg((state_stream_msg_t **)
+					      &msg->data, buffer,
+					      msg->protocol_version);
+		break;
 	case RESPONSE_LICENSE_INFO:
 		rc = _unpack_license_info_msg((license_info_msg_t **)&(msg->data),
 					      buffer,
@@ -2278,6 +2341,12 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 						      buffer,
 						      msg->protocol_version);
 		break;
+	case REQUEST_AGENT_COMPOSITE:
+	case RESPONSE_AGENT_COMPOSITE:
+		rc = _unpack_agent_composite_msg(
+			(composite_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case MESSAGE_COMPOSITE:
 	case RESPONSE_MESSAGE_COMPOSITE:
 		rc = _unpack_composite_msg((composite_msg_t **) &(msg->data),
@@ -2352,6 +2421,59 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 	return rc;
 }
 
+/* Append the records of another job_info_msg_t chunk to msg */
+static int _unpack_job_info_chunk(job_info_msg_t *msg, Buf buffer,
+				  uint16_t protocol_version)
+{
+	job_info_msg_t *chunk = NULL;
+
+	if (_unpack_job_info_msg(&chunk, buffer, protocol_version))
+		return SLURM_ERROR;
+
+	if (chunk->record_count) {
+		xrealloc(msg->job_array, sizeof(job_info_t) *
+			 (msg->record_count + chunk->record_count));
+		memcpy(&msg->job_array[msg->record_count], chunk->job_array,
+		       sizeof(job_info_t) * chunk->record_count);
+		msg->record_count += chunk->record_count;
+	}
+
+	/* The records now belong to msg, only release the array */
+	xfree(chunk->job_array);
+	xfree(chunk);
+	return SLURM_SUCCESS;
+}
+
+/* unpack_msg_chunk
+ * unpacks one additional chunk of a message sent with SLURM_MSG_CHUNKED,
+ *	adding its records to the message body already unpacked by
+ *	unpack_msg()
+ * IN/OUT msg - message to add the records to
+ * IN/OUT buffer - the chunk, contains pointers that are automatically
+ *	updated
+ * RET 0 or error code
+ */
+extern int unpack_msg_chunk(slurm_msg_t *msg, Buf buffer)
+{
+	int rc;
+
+	switch (msg->msg_type) {
+	case RESPONSE_JOB_INFO:
+		rc = _unpack_job_info_chunk((job_info_msg_t *) msg->data,
+					    buffer, msg->protocol_version);
+		break;
+	default:
+		debug("No chunk unpack method for msg type %u", msg->msg_type);
+		return EINVAL;
+	}
+
+	if (rc) {
+		error("Malformed chunk of RPC type %s(%u) received",
+		      rpc_num2string(msg->msg_type), msg->msg_type);
+	}
+	return rc;
+}
+
 static void _pack_assoc_shares_object(void *in, uint32_t tres_cnt, Buf buffer,
 				      uint16_t protocol_version)
 {
@@ -4645,6 +4767,69 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/*
+ * Unlike MESSAGE_COMPOSITE, the parts of a REQUEST_AGENT_COMPOSITE (and of
+ * its response) carry no credential of their own, the credential of the
+ * enclosing message covers them all.
+ */
+static void _pack_agent_composite_msg(composite_msg_t *msg, Buf buffer,
+				      uint16_t protocol_version)
+{
+	slurm_msg_t *part;
+	ListIterator itr;
+	uint32_t count = 0;
+
+	xassert(msg);
+
+	if (msg->msg_list)
+		count = list_count(msg->msg_list);
+	pack32(count, buffer);
+	if (!count)
+		return;
+
+	itr = list_iterator_create(msg->msg_list);
+	while ((part = list_next(itr))) {
+		part->protocol_version = protocol_version;
+		pack16(part->msg_type, buffer);
+		pack16(part->msg_index, buffer);
+		pack_msg(part, buffer);
+	}
+	list_iterator_destroy(itr);
+}
+
+static int _unpack_agent_composite_msg(composite_msg_t **msg, Buf buffer,
+				       uint16_t protocol_version)
+{
+	composite_msg_t *object_ptr;
+	slurm_msg_t *part;
+	uint32_t count, i;
+
+	xassert(msg);
+	object_ptr = xmalloc(sizeof(composite_msg_t));
+	object_ptr->msg_list = list_create(slurm_free_comp_msg_list);
+	*msg = object_ptr;
+
+	safe_unpack32(&count, buffer);
+	if (count > MAX_PACK_ARRAY_LEN)
+		goto unpack_error;
+	for (i = 0; i < count; i++) {
+		part = xmalloc(sizeof(slurm_msg_t));
+		slurm_msg_t_init(part);
+		part->protocol_version = protocol_version;
+		list_append(object_ptr->msg_list, part);
+		safe_unpack16(&part->msg_type, buffer);
+		safe_unpack16(&part->msg_index, buffer);
+		if (unpack_msg(part, buffer) != SLURM_SUCCESS)
+			goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_composite_msg(object_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_update_job_time_msg(job_time_msg_t * msg, Buf buffer,
 			  uint16_t protocol_version)
@@ -11154,6 +11339,82 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_ping_tree_resp(ping_tree_resp_msg_t *msg, Buf buffer,
+				 uint16_t protocol_version)
+{
+	xassert(msg);
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		packstr(msg->node_list, buffer);
+		pack32_array(msg->cpu_load, msg->node_cnt, buffer);
+		pack64_array(msg->free_mem, msg->node_cnt, buffer);
+	}
+}
+
+static int _unpack_ping_tree_resp(ping_tree_resp_msg_t **msg_ptr,
+				  Buf buffer, uint16_t protocol_version)
+{
+	ping_tree_resp_msg_t *msg;
+	uint32_t uint32_tmp;
+
+	xassert(msg_ptr);
+	msg = xmalloc(sizeof(ping_tree_resp_msg_t));
+	*msg_ptr = msg;
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		safe_unpackstr_xmalloc(&msg->node_list, &uint32_tmp, buffer);
+		safe_unpack32_array(&msg->cpu_load, &msg->node_cnt, buffer);
+		safe_unpack64_array(&msg->free_mem, &uint32_tmp, buffer);
+		if (uint32_tmp != msg->node_cnt)
+			goto unpack_error;
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_ping_tree_resp(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
+static void _pack_state_stream_msg(state_stream_msg_t *msg, Buf buffer,
+				   uint16_t protocol_version)
+{
+	xassert(msg);
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		packstr(msg->name, buffer);
+		pack_time(msg->write_time, buffer);
+		pack32(msg->write_nsec, buffer);
+		packmem(msg->data, msg->size, buffer);
+	}
+}
+
+static int _unpack_state_stream_msg(state_stream_msg_t **msg_ptr,
+				    Buf buffer, uint16_t protocol_version)
+{
+	state_stream_msg_t *msg;
+	uint32_t uint32_tmp;
+
+	xassert(msg_ptr);
+	msg = xmalloc(sizeof(state_stream_msg_t));
+	*msg_ptr = msg;
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		safe_unpackstr_xmalloc(&msg->name, &uint32_tmp, buffer);
+		safe_unpack_time(&msg->write_time, buffer);
+		safe_unpack32(&msg->write_nsec, buffer);
+		safe_unpackmem_xmalloc(&msg->data, &msg->size, buffer);
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_state_stream_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_checkpoint_msg(checkpoint_msg_t *msg, Buf buffer,
 		     uint16_t protocol_version)
@@ -12149,6 +12410,26 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Unpack the cnt counters of each kind packed by lock_stats_pack() */
+static int _unpack_lock_stats(uint32_t cnt, uint64_t **acquired,
+			      uint64_t **wait, uint64_t **wait_max,
+			      uint64_t **hold, uint64_t **hold_max, Buf buffer)
+{
+	uint64_t **fields[] = { acquired, wait, wait_max, hold, hold_max };
+	uint32_t uint32_tmp;
+	int i;
+
+	for (i = 0; i < (sizeof(fields) / sizeof(fields[0])); i++) {
+		safe_unpack64_array(fields[i], &uint32_tmp, buffer);
+		if (uint32_tmp != cnt)
+			goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	return SLURM_ERROR;
+}
+
 static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				       Buf buffer, uint16_t protocol_version)
 {
@@ -12205,6 +12486,22 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 
 			safe_unpack32(&msg->bf_active,		buffer);
 			safe_unpack32(&msg->bf_backfilled_pack_jobs, buffer);
+
+			safe_unpack64(&msg->buf_pool_hits,	buffer);
+			safe_unpack64(&msg->buf_pool_misses,	buffer);
+			safe_unpack64(&msg->buf_pool_returns,	buffer);
+			safe_unpack64(&msg->buf_pool_drops,	buffer);
+			safe_unpack32(&msg->buf_pool_cached,	buffer);
+			safe_unpack32(&msg->buf_pool_cached_max, buffer);
+
+			safe_unpack64(&msg->rpc_compress_cnt,	buffer);
+			safe_unpack64(&msg->rpc_compress_bytes_raw, buffer);
+			safe_unpack64(&msg->rpc_compress_bytes_sent, buffer);
+
+			safe_unpack64(&msg->conn_cache_opened,	buffer);
+			safe_unpack64(&msg->conn_cache_reused,	buffer);
+			safe_unpack64(&msg->conn_cache_reconnects, buffer);
+			safe_unpack32(&msg->conn_cache_cached,	buffer);
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
@@ -12233,6 +12530,40 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		safe_unpack16(&msg->lock_stats_enabled, buffer);
+		safe_unpackstr_array(&msg->lock_type_name,
+				     &msg->lock_type_size, buffer);
+		if (_unpack_lock_stats(msg->lock_type_size,
+				       &msg->lock_type_cnt,
+				       &msg->lock_type_wait,
+				       &msg->lock_type_wait_max,
+				       &msg->lock_type_hold,
+				       &msg->lock_type_hold_max, buffer))
+			goto unpack_error;
+		safe_unpackstr_array(&msg->lock_caller_name,
+				     &msg->lock_caller_size, buffer);
+		safe_unpack16_array(&msg->lock_caller_levels, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != msg->lock_caller_size)
+			goto unpack_error;
+		if (_unpack_lock_stats(msg->lock_caller_size,
+				       &msg->lock_caller_cnt,
+				       &msg->lock_caller_wait,
+				       &msg->lock_caller_wait_max,
+				       &msg->lock_caller_hold,
+				       &msg->lock_caller_hold_max, buffer))
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_type_latency, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != (msg->rpc_type_size * RPC_LATENCY_PARTS *
+				   RPC_LATENCY_PCTS))
+			goto unpack_error;
+		safe_unpack64_array(&msg->rpc_user_latency, &uint32_tmp,
+				    buffer);
+		if (uint32_tmp != (msg->rpc_user_size * RPC_LATENCY_PARTS *
+				   RPC_LATENCY_PCTS))
+			goto unpack_error;
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->parts_packed,	buffer);
 		if (msg->parts_packed) {
@@ -80,6 +80,14 @@ extern int unpack_header ( header_t * header , Buf buffer );
  */
 extern int pack_msg ( slurm_msg_t const * msg , Buf buffer );
 
+/* pack_msg_is_raw
+ * IN msg - the body structure to pack (note: includes message type)
+ * RET true if pack_msg() would only copy the already packed msg->data
+ *	(msg->data_size bytes) into the buffer, so the caller may transmit
+ *	msg->data directly instead
+ */
+extern bool pack_msg_is_raw(slurm_msg_t const *msg);
+
 /* unpack_msg
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
@@ -89,6 +97,17 @@ extern int pack_msg ( slurm_msg_t const * msg , Buf buffer );
  */
 extern int unpack_msg ( slurm_msg_t * msg , Buf buffer );
 
+/* unpack_msg_chunk
+ * unpacks one additional chunk of a message sent with SLURM_MSG_CHUNKED,
+ *	adding its records to the message body already unpacked by
+ *	unpack_msg(). Only RESPONSE_JOB_INFO is sent in chunks.
+ * IN/OUT msg - message to add the records to
+ * IN/OUT buffer - the chunk, contains pointers that are
+ *			automatically updated
+ * RET 0 or error code
+ */
+extern int unpack_msg_chunk(slurm_msg_t *msg, Buf buffer);
+
 /***************************************************************************/
 /* specific case statement Pack / Unpack methods for slurm protocol bodies */
 /***************************************************************************/
@@ -51,6 +51,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "slurm/slurm_errno.h"
@@ -146,9 +147,10 @@ extern ssize_t slurm_msg_recvfrom_timeout(int fd, char **pbuf, size_t *lenp,
 		slurm_seterrno_ret(SLURM_PROTOCOL_INSANE_MSG_LENGTH);
 
 	/*
-	 *  Allocate memory on heap for message
+	 *  Allocate memory on heap for message, the caller wraps it with
+	 *  create_buf() so free_buf() returns it to the buffer pool
 	 */
-	*pbuf = xmalloc_nz(msglen);
+	*pbuf = alloc_buf_data(msglen);
 
 	if (slurm_recv_timeout(fd, *pbuf, msglen, 0, tmout) != msglen) {
 		xfree(*pbuf);
@@ -170,8 +172,26 @@ extern ssize_t slurm_msg_sendto(int fd, char *buffer, size_t size)
 ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
 				 size_t size, int timeout)
 {
-	int   len;
+	struct iovec iov;
+
+	iov.iov_base = buffer;
+	iov.iov_len = size;
+	return slurm_msg_sendv_timeout(fd, &iov, 1, timeout);
+}
+
+extern ssize_t slurm_msg_sendv(int fd, struct iovec *iov, int iovcnt)
+{
+	return slurm_msg_sendv_timeout(fd, iov, iovcnt,
+				       (slurm_get_msg_timeout() * 1000));
+}
+
+extern ssize_t slurm_msg_sendv_timeout(int fd, struct iovec *iov, int iovcnt,
+				       int timeout)
+{
+	int   i, len;
+	size_t size = 0;
 	uint32_t usize;
+	struct iovec *msg_iov;
 	SigFunc *ohandler;
 
 	/*
@@ -180,18 +200,21 @@ ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
 	 */
 	ohandler = xsignal(SIGPIPE, SIG_IGN);
 
+	/* length prefix and all segments go out in as few calls as possible */
+	msg_iov = xmalloc(sizeof(struct iovec) * (iovcnt + 1));
+	for (i = 0; i < iovcnt; i++) {
+		msg_iov[i + 1] = iov[i];
+		size += iov[i].iov_len;
+	}
 	usize = htonl(size);
+	msg_iov[0].iov_base = &usize;
+	msg_iov[0].iov_len = sizeof(usize);
 
-	if ((len = slurm_send_timeout(
-				fd, (char *)&usize, sizeof(usize), 0,
-				timeout)) < 0)
-		goto done;
-
-	if ((len = slurm_send_timeout(fd, buffer, size, 0, timeout)) < 0)
-		goto done;
-
+	len = slurm_sendv_timeout(fd, msg_iov, iovcnt + 1, 0, timeout);
+	if (len >= 0)
+		len -= sizeof(usize);
 
-     done:
+	xfree(msg_iov);
 	xsignal(SIGPIPE, ohandler);
 	return len;
 }
@@ -200,15 +223,35 @@ ssize_t slurm_msg_sendto_timeout(int fd, char *buffer,
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 extern int slurm_send_timeout(int fd, char *buf, size_t size,
 			      uint32_t flags, int timeout)
+{
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len = size;
+	return slurm_sendv_timeout(fd, &iov, 1, flags, timeout);
+}
+
+/* Send the segments of iov in order with timeout, iov is modified
+ * RET total size of all segments or SLURM_ERROR on error */
+extern int slurm_sendv_timeout(int fd, struct iovec *iov, int iovcnt,
+			       uint32_t flags, int timeout)
 {
 	int rc;
 	int sent = 0;
-	int fd_flags;
+	size_t size = 0;
+	int fd_flags, i;
+	struct msghdr msg;
 	struct pollfd ufds;
 	struct timeval tstart;
 	int timeleft = timeout;
 	char temp[2];
 
+	for (i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = iovcnt;
+
 	ufds.fd     = fd;
 	ufds.events = POLLOUT;
 
@@ -265,7 +308,7 @@ extern int slurm_send_timeout(int fd, char *buf, size_t size,
 			      ufds.revents);
 		}
 
-		rc = send(fd, &buf[sent], (size - sent), flags);
+		rc = sendmsg(fd, &msg, flags);
 		if (rc < 0) {
  			if (errno == EINTR)
 				continue;
@@ -289,6 +332,18 @@ extern int slurm_send_timeout(int fd, char *buf, size_t size,
 		}
 
 		sent += rc;
+
+		/* skip fully sent segments, trim a partially sent one */
+		while ((msg.msg_iovlen > 0) && (rc >= msg.msg_iov->iov_len)) {
+			rc -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (rc > 0) {
+			msg.msg_iov->iov_base = (char *) msg.msg_iov->iov_base
+						+ rc;
+			msg.msg_iov->iov_len -= rc;
+		}
 	}
 
     done:
@@ -53,11 +53,19 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_route.h"
 #include "src/common/timers.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
 strong_alias(route_split_hostlist_treewidth,
 	     slurm_route_split_hostlist_treewidth);
+strong_alias(route_latency_weight, slurm_route_latency_weight);
+
+/* Penalties added to the answer time of a node, in milliseconds */
+#define ROUTE_WEIGHT_FAILED	100000	/* per recent failure */
+#define ROUTE_WEIGHT_UNAVAIL	1000000	/* DOWN or not responding */
+#define ROUTE_FAIL_CNT_MAX	10
+#define ROUTE_FAIL_MEMORY	300	/* seconds a failure is remembered */
 
 typedef struct slurm_route_ops {
 	int  (*split_hostlist)    (hostlist_t hl,
@@ -66,6 +74,7 @@ typedef struct slurm_route_ops {
 	int  (*reconfigure)       (void);
 	slurm_addr_t* (*next_collector) (bool* is_collector);
 	slurm_addr_t* (*next_collector_backup) (void);
+	int  (*node_weight)       (char *node_name);
 } slurm_route_ops_t;
 
 /*
@@ -75,7 +84,8 @@ static const char *syms[] = {
 	"route_p_split_hostlist",
 	"route_p_reconfigure",
 	"route_p_next_collector",
-	"route_p_next_collector_backup"
+	"route_p_next_collector_backup",
+	"route_p_node_weight"
 };
 
 static slurm_route_ops_t ops;
@@ -91,6 +101,51 @@ static slurm_addr_t *msg_collect_node = NULL; /* address of node to aggregate
 static uint32_t msg_backup_cnt = 0;
 static slurm_addr_t **msg_collect_backup  = NULL;
 
+/* What is known of each node as a forwarder */
+typedef struct {
+	char *name;
+	int latency;		/* average answer time in msec, -1 if unknown */
+	uint16_t fail_cnt;	/* failures since the last answer */
+	time_t fail_time;	/* time of the last failure */
+	bool unavail;		/* DOWN or not responding for slurmctld */
+} route_node_t;
+
+static pthread_mutex_t route_node_lock = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *route_node_hash = NULL;
+
+static void _route_node_id(void *item, const char **key, uint32_t *key_len)
+{
+	route_node_t *node = item;
+
+	*key = node->name;
+	*key_len = strlen(node->name);
+}
+
+static void _route_node_free(void *item)
+{
+	route_node_t *node = item;
+
+	xfree(node->name);
+	xfree(node);
+}
+
+/* Find or create the record of a node, call with route_node_lock held */
+static route_node_t *_route_node(char *node_name)
+{
+	route_node_t *node;
+
+	if (!route_node_hash)
+		route_node_hash = xhash_init(_route_node_id, _route_node_free);
+	else if ((node = xhash_get_str(route_node_hash, node_name)))
+		return node;
+
+	node = xmalloc(sizeof(route_node_t));
+	node->name = xstrdup(node_name);
+	node->latency = -1;
+	xhash_add(route_node_hash, node);
+	return node;
+}
+
 /* _get_all_nodes creates a hostlist containing all the nodes in the
  * node_record_table.
  *
@@ -356,6 +411,10 @@ extern int route_fini(void)
 	xfree(msg_collect_backup);
 	msg_backup_cnt = 0;
 
+	slurm_mutex_lock(&route_node_lock);
+	xhash_free(route_node_hash);
+	slurm_mutex_unlock(&route_node_lock);
+
 	return rc;
 }
 
@@ -459,6 +518,149 @@ extern slurm_addr_t* route_g_next_collector_backup(void)
 }
 
 
+/*
+ * route_g_node_weight - how well a node is expected to forward messages
+ *
+ * IN: node_name - char* - name of the node
+ *
+ * RET: int - weight of the node, lower is better
+ */
+extern int route_g_node_weight(char *node_name)
+{
+	if (route_init(NULL) != SLURM_SUCCESS)
+		return 0;
+
+	return (*(ops.node_weight))(node_name);
+}
+
+/*
+ * route_plan_forwarders - move the node of lowest weight in each list to its
+ *                         head, where it forwards to the rest of the list
+ *
+ * IN/OUT: sp_hl - hostlist_t*  - the array of hostlists to reorder
+ * IN: count     - int          - the count of hostlists
+ */
+extern void route_plan_forwarders(hostlist_t *sp_hl, int count)
+{
+	hostlist_iterator_t itr;
+	hostlist_t new_hl;
+	char *name, *best;
+	int i, weight, head_weight, best_weight;
+
+	for (i = 0; i < count; i++) {
+		if (hostlist_count(sp_hl[i]) < 2)
+			continue;
+
+		best = NULL;
+		head_weight = best_weight = -1;
+		itr = hostlist_iterator_create(sp_hl[i]);
+		while ((name = hostlist_next(itr))) {
+			weight = route_g_node_weight(name);
+			if (head_weight == -1) {
+				head_weight = best_weight = weight;
+			} else if (weight < best_weight) {
+				best_weight = weight;
+				if (best)
+					free(best);
+				best = name;
+				continue;
+			}
+			free(name);
+		}
+		hostlist_iterator_destroy(itr);
+		if (!best)
+			continue;	/* the head is as good as any */
+
+		if (debug_flags & DEBUG_FLAG_ROUTE)
+			info("ROUTE: forwarding through %s (weight %d) rather than weight %d",
+			     best, best_weight, head_weight);
+		new_hl = hostlist_create(best);
+		hostlist_delete_host(sp_hl[i], best);
+		hostlist_push_list(new_hl, sp_hl[i]);
+		hostlist_destroy(sp_hl[i]);
+		sp_hl[i] = new_hl;
+		free(best);
+	}
+}
+
+/*
+ * Levels of a message tree made of a node and the fwd_cnt nodes it forwards
+ * to, TreeWidth nodes forwarding at each level
+ */
+static int _tree_levels(int fwd_cnt)
+{
+	int width = MAX(g_tree_width, 2), levels = 1, level_cnt = 1;
+
+	while (fwd_cnt > 0) {
+		level_cnt *= width;
+		fwd_cnt -= level_cnt;
+		levels++;
+	}
+	return levels;
+}
+
+/*
+ * route_record_response - note how long a node took to answer a message,
+ *                         or that it did not answer
+ */
+extern void route_record_response(char *node_name, int fwd_cnt, int msec,
+				  bool failed)
+{
+	route_node_t *node;
+
+	if (!node_name)
+		return;
+
+	slurm_mutex_lock(&route_node_lock);
+	node = _route_node(node_name);
+	if (failed) {
+		if (node->fail_cnt < ROUTE_FAIL_CNT_MAX)
+			node->fail_cnt++;
+		node->fail_time = time(NULL);
+	} else {
+		node->fail_cnt = 0;
+		/*
+		 * The answer of a forwarder waits for its whole subtree,
+		 * share its time out over the levels of that subtree so it
+		 * compares with the time of a leaf.
+		 */
+		if (msec >= 0) {
+			msec /= _tree_levels(fwd_cnt);
+			if (node->latency < 0)
+				node->latency = msec;
+			else
+				node->latency = (node->latency * 7 + msec) / 8;
+		}
+	}
+	slurm_mutex_unlock(&route_node_lock);
+
+	if ((debug_flags & DEBUG_FLAG_ROUTE) && (msec >= 0)) {
+		if (fwd_cnt)
+			info("ROUTE: %s and the %d nodes it forwarded to %s after %d msec",
+			     node_name, fwd_cnt,
+			     failed ? "failed" : "answered", msec);
+		else
+			info("ROUTE: %s %s after %d msec", node_name,
+			     failed ? "failed" : "answered", msec);
+	}
+}
+
+/*
+ * route_set_node_avail - note if slurmctld considers the node usable
+ */
+extern void route_set_node_avail(char *node_name, bool avail)
+{
+	slurm_mutex_lock(&route_node_lock);
+	if (!avail)
+		_route_node(node_name)->unavail = true;
+	else if (route_node_hash) {
+		route_node_t *node = xhash_get_str(route_node_hash, node_name);
+		if (node)
+			node->unavail = false;
+	}
+	slurm_mutex_unlock(&route_node_lock);
+}
+
 /*
  * route_split_hostlist_treewidth - logic to split an input hostlist into
  *                                  a set of hostlists to forward to.
@@ -545,3 +747,32 @@ extern slurm_addr_t* route_next_collector_backup(int backup_inx)
 		return NULL;
 	return msg_collect_backup[backup_inx];
 }
+
+/*
+ * route_latency_weight - weight of a node from its recent answer times,
+ *                        recent failures and availability
+ *
+ * IN: node_name - char* - name of the node
+ *
+ * RET: int - expected answer time of the node in msec, plus penalties
+ */
+extern int route_latency_weight(char *node_name)
+{
+	route_node_t *node;
+	int weight = 0;
+
+	slurm_mutex_lock(&route_node_lock);
+	if (route_node_hash &&
+	    (node = xhash_get_str(route_node_hash, node_name))) {
+		if (node->latency > 0)
+			weight = node->latency;
+		if (node->fail_cnt &&
+		    (difftime(time(NULL), node->fail_time) < ROUTE_FAIL_MEMORY))
+			weight += ROUTE_WEIGHT_FAILED * node->fail_cnt;
+		if (node->unavail)
+			weight += ROUTE_WEIGHT_UNAVAIL;
+	}
+	slurm_mutex_unlock(&route_node_lock);
+
+	return weight;
+}
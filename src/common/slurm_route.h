@@ -106,6 +106,55 @@ extern slurm_addr_t* route_g_next_collector ( bool *is_collector );
  */
 extern slurm_addr_t* route_g_next_collector_backup ( void );
 
+/*
+ * route_g_node_weight - how well a node is expected to forward messages
+ *
+ * IN: node_name - char* - name of the node
+ *
+ * RET: int - weight of the node, nodes of lower weight are preferred as the
+ *            forwarders of a message tree
+ */
+extern int route_g_node_weight(char *node_name);
+
+/*****************************************************************************\
+ *  Forwarding tree planning
+\*****************************************************************************/
+
+/*
+ * route_plan_forwarders - move the node of lowest weight in each of the lists
+ *                         made by route_g_split_hostlist() to its head, so
+ *                         that the node forwarding to the rest of the list
+ *                         is the one most likely to answer quickly.
+ *
+ * IN/OUT: sp_hl - hostlist_t*  - the array of hostlists to reorder
+ * IN: count     - int          - the count of hostlists
+ */
+extern void route_plan_forwarders(hostlist_t *sp_hl, int count);
+
+/*
+ * route_record_response - note how long a node took to answer a message,
+ *                         or that it did not answer
+ *
+ * IN: node_name - char* - name of the node the message was sent to
+ * IN: fwd_cnt   - int   - count of nodes it forwarded the message to
+ * IN: msec      - int   - milliseconds until the (last) answer came back,
+ *                         -1 if not measured
+ * IN: failed    - bool  - the node could not be reached or did not answer
+ */
+extern void route_record_response(char *node_name, int fwd_cnt, int msec,
+				  bool failed);
+
+/*
+ * route_set_node_avail - note if slurmctld considers the node usable,
+ *                        nodes that are DOWN or not responding are only
+ *                        used as forwarders when no other node is left
+ *
+ * IN: node_name - char* - name of the node
+ * IN: avail     - bool  - false if the node is DOWN, not responding or
+ *                         powered down
+ */
+extern void route_set_node_avail(char *node_name, bool avail);
+
 
 /*****************************************************************************\
  *  Plugin Common Functions
@@ -152,4 +201,15 @@ extern slurm_addr_t* route_next_collector ( bool *is_collector );
  */
 extern slurm_addr_t* route_next_collector_backup(int backup_inx);
 
+/*
+ * route_latency_weight - weight of a node from its recent answer times,
+ *                        recent failures and availability
+ *
+ * IN: node_name - char* - name of the node
+ *
+ * RET: int - expected answer time of the node in milliseconds, plus a large
+ *            penalty if it recently failed or is not available
+ */
+extern int route_latency_weight(char *node_name);
+
 #endif /*___SLURM_ROUTE_PLUGIN_API_H__*/
@@ -57,11 +57,15 @@ struct switch_record {
 	char *nodes;			/* name if direct descendant nodes */
 	uint16_t  num_switches;         /* number of descendant switches */
 	uint16_t  parent;		/* index of parent switch */
+	bool multi_parent;		/* child of several switches, parent
+					 * is then only the last of them */
 	char *switches;			/* name of direct descendant switches */
 	uint16_t *switch_index;		/* indexes of child switches */
 	uint32_t temp;			/* temperature, in celsius */
 };
 
+#define SWITCH_NO_PARENT	0xffff	/* parent value of top level switch */
+
 extern struct switch_record *switch_record_table;  /* ptr to switch records */
 extern int switch_record_cnt;		/* size of switch_record_table */
 extern int switch_levels;               /* number of switch levels     */
@@ -103,12 +103,16 @@
 #define	bit_fls			slurm_bit_fls
 #define	bit_fill_gaps		slurm_bit_fill_gaps
 #define	bit_super_set		slurm_bit_super_set
+#define	bit_overlap_any		slurm_bit_overlap_any
+#define	bit_and_not_count	slurm_bit_and_not_count
+#define	bit_and3_count		slurm_bit_and3_count
 #define	bit_copy		slurm_bit_copy
 #define	bit_pick_cnt		slurm_bit_pick_cnt
 #define bit_nffc		slurm_bit_nffc
 #define bit_noc			slurm_bit_noc
 #define bit_nffs		slurm_bit_nffs
 #define bit_copybits		slurm_bit_copybits
+#define bit_simd_name		slurm_bit_simd_name
 
 /* fd.[ch] functions */
 #define fd_set_blocking		slurm_fd_set_blocking
@@ -411,6 +415,7 @@
 
 /* slurm_step_route.[ch] functions */
 #define route_split_hostlist_treewidth	slurm_route_split_hostlist_treewidth
+#define route_latency_weight		slurm_route_latency_weight
 
 
 #define eio_handle_create		slurm_eio_handle_create
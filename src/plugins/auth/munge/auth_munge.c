@@ -249,6 +249,71 @@ int slurm_auth_verify(slurm_auth_credential_t *c, char *opts)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Make an independent copy of a credential, including whether it has
+ * been verified.
+ */
+slurm_auth_credential_t *slurm_auth_dup(slurm_auth_credential_t *cred)
+{
+	slurm_auth_credential_t *copy;
+
+	if (!cred) {
+		slurm_seterrno(ESLURM_AUTH_BADARG);
+		return NULL;
+	}
+
+	xassert(cred->magic == MUNGE_MAGIC);
+
+	copy = xmalloc(sizeof(*copy));
+	xassert((copy->magic = MUNGE_MAGIC));
+	/* Note: Munge cred string not encoded with xmalloc() */
+	if (cred->m_str && !(copy->m_str = strdup(cred->m_str))) {
+		xfree(copy);
+		slurm_seterrno(ESLURM_AUTH_MEMORY);
+		return NULL;
+	}
+	copy->addr = cred->addr;
+	copy->verified = cred->verified;
+	copy->uid = cred->uid;
+	copy->gid = cred->gid;
+
+	return copy;
+}
+
+/*
+ * Verify a credential against one already verified on the same connection.
+ *
+ * The sender of a kept connection repeats the credential it used for the
+ * first message there, so a byte for byte match proves the same identity
+ * without another round trip to munged. munged would reject the repeat as
+ * a replay, which is why this is only done per connection: a credential
+ * copied onto any other connection still goes through munged.
+ *
+ * Return SLURM_SUCCESS if cred is now verified.
+ */
+int slurm_auth_verify_session(slurm_auth_credential_t *cred,
+			      slurm_auth_credential_t *session)
+{
+	if (!cred || !session) {
+		slurm_seterrno(ESLURM_AUTH_BADARG);
+		return SLURM_ERROR;
+	}
+
+	xassert(cred->magic == MUNGE_MAGIC);
+	xassert(session->magic == MUNGE_MAGIC);
+
+	if (!session->verified || !cred->m_str || !session->m_str ||
+	    xstrcmp(cred->m_str, session->m_str))
+		return SLURM_ERROR;
+
+	cred->addr = session->addr;
+	cred->uid = session->uid;
+	cred->gid = session->gid;
+	cred->verified = true;
+
+	return SLURM_SUCCESS;
+}
+
 /*
  * Obtain the Linux UID from the credential.
  * slurm_auth_verify() must be called first.
@@ -175,6 +175,45 @@ int slurm_auth_verify(slurm_auth_credential_t *cred, char *auth_info)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Make an independent copy of a credential, including whether it has
+ * been verified.
+ */
+slurm_auth_credential_t *slurm_auth_dup(slurm_auth_credential_t *cred)
+{
+	slurm_auth_credential_t *copy;
+
+	if (!cred) {
+		slurm_seterrno(ESLURM_AUTH_BADARG);
+		return NULL;
+	}
+
+	copy = xmalloc(sizeof(*copy));
+	copy->uid = cred->uid;
+	copy->gid = cred->gid;
+	copy->hostname = xstrdup(cred->hostname);
+
+	return copy;
+}
+
+/*
+ * Verify a credential against one already verified on the same connection.
+ * Return SLURM_SUCCESS if both carry the same identity.
+ */
+int slurm_auth_verify_session(slurm_auth_credential_t *cred,
+			      slurm_auth_credential_t *session)
+{
+	if (!cred || !session) {
+		slurm_seterrno(ESLURM_AUTH_BADARG);
+		return SLURM_ERROR;
+	}
+
+	if ((cred->uid != session->uid) || (cred->gid != session->gid))
+		return SLURM_ERROR;
+
+	return SLURM_SUCCESS;
+}
+
 /*
  * Obtain the Linux UID from the credential.  The accuracy of this data
  * is not assured until slurm_auth_verify() has been called for it.
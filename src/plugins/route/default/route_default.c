@@ -157,3 +157,15 @@ extern slurm_addr_t* route_p_next_collector_backup ( void )
 	 */
 	return NULL;
 }
+
+/*
+ * route_p_node_weight - how well a node is expected to forward messages
+ *
+ * IN: node_name - char* - name of the node
+ *
+ * RET: int - weight of the node, lower is better
+ */
+extern int route_p_node_weight(char *node_name)
+{
+	return route_latency_weight(node_name);
+}
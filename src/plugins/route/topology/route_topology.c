@@ -43,9 +43,11 @@
 #include "slurm/slurm_errno.h"
 #include "src/common/slurm_xlator.h"
 #include "src/common/forward.h"
+#include "src/common/list.h"
 #include "src/common/node_conf.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_topology.h"
+#include "src/common/xhash.h"
 #include "src/slurmctld/locks.h"
 
 /* These are defined here so when we link with something other than
@@ -91,10 +93,105 @@ const char plugin_name[]        = "route topology plugin";
 const char plugin_type[]        = "route/topology";
 const uint32_t plugin_version   = SLURM_VERSION_NUMBER;
 
+/* Number of hostlists whose split is remembered */
+#define ROUTE_CACHE_SIZE 128
+
+/* Split of a hostlist, as ranged strings of the sublists */
+typedef struct {
+	char *key;		/* "tree_width:hostlist" */
+	int count;
+	char **sublists;
+} route_cache_t;
+
 /* Global data */
 static uint64_t debug_flags = 0;
 static pthread_mutex_t route_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* Recently split hostlists, protected by route_lock */
+static xhash_t *route_cache = NULL;
+static List route_cache_order = NULL;	/* oldest first */
+
+static void _cache_id(void *item, const char **key, uint32_t *key_len)
+{
+	route_cache_t *entry = item;
+
+	*key = entry->key;
+	*key_len = strlen(entry->key);
+}
+
+static void _cache_free(void *item)
+{
+	route_cache_t *entry = item;
+	int i;
+
+	for (i = 0; i < entry->count; i++)
+		xfree(entry->sublists[i]);
+	xfree(entry->sublists);
+	xfree(entry->key);
+	xfree(entry);
+}
+
+/* Forget every split, the switch or node tables may have changed */
+static void _cache_purge(void)
+{
+	slurm_mutex_lock(&route_lock);
+	FREE_NULL_LIST(route_cache_order);
+	xhash_free(route_cache);
+	slurm_mutex_unlock(&route_lock);
+}
+
+/* Build the hostlists of a remembered split, RET false if there is none */
+static bool _cache_get(char *key, hostlist_t **sp_hl, int *count)
+{
+	route_cache_t *entry;
+	int i;
+
+	slurm_mutex_lock(&route_lock);
+	if (!route_cache || !(entry = xhash_get_str(route_cache, key))) {
+		slurm_mutex_unlock(&route_lock);
+		return false;
+	}
+	*sp_hl = xcalloc(entry->count, sizeof(hostlist_t));
+	for (i = 0; i < entry->count; i++)
+		(*sp_hl)[i] = hostlist_create(entry->sublists[i]);
+	*count = entry->count;
+	slurm_mutex_unlock(&route_lock);
+
+	return true;
+}
+
+static void _cache_add(char *key, hostlist_t *sp_hl, int count)
+{
+	route_cache_t *entry;
+	int i;
+
+	entry = xmalloc(sizeof(route_cache_t));
+	entry->key = xstrdup(key);
+	entry->count = count;
+	entry->sublists = xcalloc(count, sizeof(char *));
+	for (i = 0; i < count; i++)
+		entry->sublists[i] = hostlist_ranged_string_xmalloc(sp_hl[i]);
+
+	slurm_mutex_lock(&route_lock);
+	if (!route_cache) {
+		route_cache = xhash_init(_cache_id, _cache_free);
+		route_cache_order = list_create(NULL);
+	}
+	if (xhash_get_str(route_cache, key)) {
+		/* Split by another thread meanwhile */
+		slurm_mutex_unlock(&route_lock);
+		_cache_free(entry);
+		return;
+	}
+	if (list_count(route_cache_order) >= ROUTE_CACHE_SIZE) {
+		route_cache_t *oldest = list_pop(route_cache_order);
+		xhash_delete_str(route_cache, oldest->key);
+	}
+	xhash_add(route_cache, entry);
+	list_append(route_cache_order, entry);
+	slurm_mutex_unlock(&route_lock);
+}
+
 /*****************************************************************************\
  *  Functions required of all plugins
 \*****************************************************************************/
@@ -120,6 +217,7 @@ extern int init(void)
  */
 extern int fini(void)
 {
+	_cache_purge();
 	return SLURM_SUCCESS;
 }
 
@@ -137,31 +235,131 @@ static bool _run_in_slurmctld(void)
 	return run;
 }
 
-/*****************************************************************************\
- *  API Implementations
-\*****************************************************************************/
 /*
- * route_p_split_hostlist - logic to split an input hostlist into
- *                           a set of hostlists to forward to.
- *
- * IN: hl        - hostlist_t   - list of every node to send message to
- *                                will be empty on return;
- * OUT: sp_hl    - hostlist_t** - the array of hostlists that will be malloced
- * OUT: count    - int*         - the count of created hostlists
- * RET: SLURM_SUCCESS - int
- *
- * Note: created hostlist will have to be freed independently using
- *       hostlist_destroy by the caller.
- * Note: the hostlist_t array will have to be xfree.
+ * Append the nodes of the message list below switch sw to leaf, one bitmap
+ * per leaf switch, so that leaf switches sharing a parent are adjacent.
+ * The nodes found are removed from nodes_bitmap.
  */
-extern int route_p_split_hostlist(hostlist_t hl,
-				  hostlist_t** sp_hl,
-				  int* count, uint16_t tree_width)
+static void _leaf_groups(int sw, bitstr_t *nodes_bitmap, List leaf)
 {
-	int i, j, k, hl_ndx, msg_count, sw_count, lst_count;
+	struct switch_record *sw_ptr = &switch_record_table[sw];
+	bitstr_t *group;
+	int i;
+
+	if (sw_ptr->level == 0) {
+		group = bit_copy(sw_ptr->node_bitmap);
+		bit_and(group, nodes_bitmap);
+		if (bit_ffs(group) == -1) {
+			FREE_NULL_BITMAP(group);
+			return;
+		}
+		bit_and_not(nodes_bitmap, group);
+		list_append(leaf, group);
+		return;
+	}
+	for (i = 0; i < sw_ptr->num_switches; i++)
+		_leaf_groups(sw_ptr->switch_index[i], nodes_bitmap, leaf);
+}
+
+static void _add_sublist(hostlist_t **sp_hl, int *cnt, int *size,
+			 bitstr_t *bitmap)
+{
+	char *buf;
+
+	if (*cnt >= *size) {
+		*size *= 2;
+		xrealloc(*sp_hl, *size * sizeof(hostlist_t));
+	}
+	(*sp_hl)[*cnt] = bitmap2hostlist(bitmap);
+	if (debug_flags & DEBUG_FLAG_ROUTE) {
+		buf = hostlist_ranged_string_xmalloc((*sp_hl)[*cnt]);
+		debug("ROUTE: ... sublist[%d] %s", *cnt, buf);
+		xfree(buf);
+	}
+	(*cnt)++;
+}
+
+/*
+ * Split the nodes below switch sw into sublists of about msg_count /
+ * tree_width nodes, each made of whole leaf switches where possible.
+ * Small leaf switches next to each other are put in the same sublist and a
+ * large one is split into as many sublists as its size calls for, so the
+ * fanout follows the size and shape of the message list rather than the
+ * number of switches. The head of every sublist is then on a different
+ * leaf switch, except for the parts of a leaf switch that was split.
+ */
+static void _split_by_leaf(int sw, bitstr_t *nodes_bitmap, int msg_count,
+			   uint16_t tree_width, hostlist_t **sp_hl, int *count)
+{
+	List leaf = list_create(NULL);
+	bitstr_t *group, *bin = NULL, *part;
+	int target, size = tree_width, bin_cnt = 0, group_cnt, parts, i;
+
+	_leaf_groups(sw, nodes_bitmap, leaf);
+	if (bit_ffs(nodes_bitmap) != -1)	/* not below any leaf switch */
+		list_append(leaf, bit_copy(nodes_bitmap));
+
+	target = (msg_count + tree_width - 1) / tree_width;
+	*sp_hl = xcalloc(size, sizeof(hostlist_t));
+	*count = 0;
+	while ((group = list_pop(leaf))) {
+		group_cnt = bit_set_count(group);
+		if (group_cnt >= target) {
+			if (bin) {
+				_add_sublist(sp_hl, count, &size, bin);
+				FREE_NULL_BITMAP(bin);
+			}
+			/* Equal parts of about target nodes each */
+			parts = (group_cnt + target - 1) / target;
+			for (i = parts; i > 1; i--) {
+				part = bit_pick_cnt(group, group_cnt / i);
+				bit_and_not(group, part);
+				group_cnt -= group_cnt / i;
+				_add_sublist(sp_hl, count, &size, part);
+				FREE_NULL_BITMAP(part);
+			}
+			_add_sublist(sp_hl, count, &size, group);
+			FREE_NULL_BITMAP(group);
+			continue;
+		}
+		if (bin && ((bin_cnt + group_cnt) > target)) {
+			_add_sublist(sp_hl, count, &size, bin);
+			FREE_NULL_BITMAP(bin);
+		}
+		if (!bin) {
+			bin = group;
+			bin_cnt = group_cnt;
+		} else {
+			bit_or(bin, group);
+			bin_cnt += group_cnt;
+			FREE_NULL_BITMAP(group);
+		}
+	}
+	if (bin) {
+		_add_sublist(sp_hl, count, &size, bin);
+		FREE_NULL_BITMAP(bin);
+	}
+	FREE_NULL_LIST(leaf);
+}
+
+/*
+ * Callers such as forward.c expect every node of hl to be in the split and
+ * none left in hl, as with route_split_hostlist_treewidth()
+ */
+static void _empty_hostlist(hostlist_t hl)
+{
+	char *range;
+
+	while ((range = hostlist_shift_range(hl)))
+		free(range);
+}
+
+static int _split_hostlist(hostlist_t hl, hostlist_t** sp_hl,
+			   int* count, uint16_t tree_width)
+{
+	int i, j, msg_count;
 	char  *buf;
 	bitstr_t *nodes_bitmap = NULL;		/* nodes in message list */
-	bitstr_t *fwd_bitmap = NULL;		/* nodes in forward list */
 	slurmctld_lock_t node_read_lock = { .node = READ_LOCK };
 
 	msg_count = hostlist_count(hl);
@@ -184,7 +382,6 @@ extern int route_p_split_hostlist(hostlist_t hl,
 		}
 	}
 	slurm_mutex_unlock(&route_lock);
-	*sp_hl = (hostlist_t*) xmalloc(switch_record_cnt * sizeof(hostlist_t));
 	/* Only acquire the slurmctld lock if running as the slurmctld. */
 	if (_run_in_slurmctld())
 		lock_slurmctld(node_read_lock);
@@ -228,49 +425,74 @@ extern int route_p_split_hostlist(hostlist_t hl,
 			xfree(buf);
 		}
 		FREE_NULL_BITMAP(nodes_bitmap);
-		xfree(*sp_hl);
 		return route_split_hostlist_treewidth(
 			hl, sp_hl, count, tree_width);
 	}
 	if (switch_record_table[j].level == 0) {
 		/* This is a leaf switch. Construct list based on TreeWidth */
 		FREE_NULL_BITMAP(nodes_bitmap);
-		xfree(*sp_hl);
 		return route_split_hostlist_treewidth(
 			hl, sp_hl, count, tree_width);
 	}
-	/* loop through children, construction a hostlist for each child switch
-	 * with nodes in the message list */
-	hl_ndx = 0;
-	lst_count = 0;
-	for (i=0; i < switch_record_table[j].num_switches; i++) {
-		k = switch_record_table[j].switch_index[i];
-		fwd_bitmap = bit_copy(switch_record_table[k].node_bitmap);
-		bit_and(fwd_bitmap, nodes_bitmap);
-		sw_count = bit_set_count(fwd_bitmap);
-		if (sw_count == 0) {
-			continue; /* no nodes on this switch in message list */
-		}
-		(*sp_hl)[hl_ndx] = bitmap2hostlist(fwd_bitmap);
-		/* Now remove nodes from this switch from message list */
-		bit_and_not(nodes_bitmap, fwd_bitmap);
-		FREE_NULL_BITMAP(fwd_bitmap);
-		if (debug_flags & DEBUG_FLAG_ROUTE) {
-			buf = hostlist_ranged_string_xmalloc((*sp_hl)[hl_ndx]);
-			debug("ROUTE: ... sublist[%d] switch=%s :: %s",
-			      i, switch_record_table[i].name, buf);
-			xfree(buf);
-		}
-		hl_ndx++;
-		lst_count += sw_count;
-		if (lst_count == msg_count)
-			break; /* all nodes in message are in a child list */
-	}
+	_split_by_leaf(j, nodes_bitmap, msg_count, tree_width, sp_hl, count);
 	FREE_NULL_BITMAP(nodes_bitmap);
 
-	*count = hl_ndx;
 	return SLURM_SUCCESS;
+}
+
+/*****************************************************************************\
+ *  API Implementations
+\*****************************************************************************/
+/*
+ * route_p_split_hostlist - logic to split an input hostlist into
+ *                           a set of hostlists to forward to.
+ *
+ * The same nodes are often sent to again (e.g. a job's nodes at launch,
+ * signal and termination), so the last ROUTE_CACHE_SIZE splits are
+ * remembered until the next reconfiguration.
+ *
+ * IN: hl        - hostlist_t   - list of every node to send message to
+ *                                will be empty on return;
+ * OUT: sp_hl    - hostlist_t** - the array of hostlists that will be malloced
+ * OUT: count    - int*         - the count of created hostlists
+ * RET: SLURM_SUCCESS - int
+ *
+ * Note: created hostlist will have to be freed independently using
+ *       hostlist_destroy by the caller.
+ * Note: the hostlist_t array will have to be xfree.
+ */
+extern int route_p_split_hostlist(hostlist_t hl,
+				  hostlist_t** sp_hl,
+				  int* count, uint16_t tree_width)
+{
+	char *hl_str, *key = NULL;
+	int rc;
+
+	if (!tree_width)
+		tree_width = slurm_get_tree_width();
+	if (!tree_width)
+		tree_width = 1;
+
+	hl_str = hostlist_ranged_string_xmalloc(hl);
+	xstrfmtcat(key, "%u:%s", tree_width, hl_str);
+	if (_cache_get(key, sp_hl, count)) {
+		if (debug_flags & DEBUG_FLAG_ROUTE)
+			debug("ROUTE: split of %s found in cache", hl_str);
+		xfree(hl_str);
+		xfree(key);
+		_empty_hostlist(hl);
+		return SLURM_SUCCESS;
+	}
+	xfree(hl_str);
+
+	rc = _split_hostlist(hl, sp_hl, count, tree_width);
+	if (rc == SLURM_SUCCESS) {
+		_cache_add(key, *sp_hl, *count);
+		_empty_hostlist(hl);
+	}
+	xfree(key);
 
+	return rc;
 }
 
 /*
@@ -281,6 +503,7 @@ extern int route_p_split_hostlist(hostlist_t hl,
 extern int route_p_reconfigure (void)
 {
 	debug_flags = slurm_get_debug_flags();
+	_cache_purge();
 	return SLURM_SUCCESS;
 }
 
@@ -311,3 +534,15 @@ extern slurm_addr_t* route_p_next_collector_backup ( void )
 	 */
 	return NULL;
 }
+
+/*
+ * route_p_node_weight - how well a node is expected to forward messages
+ *
+ * IN: node_name - char* - name of the node
+ *
+ * RET: int - weight of the node, lower is better
+ */
+extern int route_p_node_weight(char *node_name)
+{
+	return route_latency_weight(node_name);
+}
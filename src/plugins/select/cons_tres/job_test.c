@@ -1038,16 +1038,16 @@ static int _handle_job_res(job_resources_t *job_resrcs_ptr,
 	if (!job_resrcs_ptr->core_bitmap)
 		return 1;
 
-	/* create row_bitmap data structure as needed */
+	/*
+	 * Create row_bitmap data structure as needed. The per-node bitmaps
+	 * are only allocated once a job is added to that node and released
+	 * when the last core is removed, so a NULL entry is an empty node.
+	 */
 	if (*sys_resrcs_ptr == NULL) {
 		if (type == HANDLE_JOB_RES_TEST)
 			return 1;
-		core_array = xmalloc(sizeof(bitstr_t *) * select_node_cnt);
+		core_array = build_core_array();
 		*sys_resrcs_ptr = core_array;
-		for (i = 0; i < select_node_cnt; i++) {
-			core_array[i] =
-				bit_alloc(select_node_record[i].tot_cores);
-		}
 	} else
 		core_array = *sys_resrcs_ptr;
 
@@ -1061,10 +1061,10 @@ static int _handle_job_res(job_resources_t *job_resrcs_ptr,
 			continue;
 		if (job_resrcs_ptr->whole_node) {
 			if (!core_array[i]) {
-				if (type != HANDLE_JOB_RES_TEST)
-					error("%s: %s: core_array[%d] is NULL %d",
-					      plugin_type, __func__, i, type);
-				continue;	/* Move to next node */
+				if (type != HANDLE_JOB_RES_ADD)
+					continue;	/* Move to next node */
+				core_array[i] = bit_alloc(
+					select_node_record[i].tot_cores);
 			}
 
 			switch (type) {
@@ -1072,7 +1072,7 @@ static int _handle_job_res(job_resources_t *job_resrcs_ptr,
 				bit_set_all(core_array[i]);
 				break;
 			case HANDLE_JOB_RES_REM:
-				bit_clear_all(core_array[i]);
+				FREE_NULL_BITMAP(core_array[i]);
 				break;
 			case HANDLE_JOB_RES_TEST:
 				if (bit_ffs(core_array[i]) != -1)
@@ -1090,15 +1090,17 @@ static int _handle_job_res(job_resources_t *job_resrcs_ptr,
 		c_job = job_resrcs_ptr->sockets_per_node[rep_inx] *
 			job_resrcs_ptr->cores_per_socket[rep_inx];
 		c_max = MIN(select_node_record[i].tot_cores, c_job);
+		if (!core_array[i]) {
+			if (type != HANDLE_JOB_RES_ADD) {
+				c_off += c_job;
+				continue;	/* Move to next node */
+			}
+			core_array[i] = bit_alloc(
+				select_node_record[i].tot_cores);
+		}
 		for (c = 0; c < c_max; c++) {
 			if (!bit_test(job_resrcs_ptr->core_bitmap, c_off + c))
 				continue;
-			if (!core_array[i]) {
-				if (type != HANDLE_JOB_RES_TEST)
-					error("%s: %s: core_array[%d] is NULL %d",
-					      plugin_type, __func__, i, type);
-				continue;	/* Move to next node */
-			}
 			switch (type) {
 			case HANDLE_JOB_RES_ADD:
 				bit_set(core_array[i], c);
@@ -1112,6 +1114,9 @@ static int _handle_job_res(job_resources_t *job_resrcs_ptr,
 				break;
 			}
 		}
+		if ((type == HANDLE_JOB_RES_REM) &&
+		    (bit_ffs(core_array[i]) == -1))
+			FREE_NULL_BITMAP(core_array[i]);
 		c_off += c_job;
 	}
 	return 1;
@@ -3411,6 +3416,147 @@ static int _topo_weight_sort(void *x, void *y)
 	return (int) (nwt1->weight - nwt2->weight);
 }
 
+/*
+ * Set switch_node_cnt[] to the count of nodes in node_bitmap which are
+ * reachable from each switch. Leaf switch counts are accumulated from each
+ * node's leaf_switch and then summed up the switch hierarchy, so the cost
+ * scales with the number of nodes in node_bitmap rather than with
+ * switch_record_cnt times the bitmap size.
+ * RET true if no node in node_bitmap is on multiple leaf switches. Otherwise
+ *     the counts of higher level switches may include some nodes twice.
+ */
+static bool _topo_switch_node_cnt(bitstr_t *node_bitmap, int *switch_node_cnt)
+{
+	struct switch_record *switch_ptr;
+	int i, i_first, i_last, j, level;
+	bool single_homed = true;
+
+	memset(switch_node_cnt, 0, sizeof(int) * switch_record_cnt);
+	i_first = bit_ffs(node_bitmap);
+	if (i_first == -1)
+		return single_homed;
+	i_last = bit_fls(node_bitmap);
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(node_bitmap, i))
+			continue;
+		j = node_record_table_ptr[i].leaf_switch;
+		if (j >= 0) {
+			switch_node_cnt[j]++;
+			continue;
+		}
+		if (j == -1)
+			continue;
+		single_homed = false;
+		for (j = 0, switch_ptr = switch_record_table;
+		     j < switch_record_cnt; j++, switch_ptr++) {
+			if ((switch_ptr->level == 0) &&
+			    switch_ptr->node_bitmap &&
+			    bit_test(switch_ptr->node_bitmap, i))
+				switch_node_cnt[j]++;
+		}
+	}
+
+	for (level = 1; level <= switch_levels; level++) {
+		for (i = 0, switch_ptr = switch_record_table;
+		     i < switch_record_cnt; i++, switch_ptr++) {
+			if (switch_ptr->level != level)
+				continue;
+			for (j = 0; j < switch_ptr->num_switches; j++) {
+				switch_node_cnt[i] += switch_node_cnt[
+					switch_ptr->switch_index[j]];
+			}
+		}
+	}
+
+	return single_homed;
+}
+
+/* Return true if leaf switch leaf1 is a better choice than leaf2 */
+static bool _topo_leaf_better(int leaf1, int leaf2, int *switch_node_cnt)
+{
+	if (leaf1 == -1)
+		return false;
+	if (leaf2 == -1)
+		return true;
+	if (switch_node_cnt[leaf1] != switch_node_cnt[leaf2])
+		return (switch_node_cnt[leaf1] > switch_node_cnt[leaf2]);
+	return (leaf1 < leaf2);
+}
+
+/*
+ * Set switch_best_leaf[] for one switch: the not yet required leaf switch
+ * with the most available nodes at or below it, or -1 if none.
+ */
+static void _topo_best_leaf_set(int switch_inx, int *switch_best_leaf,
+				int *switch_node_cnt, int *switch_required)
+{
+	struct switch_record *switch_ptr = switch_record_table + switch_inx;
+	int i, leaf, best = -1;
+
+	if (switch_ptr->level == 0) {
+		if (!switch_required[switch_inx] &&
+		    switch_node_cnt[switch_inx])
+			best = switch_inx;
+	} else {
+		for (i = 0; i < switch_ptr->num_switches; i++) {
+			leaf = switch_best_leaf[switch_ptr->switch_index[i]];
+			if (_topo_leaf_better(leaf, best, switch_node_cnt))
+				best = leaf;
+		}
+	}
+	switch_best_leaf[switch_inx] = best;
+}
+
+/* Build switch_best_leaf[] for every switch, from the leaves upward */
+static void _topo_best_leaf_build(int *switch_best_leaf, int *switch_node_cnt,
+				  int *switch_required)
+{
+	int i, level;
+
+	for (level = 0; level <= switch_levels; level++) {
+		for (i = 0; i < switch_record_cnt; i++) {
+			if (switch_record_table[i].level != level)
+				continue;
+			_topo_best_leaf_set(i, switch_best_leaf,
+					    switch_node_cnt, switch_required);
+		}
+	}
+}
+
+/*
+ * RET true if a switch has multiple parents. Only the ancestors reached
+ * through the parent links are refreshed by _topo_best_leaf_update(), so the
+ * best leaf of a switch's other parents would then be stale.
+ */
+static bool _topo_multi_parent(void)
+{
+	int i;
+
+	for (i = 0; i < switch_record_cnt; i++) {
+		if (switch_record_table[i].multi_parent)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Refresh switch_best_leaf[] for a leaf switch whose node count changed and
+ * for each of its ancestors.
+ */
+static void _topo_best_leaf_update(int leaf_inx, int *switch_best_leaf,
+				   int *switch_node_cnt, int *switch_required)
+{
+	int i = leaf_inx;
+
+	while (1) {
+		_topo_best_leaf_set(i, switch_best_leaf, switch_node_cnt,
+				    switch_required);
+		if (switch_record_table[i].parent == SWITCH_NO_PARENT)
+			break;
+		i = switch_record_table[i].parent;
+	}
+}
+
 /*
  * Allocate resources to the job on one leaf switch if possible,
  * otherwise distribute the job allocation over many leaf switches.
@@ -4062,9 +4208,9 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 {
 	int       *switch_cpu_cnt = NULL;	/* total CPUs on switch */
 	List      *switch_gres = NULL;		/* available GRES on switch */
-	bitstr_t **switch_node_bitmap = NULL;	/* nodes on this switch */
 	int       *switch_node_cnt = NULL;	/* total nodes on switch */
 	int       *switch_required = NULL;	/* set if has required node */
+	int       *switch_best_leaf = NULL;	/* best leaf below switch */
 	bitstr_t  *avail_nodes_bitmap = NULL;	/* nodes on any switch */
 	bitstr_t  *req_nodes_bitmap   = NULL;	/* required node bitmap */
 	bitstr_t  *req2_nodes_bitmap  = NULL;	/* required+lowest prio nodes */
@@ -4088,8 +4234,9 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 	uint16_t *avail_cpu_per_node = NULL;
 	int64_t time_waiting = 0;
 	int leaf_switch_count = 0, req_leaf_switch_count = 0;
-	int top_switch_inx = -1;
+	int top_switch_inx = -1, root_switch_inx;
 	int prev_rem_nodes;
+	bool single_homed, multi_parent;
 
 	if (job_ptr->req_switch) {
 		time_t     time_now;
@@ -4224,35 +4371,30 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 	 */
 	switch_cpu_cnt     = xmalloc(sizeof(int)        * switch_record_cnt);
 	switch_gres        = xmalloc(sizeof(List)       * switch_record_cnt);
-	switch_node_bitmap = xmalloc(sizeof(bitstr_t *) * switch_record_cnt);
 	switch_node_cnt    = xmalloc(sizeof(int)        * switch_record_cnt);
 	switch_required    = xmalloc(sizeof(int)        * switch_record_cnt);
+	switch_best_leaf   = xmalloc(sizeof(int)        * switch_record_cnt);
 
-	if (!req_nodes_bitmap)
+	if (req_nodes_bitmap) {
+		(void) _topo_switch_node_cnt(req_nodes_bitmap, switch_node_cnt);
+	} else {
 		nw = list_peek(node_weight_list);
-	for (i = 0, switch_ptr = switch_record_table; i < switch_record_cnt;
-	     i++, switch_ptr++) {
-		switch_node_bitmap[i] = bit_copy(switch_ptr->node_bitmap);
-		if (req_nodes_bitmap &&
-		    bit_overlap(req_nodes_bitmap, switch_node_bitmap[i])) {
+		(void) _topo_switch_node_cnt(nw->node_bitmap, switch_node_cnt);
+	}
+	for (i = 0; i < switch_record_cnt; i++) {
+		if (!switch_node_cnt[i])
+			continue;
+		if (req_nodes_bitmap) {
 			switch_required[i] = 1;
 			if (switch_record_table[i].level == 0) {
 				leaf_switch_count++;
 				req_leaf_switch_count++;
 			}
-			if ((top_switch_inx == -1) ||
-			    (switch_record_table[i].level >
-			     switch_record_table[top_switch_inx].level)) {
-				top_switch_inx = i;
-			}
 		}
-		if (!req_nodes_bitmap &&
-		    bit_overlap(nw->node_bitmap, switch_node_bitmap[i])) {
-			if ((top_switch_inx == -1) ||
-			    (switch_record_table[i].level >
-			     switch_record_table[top_switch_inx].level)) {
-				top_switch_inx = i;
-			}
+		if ((top_switch_inx == -1) ||
+		    (switch_record_table[i].level >
+		     switch_record_table[top_switch_inx].level)) {
+			top_switch_inx = i;
 		}
 	}
 
@@ -4271,23 +4413,13 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 	/* Check that all specificly required nodes are on shared network */
 	if (req_nodes_bitmap &&
 	    !bit_super_set(req_nodes_bitmap,
-			   switch_node_bitmap[top_switch_inx])) {
+			   switch_record_table[top_switch_inx].node_bitmap)) {
 		rc = SLURM_ERROR;
 		info("%s: %s: %pJ requires nodes that do not have shared network",
 		     plugin_type, __func__, job_ptr);
 		goto fini;
 	}
-
-	/*
-	 * Remove nodes from consideration that can not be reached from this
-	 * top level switch.
-	 */
-	for (i = 0; i < switch_record_cnt; i++) {
-		if (top_switch_inx != i) {
-			  bit_and(switch_node_bitmap[i],
-				  switch_node_bitmap[top_switch_inx]);
-		}
-	}
+	root_switch_inx = top_switch_inx;
 
 	/*
 	 * Identify the best set of nodes (i.e. nodes with the lowest weight,
@@ -4319,7 +4451,8 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 			if (avail_cpu_per_node[i])
 				continue;	/* Required node */
 			if (!bit_test(nw->node_bitmap, i) ||
-			    !bit_test(switch_node_bitmap[top_switch_inx], i))
+			    !bit_test(switch_record_table[root_switch_inx].
+				      node_bitmap, i))
 				continue;
 			_select_cores(job_ptr, mc_ptr, enforce_binding, i,
 				      &avail_cpus, max_nodes, min_rem_nodes,
@@ -4403,17 +4536,15 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 			}
 		}
 
-		for (i = 0, switch_ptr = switch_record_table;
-		     i < switch_record_cnt; i++, switch_ptr++) {
-			if (switch_required[i])
+		(void) _topo_switch_node_cnt(req2_nodes_bitmap,
+					     switch_node_cnt);
+		for (i = 0; i < switch_record_cnt; i++) {
+			if (switch_required[i] || !switch_node_cnt[i])
 				continue;
-			if (bit_overlap(req2_nodes_bitmap,
-					switch_node_bitmap[i])) {
-				switch_required[i] = 1;
-				if (switch_record_table[i].level == 0) {
-					leaf_switch_count++;
-					req_leaf_switch_count++;
-				}
+			switch_required[i] = 1;
+			if (switch_record_table[i].level == 0) {
+				leaf_switch_count++;
+				req_leaf_switch_count++;
 			}
 		}
 		bit_or(node_map, req2_nodes_bitmap);
@@ -4446,24 +4577,25 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 	}
 
 	/*
-	 * Construct a set of switch array entries.
+	 * Count the usable nodes on each switch.
 	 * Use the same indexes as switch_record_table in slurmctld.
 	 */
 	bit_or(best_nodes_bitmap, node_map);
-	avail_nodes_bitmap = bit_alloc(node_record_count);
-	for (i = 0, switch_ptr = switch_record_table; i < switch_record_cnt;
-	     i++, switch_ptr++) {
-		bit_and(switch_node_bitmap[i], best_nodes_bitmap);
-		bit_or(avail_nodes_bitmap, switch_node_bitmap[i]);
-		switch_node_cnt[i] = bit_set_count(switch_node_bitmap[i]);
-	}
+	avail_nodes_bitmap = bit_copy(best_nodes_bitmap);
+	bit_and(avail_nodes_bitmap,
+		switch_record_table[root_switch_inx].node_bitmap);
+	single_homed = _topo_switch_node_cnt(avail_nodes_bitmap,
+					     switch_node_cnt);
 
 	if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
 		for (i = 0; i < switch_record_cnt; i++) {
 			char *node_names = NULL;
 			if (switch_node_cnt[i]) {
-				node_names =
-					bitmap2node_name(switch_node_bitmap[i]);
+				bitstr_t *tmp_bitmap = bit_copy(
+					switch_record_table[i].node_bitmap);
+				bit_and(tmp_bitmap, avail_nodes_bitmap);
+				node_names = bitmap2node_name(tmp_bitmap);
+				FREE_NULL_BITMAP(tmp_bitmap);
 			}
 			info("switch=%s level=%d nodes=%u:%s required:%u speed:%u",
 			     switch_record_table[i].name,
@@ -4495,17 +4627,19 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 
 	/* Add additional resources for already required leaf switches */
 	if (req_leaf_switch_count) {
-		for (i = 0; i < switch_record_cnt; i++) {
-			if (!switch_required[i] || !switch_node_bitmap[i] ||
-			    (switch_record_table[i].level != 0))
+		for (i = 0, switch_ptr = switch_record_table;
+		     i < switch_record_cnt; i++, switch_ptr++) {
+			if (!switch_required[i] || !switch_node_cnt[i] ||
+			    (switch_ptr->level != 0))
 				continue;
-			i_first = bit_ffs(switch_node_bitmap[i]);
+			i_first = bit_ffs(switch_ptr->node_bitmap);
 			if (i_first >= 0)
-				i_last = bit_fls(switch_node_bitmap[i]);
+				i_last = bit_fls(switch_ptr->node_bitmap);
 			else
 				i_last = -2;
 			for (j = i_first; j <= i_last; j++) {
-				if (!bit_test(switch_node_bitmap[i], j) ||
+				if (!bit_test(switch_ptr->node_bitmap, j) ||
+				    !bit_test(avail_nodes_bitmap, j) ||
 				    bit_test(node_map, j) ||
 				    !avail_cpu_per_node[j])
 					continue;
@@ -4536,7 +4670,15 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 		}
 	}
 
-	/* Add additional resources as required from additional leaf switches */
+	/*
+	 * Add additional resources as required from additional leaf switches.
+	 * Each switch records the best unused leaf switch below it, so the
+	 * next leaf is found at the top switch and only the ancestors of a
+	 * consumed leaf need to be refreshed.
+	 */
+	_topo_best_leaf_build(switch_best_leaf, switch_node_cnt,
+			      switch_required);
+	multi_parent = _topo_multi_parent();
 	prev_rem_nodes = rem_nodes + 1;
 	while (1) {
 		if (prev_rem_nodes == rem_nodes)
@@ -4552,16 +4694,25 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 			rc = SLURM_ERROR;
 			goto fini;
 		}
-		top_switch_inx = -1;
-		for (i = 0; i < switch_record_cnt; i++) {
-			if (switch_required[i] || !switch_node_bitmap[i] ||
-			    (switch_record_table[i].level != 0))
-				continue;
-			if (switch_node_cnt[i] &&
-			    ((top_switch_inx == -1) ||
-			     (switch_node_cnt[i] >
-			      switch_node_cnt[top_switch_inx])))
-				top_switch_inx = i;
+		top_switch_inx = switch_best_leaf[root_switch_inx];
+		if (!single_homed || multi_parent ||
+		    ((top_switch_inx != -1) &&
+		     !switch_node_cnt[top_switch_inx])) {
+			/*
+			 * Nodes on multiple leaf switches or switches with
+			 * multiple parents, search all leaf switches
+			 */
+			top_switch_inx = -1;
+			for (i = 0; i < switch_record_cnt; i++) {
+				if (switch_required[i] ||
+				    (switch_record_table[i].level != 0))
+					continue;
+				if (switch_node_cnt[i] &&
+				    ((top_switch_inx == -1) ||
+				     (switch_node_cnt[i] >
+				      switch_node_cnt[top_switch_inx])))
+					top_switch_inx = i;
+			}
 		}
 		if (top_switch_inx == -1)
 			break;
@@ -4571,13 +4722,15 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 		 * availability rather than in order of bitmap position, but
 		 * that would add even more complexity and overhead.
 		 */
-		i_first = bit_ffs(switch_node_bitmap[top_switch_inx]);
+		switch_ptr = switch_record_table + top_switch_inx;
+		i_first = bit_ffs(switch_ptr->node_bitmap);
 		if (i_first >= 0)
-			i_last = bit_fls(switch_node_bitmap[top_switch_inx]);
+			i_last = bit_fls(switch_ptr->node_bitmap);
 		else
 			i_last = -2;
 		for (i = i_first; ((i <= i_last) && (max_nodes > 0)); i++) {
-			if (!bit_test(switch_node_bitmap[top_switch_inx], i) ||
+			if (!bit_test(switch_ptr->node_bitmap, i) ||
+			    !bit_test(avail_nodes_bitmap, i) ||
 			    bit_test(node_map, i) ||
 			    !avail_cpu_per_node[i])
 				continue;
@@ -4603,6 +4756,8 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 			}
 		}
 		switch_node_cnt[top_switch_inx] = 0;	/* Used all */
+		_topo_best_leaf_update(top_switch_inx, switch_best_leaf,
+				       switch_node_cnt, switch_required);
 	}
 	if ((min_rem_nodes <= 0) && (rem_cpus <= 0) &&
 	    (!gres_per_job ||
@@ -4621,13 +4776,9 @@ fini:	FREE_NULL_LIST(best_gres);
 	xfree(avail_cpu_per_node);
 	xfree(switch_cpu_cnt);
 	xfree(switch_gres);
-	if (switch_node_bitmap) {
-		for (i = 0; i < switch_record_cnt; i++)
-			FREE_NULL_BITMAP(switch_node_bitmap[i]);
-		xfree(switch_node_bitmap);
-	}
 	xfree(switch_node_cnt);
 	xfree(switch_required);
+	xfree(switch_best_leaf);
 	return rc;
 }
 
@@ -5797,8 +5948,6 @@ static avail_res_t *_can_job_run_on_node(struct job_record *job_ptr,
 		return NULL;
 	}
 
-	if (part_core_map)
-		part_core_map_ptr = part_core_map[node_i];
 	if (node_usage[node_i].gres_list)
 		node_gres_list = node_usage[node_i].gres_list;
 	else
@@ -5830,6 +5979,15 @@ static avail_res_t *_can_job_run_on_node(struct job_record *job_ptr,
 		}
 	}
 
+	if (part_core_map) {
+		part_core_map_ptr = part_core_map[node_i];
+		if (!part_core_map_ptr) {
+			/* Row maps are sparse, no partition jobs on node */
+			part_core_map_ptr =
+				select_node_record[node_i].empty_core_map;
+		}
+	}
+
 	/* Identify available CPUs */
 	if (cr_type & CR_CORE) {
 		/* cpu_alloc_size = # of CPUs per core */
@@ -6898,17 +7056,18 @@ extern bitstr_t **build_core_array(void)
 	return row_bitmap;
 }
 
-/* Clear all elements of an array of bitmaps, one per node */
+/*
+ * Clear all elements of an array of bitmaps, one per node. The per-node
+ * bitmaps are released rather than zeroed, a NULL element is an empty node.
+ */
 extern void clear_core_array(bitstr_t **core_array)
 {
 	int n;
 
 	if (!core_array)
 		return;
-	for (n = 0; n < select_node_cnt; n++) {
-		if (core_array[n])
-			bit_clear_all(core_array[n]);
-	}
+	for (n = 0; n < select_node_cnt; n++)
+		FREE_NULL_BITMAP(core_array[n]);
 }
 
 /*
@@ -66,7 +66,7 @@ extern void build_row_bitmaps(struct part_res_record *p_ptr,
 extern int can_job_fit_in_row(struct job_resources *job,
 			      struct part_row_data *r_ptr);
 
-/* Clear all elements of an array of bitmaps, one per node */
+/* Clear (release) all elements of an array of bitmaps, one per node */
 extern void clear_core_array(bitstr_t **core_array);
 
 /*
@@ -67,6 +67,7 @@ extern int node_record_count __attribute__((weak_import));
 extern time_t last_node_update __attribute__((weak_import));
 extern struct switch_record *switch_record_table __attribute__((weak_import));
 extern int switch_record_cnt __attribute__((weak_import));
+extern int switch_levels __attribute__((weak_import));
 extern bitstr_t *avail_node_bitmap __attribute__((weak_import));
 extern uint16_t *cr_node_num_cores __attribute__((weak_import));
 extern uint32_t *cr_node_cores_offset __attribute__((weak_import));
@@ -81,6 +82,7 @@ int node_record_count;
 time_t last_node_update;
 struct switch_record *switch_record_table;
 int switch_record_cnt;
+int switch_levels;
 bitstr_t *avail_node_bitmap;
 uint16_t *cr_node_num_cores;
 uint32_t *cr_node_cores_offset;
@@ -1107,6 +1109,8 @@ extern int select_p_node_init(struct node_record *node_ptr, int node_cnt)
 		if (select_node_record[i].tot_cores >=
 		    select_node_record[i].cpus)
 			select_node_record[i].vpus = 1;
+		select_node_record[i].empty_core_map =
+				bit_alloc(select_node_record[i].tot_cores);
 		select_node_usage[i].node_state = NODE_CR_AVAILABLE;
 		gres_plugin_node_state_dealloc_all(
 				select_node_record[i].node_ptr->gres_list);
@@ -2671,7 +2675,11 @@ extern void cr_destroy_node_data(struct node_use_record *node_usage,
 {
 	int i;
 
-	xfree(node_data);
+	if (node_data) {
+		for (i = 0; i < select_node_cnt; i++)
+			FREE_NULL_BITMAP(node_data[i].empty_core_map);
+		xfree(node_data);
+	}
 	if (node_usage) {
 		for (i = 0; i < select_node_cnt; i++) {
 			FREE_NULL_LIST(node_usage[i].gres_list);
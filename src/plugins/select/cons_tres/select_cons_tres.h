@@ -80,6 +80,9 @@ struct node_res_record {
 					 * core count */
 	uint64_t real_memory;		/* MB of real memory configured */
 	uint64_t mem_spec_limit;	/* MB of specialized/system memory */
+	bitstr_t *empty_core_map;	/* tot_cores bits, all clear, used
+					 * when no partition job is on the
+					 * node. Never modified */
 };
 
 /* per-node resource usage record */
@@ -99,6 +99,7 @@ static int  _parse_switches(void **dest, slurm_parser_enum_t type,
 			    const char *line, char **leftover);
 extern int  _read_topo_file(slurm_conf_switches_t **ptr_array[]);
 static void _find_child_switches (int sw);
+static void _set_leaf_switches(bitstr_t *multi_homed_bitmap);
 static void _validate_switches(void);
 
 
@@ -242,6 +243,14 @@ static void _find_child_switches (int sw)
 		for (i=0; i<switch_record_cnt; i++) {
 			if (xstrcmp(swname, switch_record_table[i].name) == 0) {
 				switch_record_table[sw].switch_index[cldx] = i;
+				if ((switch_record_table[i].parent !=
+				     SWITCH_NO_PARENT) &&
+				    (switch_record_table[i].parent != sw)) {
+					error("Switch %s has multiple parents",
+					      swname);
+					switch_record_table[i].multi_parent =
+						true;
+				}
 				switch_record_table[i].parent = sw;
 				cldx++;
 				break;
@@ -253,6 +262,40 @@ static void _find_child_switches (int sw)
 	hostlist_destroy(swlist);
 }
 
+/*
+ * Record each node's leaf switch index so that per-switch node counts can be
+ * accumulated from the nodes of interest up through the parent links rather
+ * than by testing every switch's node_bitmap.
+ */
+static void _set_leaf_switches(bitstr_t *multi_homed_bitmap)
+{
+	struct node_record *node_ptr;
+	struct switch_record *switch_ptr;
+	int i, i_first, i_last, j;
+
+	for (i = 0, node_ptr = node_record_table_ptr; i < node_record_count;
+	     i++, node_ptr++)
+		node_ptr->leaf_switch = -1;
+
+	for (i = 0, switch_ptr = switch_record_table; i < switch_record_cnt;
+	     i++, switch_ptr++) {
+		if ((switch_ptr->level != 0) || !switch_ptr->node_bitmap)
+			continue;
+		i_first = bit_ffs(switch_ptr->node_bitmap);
+		if (i_first == -1)
+			continue;
+		i_last = bit_fls(switch_ptr->node_bitmap);
+		for (j = i_first; j <= i_last; j++) {
+			if (!bit_test(switch_ptr->node_bitmap, j))
+				continue;
+			if (bit_test(multi_homed_bitmap, j))
+				node_record_table_ptr[j].leaf_switch = -2;
+			else
+				node_record_table_ptr[j].leaf_switch = i;
+		}
+	}
+}
+
 static void _validate_switches(void)
 {
 	slurm_conf_switches_t *ptr, **ptr_array;
@@ -290,6 +333,7 @@ static void _validate_switches(void)
 			}
 		}
 		switch_ptr->link_speed = ptr->link_speed;
+		switch_ptr->parent = SWITCH_NO_PARENT;
 		if (ptr->nodes) {
 			switch_ptr->level = 0;	/* leaf switch */
 			switch_ptr->nodes = xstrdup(ptr->nodes);
@@ -409,6 +453,7 @@ static void _validate_switches(void)
 		      child);
 		xfree(child);
 	}
+	_set_leaf_switches(multi_homed_bitmap);
 	FREE_NULL_BITMAP(multi_homed_bitmap);
 
 	/* Create array of indexes of children of each switch,
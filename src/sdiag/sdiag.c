@@ -37,6 +37,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <slurm.h>
@@ -58,6 +59,9 @@ bool sort_by_time2 = false;
 
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
+/* RPC types and users in the order of the rpc_*_latency arrays */
+uint16_t *latency_type_id = NULL;
+uint32_t *latency_user_id = NULL;
 
 static int  _print_stats(void);
 static void _sort_rpc(void);
@@ -85,6 +89,14 @@ int main(int argc, char **argv)
 		rc = slurm_get_statistics(&buf,
 					  (stats_info_request_msg_t *)&req);
 		if (rc == SLURM_SUCCESS) {
+			latency_type_id = xcalloc(buf->rpc_type_size,
+						  sizeof(uint16_t));
+			memcpy(latency_type_id, buf->rpc_type_id,
+			       sizeof(uint16_t) * buf->rpc_type_size);
+			latency_user_id = xcalloc(buf->rpc_user_size,
+						  sizeof(uint32_t));
+			memcpy(latency_user_id, buf->rpc_user_id,
+			       sizeof(uint32_t) * buf->rpc_user_size);
 			_sort_rpc();
 			rc = _print_stats();
 #ifdef MEMORY_LEAK_DEBUG
@@ -92,6 +104,8 @@ int main(int argc, char **argv)
 			slurm_free_stats_response_msg(buf);
 			xfree(rpc_type_ave_time);
 			xfree(rpc_user_ave_time);
+			xfree(latency_type_id);
+			xfree(latency_user_id);
 #endif
 		} else
 			slurm_perror("slurm_get_statistics");
@@ -100,6 +114,133 @@ int main(int argc, char **argv)
 	exit(rc);
 }
 
+static uint64_t _ave(uint64_t total, uint64_t cnt)
+{
+	return cnt ? (total / cnt) : 0;
+}
+
+/* Print the queue, lock and processing latency of one RPC type or user */
+static void _print_latency(uint64_t *latency)
+{
+	static const char *part_name[] = { "queue", "lock", "proc" };
+	char str[100];
+	uint64_t *pcts;
+	int i;
+
+	for (i = 0; i < RPC_LATENCY_PARTS; i++) {
+		pcts = &latency[i * RPC_LATENCY_PCTS];
+		snprintf(str, sizeof(str),
+			 "%"PRIu64"/%"PRIu64"/%"PRIu64"/%"PRIu64,
+			 pcts[RPC_LATENCY_P50], pcts[RPC_LATENCY_P90],
+			 pcts[RPC_LATENCY_P99], pcts[RPC_LATENCY_MAX]);
+		if (i < (RPC_LATENCY_PARTS - 1))
+			printf(" %s:%-24s", part_name[i], str);
+		else
+			printf(" %s:%s\n", part_name[i], str);
+	}
+}
+
+static void _print_latency_stats(void)
+{
+	int i, j;
+
+	if (!buf->rpc_type_latency || !buf->rpc_user_latency)
+		return;
+
+	printf("\nRemote Procedure Call latency by message type "
+	       "(usec, p50/p90/p99/max)\n");
+	for (i = 0; i < buf->rpc_type_size; i++) {
+		for (j = 0; j < buf->rpc_type_size; j++) {
+			if (latency_type_id[j] == buf->rpc_type_id[i])
+				break;
+		}
+		if (j == buf->rpc_type_size)
+			continue;
+		printf("\t%-40s(%5u)", rpc_num2string(buf->rpc_type_id[i]),
+		       buf->rpc_type_id[i]);
+		_print_latency(&buf->rpc_type_latency[j * RPC_LATENCY_PARTS *
+						      RPC_LATENCY_PCTS]);
+	}
+
+	printf("\nRemote Procedure Call latency by user "
+	       "(usec, p50/p90/p99/max)\n");
+	for (i = 0; i < buf->rpc_user_size; i++) {
+		for (j = 0; j < buf->rpc_user_size; j++) {
+			if (latency_user_id[j] == buf->rpc_user_id[i])
+				break;
+		}
+		if (j == buf->rpc_user_size)
+			continue;
+		printf("\t%-16s(%8u)",
+		       uid_to_string_cached((uid_t)buf->rpc_user_id[i]),
+		       buf->rpc_user_id[i]);
+		_print_latency(&buf->rpc_user_latency[j * RPC_LATENCY_PARTS *
+						      RPC_LATENCY_PCTS]);
+	}
+}
+
+/* Lock levels of a caller, e.g. "RWWR-" for config, job, node, ... */
+static char *_lock_levels_str(uint16_t levels, char *str)
+{
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		switch ((levels >> (i * 2)) & 0x3) {
+		case 1:
+			str[i] = 'R';
+			break;
+		case 2:
+			str[i] = 'W';
+			break;
+		default:
+			str[i] = '-';
+		}
+	}
+	str[i] = '\0';
+	return str;
+}
+
+static void _print_lock_stats(void)
+{
+	char levels[6];
+	int i;
+
+	printf("\nController lock statistics (usec)\n");
+	if (!buf->lock_stats_enabled)
+		printf("\tNot gathered, set SlurmctldParameters=lock_stats\n");
+	for (i = 0; i < buf->lock_type_size; i++) {
+		if (!buf->lock_type_cnt[i])
+			continue;
+		printf("\t%-17s count:%-8"PRIu64" ave_wait:%-6"PRIu64" "
+		       "max_wait:%-8"PRIu64" ave_hold:%-6"PRIu64" "
+		       "max_hold:%"PRIu64"\n",
+		       buf->lock_type_name[i], buf->lock_type_cnt[i],
+		       _ave(buf->lock_type_wait[i], buf->lock_type_cnt[i]),
+		       buf->lock_type_wait_max[i],
+		       _ave(buf->lock_type_hold[i], buf->lock_type_cnt[i]),
+		       buf->lock_type_hold_max[i]);
+	}
+
+	if (!buf->lock_caller_size)
+		return;
+	printf("\nController lock statistics by caller (usec), "
+	       "locks: config job node partition federation\n");
+	for (i = 0; i < buf->lock_caller_size; i++) {
+		printf("\t%-40s locks:%s count:%-8"PRIu64" "
+		       "ave_wait:%-6"PRIu64" max_wait:%-8"PRIu64" "
+		       "ave_hold:%-6"PRIu64" max_hold:%-8"PRIu64" "
+		       "total_hold:%"PRIu64"\n",
+		       buf->lock_caller_name[i],
+		       _lock_levels_str(buf->lock_caller_levels[i], levels),
+		       buf->lock_caller_cnt[i],
+		       _ave(buf->lock_caller_wait[i], buf->lock_caller_cnt[i]),
+		       buf->lock_caller_wait_max[i],
+		       _ave(buf->lock_caller_hold[i], buf->lock_caller_cnt[i]),
+		       buf->lock_caller_hold_max[i],
+		       buf->lock_caller_hold[i]);
+	}
+}
+
 static int _print_stats(void)
 {
 	int i;
@@ -192,6 +333,27 @@ static int _print_stats(void)
 	printf("\nLatency for 1000 calls to gettimeofday(): %d microseconds\n",
 	       buf->gettimeofday_latency);
 
+	printf("\nRPC buffer pool stats\n");
+	printf("\tHits:    %"PRIu64"\n", buf->buf_pool_hits);
+	printf("\tMisses:  %"PRIu64"\n", buf->buf_pool_misses);
+	printf("\tReturns: %"PRIu64"\n", buf->buf_pool_returns);
+	printf("\tDrops:   %"PRIu64"\n", buf->buf_pool_drops);
+	printf("\tCached buffers: %u\n", buf->buf_pool_cached);
+	printf("\tMax cached buffers: %u\n", buf->buf_pool_cached_max);
+
+	printf("\nRPC compression stats\n");
+	printf("\tCompressed messages: %"PRIu64"\n", buf->rpc_compress_cnt);
+	printf("\tBytes before compression: %"PRIu64"\n",
+	       buf->rpc_compress_bytes_raw);
+	printf("\tBytes after compression:  %"PRIu64"\n",
+	       buf->rpc_compress_bytes_sent);
+
+	printf("\nslurmd connection cache stats\n");
+	printf("\tConnections opened: %"PRIu64"\n", buf->conn_cache_opened);
+	printf("\tConnections reused: %"PRIu64"\n", buf->conn_cache_reused);
+	printf("\tReconnects: %"PRIu64"\n", buf->conn_cache_reconnects);
+	printf("\tIdle connections: %u\n", buf->conn_cache_cached);
+
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
 		printf("\t%-40s(%5u) count:%-6u "
@@ -210,6 +372,8 @@ static int _print_stats(void)
 		       rpc_user_ave_time[i], buf->rpc_user_time[i]);
 	}
 
+	_print_latency_stats();
+
 	printf("\nPending RPC statistics\n");
 	if (buf->rpc_queue_type_count == 0)
 		printf("\tNo pending RPCs\n");
@@ -231,6 +395,8 @@ static int _print_stats(void)
 		       buf->rpc_dump_hostlist[i]);
 	}
 
+	_print_lock_stats();
+
 	return 0;
 }
 
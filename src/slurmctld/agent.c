@@ -55,6 +55,10 @@
  *  communicated with up to AGENT_THREAD_COUNT. A special watchdog thread
  *  sends SIGLARM to any threads that have been active (in DSH_ACTIVE state)
  *  for more than MessageTimeout seconds.
+ *  Messages that are sent directly to every node without reading a reply
+ *  (e.g. REQUEST_RECONFIGURE or SRUN_*) are instead all sent by the main
+ *  agent thread, which keeps up to AGENT_IO_ACTIVE connections in flight
+ *  (see agent_io.c) and then runs the watchdog logic itself.
  *  The agent responds to slurmctld via a function call or an RPC as required.
  *  For example, informing slurmctld that some node is not responding.
  *
@@ -87,15 +91,18 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/uid.h"
+#include "src/common/xhash.h"
 #include "src/common/xsignal.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/agent_io.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/ping_nodes.h"
+#include "src/slurmctld/script_launcher.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
 #include "src/slurmctld/srun_comm.h"
@@ -105,6 +112,7 @@
 #define RPC_PACK_MAX_AGE	30	/* Rebuild data over 30 seconds old */
 #define DUMP_RPC_COUNT 		25
 #define HOSTLIST_MAX_SIZE 	80
+#define AGENT_COMPOSITE_MAX	64	/* requests merged into one message */
 
 typedef enum {
 	DSH_NEW,        /* Request not yet started */
@@ -167,6 +175,8 @@ typedef struct queued_request {
 	time_t       first_attempt;	/* Time of first check for batch
 					 * launch RPC *only* */
 	time_t       last_attempt;	/* Time of last xmit attempt */
+	char        *key;		/* set while more requests may be
+					 * merged into this one */
 } queued_request_t;
 
 typedef struct mail_info {
@@ -175,22 +185,31 @@ typedef struct mail_info {
 } mail_info_t;
 
 static void _agent_defer(void);
+static void _agent_io_rpc(agent_info_t *agent_ptr);
 static void _agent_retry(int min_wait, bool wait_too);
 static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
+static bool _coalesce_request(queued_request_t *queued_req_ptr);
+static int  _composite_rc(ret_data_info_t *ret_data_info,
+			  composite_msg_t *req_msg);
 static void _reboot_from_ctld(agent_arg_t *agent_arg_ptr);
 static int  _signal_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
+static bool _direct_msg_type(slurm_msg_type_t msg_type);
 static void _list_delete_retry(void *retry_entry);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
 static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr);
 static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 		int no_resp_cnt, int retry_cnt);
+static void _ping_tree_did_resp(ping_tree_resp_msg_t *ping_tree);
+static void _ping_tree_load(ping_tree_resp_msg_t *ping_tree);
 static void _purge_agent_args(agent_arg_t *agent_arg_ptr);
 static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
+static void _requeue_add(queued_request_t *queued_req_ptr);
 static int  _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			   int *count, int *spot);
 static void _sig_handler(int dummy);
+static bool _srun_msg_type(slurm_msg_type_t msg_type);
 static void *_thread_per_group_rpc(void *args);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
 static void *_wdog(void *args);
@@ -207,7 +226,13 @@ static pthread_mutex_t retry_mutex = PTHREAD_MUTEX_INITIALIZER;
 static List defer_list = NULL;		/* agent_arg_t list for requests
 					 * requiring job write lock */
 static List mail_list = NULL;		/* pending e-mail requests */
-static List retry_list = NULL;		/* agent_arg_t list for retry */
+static List retry_list = NULL;		/* agent_arg_t list of requests not
+					 * yet tried, oldest first */
+static List requeue_list = NULL;	/* agent_arg_t list for retry,
+					 * ordered by last_attempt */
+static time_t requeue_last = 0;		/* last_attempt of requeue_list tail */
+static xhash_t *coalesce_hash = NULL;	/* retry_list records that more
+					 * requests may merge into, by key */
 
 
 static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -248,7 +273,7 @@ void *agent(void *args)
 	thd_t *thread_ptr;
 	task_info_t *task_specific_ptr;
 	time_t begin_time;
-	bool spawn_retry_agent = false;
+	bool spawn_retry_agent = false, direct;
 	int rpc_thread_cnt;
 	static time_t sched_update = 0;
 	static bool reboot_from_ctld = false;
@@ -281,7 +306,13 @@ void *agent(void *args)
 		sched_update = slurmctld_conf.last_update;
 	}
 
-	rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count, AGENT_THREAD_COUNT);
+	/* Messages sent directly to each node are all sent from this thread */
+	direct = _direct_msg_type(agent_arg_ptr->msg_type);
+	if (direct)
+		rpc_thread_cnt = 1;
+	else
+		rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count,
+					 AGENT_THREAD_COUNT);
 	while (1) {
 		if (slurmctld_config.shutdown_time ||
 		    ((agent_thread_cnt+rpc_thread_cnt) <= MAX_SERVER_THREADS)) {
@@ -311,6 +342,12 @@ void *agent(void *args)
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
 	thread_ptr = agent_info_ptr->thread_struct;
 
+	if (direct) {
+		_agent_io_rpc(agent_info_ptr);
+		(void) _wdog(agent_info_ptr);
+		goto done;
+	}
+
 	/* start the watchdog thread */
 	slurm_thread_create(&thread_wdog, _wdog, agent_info_ptr);
 
@@ -348,6 +385,7 @@ void *agent(void *args)
 
 	/* Wait for termination of remaining threads */
 	pthread_join(thread_wdog, NULL);
+done:
 	delay = (int) difftime(time(NULL), begin_time);
 	if (delay > (slurm_get_msg_timeout() * 2)) {
 		info("agent msg_type=%u ran for %d seconds",
@@ -446,18 +484,7 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	agent_info_ptr->msg_args_pptr  = &agent_arg_ptr->msg_args;
 	agent_info_ptr->protocol_version = agent_arg_ptr->protocol_version;
 
-	if ((agent_arg_ptr->msg_type != REQUEST_JOB_NOTIFY)	&&
-	    (agent_arg_ptr->msg_type != REQUEST_REBOOT_NODES)	&&
-	    (agent_arg_ptr->msg_type != REQUEST_RECONFIGURE)	&&
-	    (agent_arg_ptr->msg_type != REQUEST_SHUTDOWN)	&&
-	    (agent_arg_ptr->msg_type != SRUN_EXEC)		&&
-	    (agent_arg_ptr->msg_type != SRUN_TIMEOUT)		&&
-	    (agent_arg_ptr->msg_type != SRUN_NODE_FAIL)		&&
-	    (agent_arg_ptr->msg_type != SRUN_REQUEST_SUSPEND)	&&
-	    (agent_arg_ptr->msg_type != SRUN_USER_MSG)		&&
-	    (agent_arg_ptr->msg_type != SRUN_STEP_MISSING)	&&
-	    (agent_arg_ptr->msg_type != SRUN_STEP_SIGNAL)	&&
-	    (agent_arg_ptr->msg_type != SRUN_JOB_COMPLETE)) {
+	if (!_direct_msg_type(agent_arg_ptr->msg_type)) {
 #ifdef HAVE_FRONT_END
 		span = set_span(agent_arg_ptr->node_count,
 				agent_arg_ptr->node_count);
@@ -517,6 +544,31 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	return agent_info_ptr;
 }
 
+/*
+ * Return true if msg_type is sent directly to each node (no reply is read)
+ * rather than through the forwarding tree
+ */
+static bool _direct_msg_type(slurm_msg_type_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_JOB_NOTIFY:
+	case REQUEST_REBOOT_NODES:
+	case REQUEST_RECONFIGURE:
+	case REQUEST_SHUTDOWN:
+	case SRUN_EXEC:
+	case SRUN_TIMEOUT:
+	case SRUN_NODE_FAIL:
+	case SRUN_REQUEST_SUSPEND:
+	case SRUN_USER_MSG:
+	case SRUN_STEP_MISSING:
+	case SRUN_STEP_SIGNAL:
+	case SRUN_JOB_COMPLETE:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
 {
 	task_info_t *task_info_ptr;
@@ -709,6 +761,45 @@ static void _notify_slurmctld_jobs(agent_info_t *agent_ptr)
 	unlock_slurmctld(job_write_lock);
 }
 
+/*
+ * Record the CPU load and free memory of every node in a folded ping reply
+ * Node write lock must be held
+ */
+static void _ping_tree_load(ping_tree_resp_msg_t *ping_tree)
+{
+	hostlist_t hl = hostlist_create(ping_tree->node_list);
+	char *name;
+	int i = 0;
+
+	while ((i < ping_tree->node_cnt) && (name = hostlist_shift(hl))) {
+		reset_node_load(name, ping_tree->cpu_load[i]);
+		reset_node_free_mem(name, ping_tree->free_mem[i]);
+		free(name);
+		i++;
+	}
+	hostlist_destroy(hl);
+}
+
+/*
+ * Note that every node in a folded ping reply responded
+ * Config read and node write locks must be held
+ */
+static void _ping_tree_did_resp(ping_tree_resp_msg_t *ping_tree)
+{
+	hostlist_t hl = hostlist_create(ping_tree->node_list);
+	char *name;
+
+	if (slurmctld_conf.debug_flags & DEBUG_FLAG_AGENT) {
+		info("%s: ping reply for %u nodes %s", __func__,
+		     ping_tree->node_cnt, ping_tree->node_list);
+	}
+	while ((name = hostlist_shift(hl))) {
+		node_did_resp(name);
+		free(name);
+	}
+	hostlist_destroy(hl);
+}
+
 static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 				    int no_resp_cnt, int retry_cnt)
 {
@@ -799,7 +890,11 @@ static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 				      node_names, down_msg);
 				break;
 			case DSH_DONE:
-				node_did_resp(node_names);
+				if (resp_type == RESPONSE_PING_TREE)
+					_ping_tree_did_resp(
+						ret_data_info->data);
+				else
+					node_did_resp(node_names);
 				break;
 			default:
 				error("unknown state returned for %s",
@@ -860,6 +955,176 @@ static int _wif_status(void)
 	return rc;
 }
 
+/* Return true if msg_type goes to srun, whose failures are not the node's */
+static bool _srun_msg_type(slurm_msg_type_t msg_type)
+{
+	return ((msg_type == SRUN_PING)				||
+		(msg_type == SRUN_EXEC)				||
+		(msg_type == SRUN_JOB_COMPLETE)			||
+		(msg_type == SRUN_STEP_MISSING)			||
+		(msg_type == SRUN_STEP_SIGNAL)			||
+		(msg_type == SRUN_TIMEOUT)			||
+		(msg_type == SRUN_USER_MSG)			||
+		(msg_type == RESPONSE_RESOURCE_ALLOCATION)	||
+		(msg_type == SRUN_NODE_FAIL));
+}
+
+/*
+ * _agent_io_rpc - send a message directly to every node of the agent from
+ *	the calling thread, with agent_io_send() keeping many connections in
+ *	flight. Sets the state of each thd_t as _thread_per_group_rpc() would.
+ */
+static void _agent_io_rpc(agent_info_t *agent_ptr)
+{
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	agent_io_rpc_t *rpc;
+	int *thd_inx;
+	int i, cnt = 0;
+	slurm_msg_t msg;
+	Buf buffer;
+	bool srun_agent = _srun_msg_type(agent_ptr->msg_type);
+	/* SRUN_JOB_COMPLETE may race with srun exiting, see below */
+	bool maybe = (agent_ptr->msg_type == SRUN_JOB_COMPLETE);
+	time_t start_time = time(NULL);
+	/* Lock: Read node */
+	slurmctld_lock_t node_read_lock = {
+		NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+
+	slurm_msg_t_init(&msg);
+	if (agent_ptr->protocol_version)
+		msg.protocol_version = agent_ptr->protocol_version;
+	msg.msg_type = agent_ptr->msg_type;
+	msg.data     = *agent_ptr->msg_args_pptr;
+
+	if (slurmctld_conf.debug_flags & DEBUG_FLAG_AGENT) {
+		info("%s: sending %s to %u nodes", __func__,
+		     rpc_num2string(msg.msg_type), agent_ptr->thread_count);
+	}
+
+	rpc = xcalloc(agent_ptr->thread_count, sizeof(agent_io_rpc_t));
+	thd_inx = xcalloc(agent_ptr->thread_count, sizeof(int));
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		thread_ptr[i].start_time = start_time;
+		thread_ptr[i].state = DSH_NO_RESP;
+		if (thread_ptr[i].addr) {
+			rpc[cnt].addr = *thread_ptr[i].addr;
+		} else if (slurm_conf_get_addr(thread_ptr[i].nodelist,
+					       &rpc[cnt].addr) == SLURM_ERROR) {
+			error("%s: can't find address for host %s, check slurm.conf",
+			      __func__, thread_ptr[i].nodelist);
+			continue;
+		}
+		thd_inx[cnt++] = i;
+	}
+
+	/* The same credential and bytes go to every node */
+	if (cnt && !(buffer = slurm_pack_node_msg(&msg))) {
+		for (i = 0; i < cnt; i++)
+			rpc[i].rc = errno;
+	} else if (cnt) {
+		agent_io_send(rpc, cnt, buffer, message_timeout * 1000, maybe);
+		free_buf(buffer);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		thd_t *thd = &thread_ptr[thd_inx[i]];
+
+		/*
+		 * The srun may exit as soon as it has the last task exit
+		 * message, so failures to send SRUN_JOB_COMPLETE are ignored
+		 * (see _thread_per_group_rpc()).
+		 */
+		if ((rpc[i].rc == SLURM_SUCCESS) || maybe) {
+			thd->state = DSH_DONE;
+		} else if (!srun_agent) {
+			errno = rpc[i].rc;
+			lock_slurmctld(node_read_lock);
+			_comm_err(thd->nodelist, msg.msg_type);
+			unlock_slurmctld(node_read_lock);
+		}
+	}
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		thread_ptr[i].end_time = (time_t) difftime(time(NULL),
+							   start_time);
+	}
+
+	destroy_forward(&msg.forward);
+	xfree(thd_inx);
+	xfree(rpc);
+}
+
+static int _find_msg_index(void *x, void *key)
+{
+	slurm_msg_t *msg = x;
+
+	return (msg->msg_index == *(uint16_t *) key);
+}
+
+/*
+ * Return true if a reply code is handled as done by _thread_per_group_rpc(),
+ * i.e. it is not indicative of a real error
+ */
+static bool _benign_rc(int rc)
+{
+	return ((rc == SLURM_SUCCESS) || (rc == ESLURM_INVALID_JOB_ID) ||
+		(rc == ESLURMD_JOB_NOTRUNNING));
+}
+
+/*
+ * Handle the replies of one node to the parts of a REQUEST_AGENT_COMPOSITE
+ * as _thread_per_group_rpc() handles the reply to a single kill request.
+ * RET the first real error of a part, else SLURM_COMMUNICATIONS_RECEIVE_ERROR
+ *     if some part was not answered, else the first benign code of a part,
+ *     or SLURM_SUCCESS if all parts succeeded
+ */
+static int _composite_rc(ret_data_info_t *ret_data_info,
+			 composite_msg_t *req_msg)
+{
+	composite_msg_t *resp_msg = ret_data_info->data;
+	slurm_msg_t *resp_part, *req_part;
+	kill_job_msg_t *kill_job;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS, part_rc, resp_cnt = 0;
+	/* Locks: Write job, write node */
+	slurmctld_lock_t job_write_lock = {
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, READ_LOCK };
+
+	itr = list_iterator_create(resp_msg->msg_list);
+	while ((resp_part = list_next(itr))) {
+		part_rc = slurm_get_return_code(resp_part->msg_type,
+						resp_part->data);
+		req_part = list_find_first(req_msg->msg_list, _find_msg_index,
+					   &resp_part->msg_index);
+		if (!req_part)
+			continue;
+		resp_cnt++;
+
+		/* SPECIAL CASE: Mark node as IDLE if job already complete */
+		if (part_rc == ESLURMD_KILL_JOB_ALREADY_COMPLETE) {
+			kill_job = req_part->data;
+			part_rc = SLURM_SUCCESS;
+			lock_slurmctld(job_write_lock);
+			if (job_epilog_complete(kill_job->job_id,
+						ret_data_info->node_name,
+						part_rc))
+				run_scheduler = true;
+			unlock_slurmctld(job_write_lock);
+		}
+		/* A real failure must not be hidden by a benign code */
+		if (_benign_rc(rc) && !_benign_rc(part_rc))
+			rc = part_rc;
+		else if (rc == SLURM_SUCCESS)
+			rc = part_rc;
+	}
+	list_iterator_destroy(itr);
+
+	/* Some part was not answered in time, send them all again */
+	if (_benign_rc(rc) && (resp_cnt < list_count(req_msg->msg_list)))
+		rc = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
+
+	return rc;
+}
+
 /*
  * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
  *                         sending message out to one and forwarding it to
@@ -904,15 +1169,7 @@ static void *_thread_per_group_rpc(void *args)
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_KILL_PREEMPTED)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
-	srun_agent = (	(msg_type == SRUN_PING)			||
-			(msg_type == SRUN_EXEC)			||
-			(msg_type == SRUN_JOB_COMPLETE)		||
-			(msg_type == SRUN_STEP_MISSING)		||
-			(msg_type == SRUN_STEP_SIGNAL)		||
-			(msg_type == SRUN_TIMEOUT)		||
-			(msg_type == SRUN_USER_MSG)		||
-			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
-			(msg_type == SRUN_NODE_FAIL) );
+	srun_agent = _srun_msg_type(msg_type);
 
 	thread_ptr->start_time = time(NULL);
 
@@ -996,8 +1253,12 @@ static void *_thread_per_group_rpc(void *args)
 	//info("got %d messages back", list_count(ret_list));
 	itr = list_iterator_create(ret_list);
 	while ((ret_data_info = list_next(itr))) {
-		rc = slurm_get_return_code(ret_data_info->type,
-					   ret_data_info->data);
+		if (ret_data_info->type == RESPONSE_AGENT_COMPOSITE)
+			rc = _composite_rc(ret_data_info,
+					   task_ptr->msg_args_ptr);
+		else
+			rc = slurm_get_return_code(ret_data_info->type,
+						   ret_data_info->data);
 		/* SPECIAL CASE: Record node's CPU load */
 		if (ret_data_info->type == RESPONSE_PING_SLURMD) {
 			ping_slurmd_resp_msg_t *ping_resp;
@@ -1009,6 +1270,10 @@ static void *_thread_per_group_rpc(void *args)
 			reset_node_free_mem(ret_data_info->node_name,
 					    ping_resp->free_mem);
 			unlock_slurmctld(node_write_lock);
+		} else if (ret_data_info->type == RESPONSE_PING_TREE) {
+			lock_slurmctld(node_write_lock);
+			_ping_tree_load(ret_data_info->data);
+			unlock_slurmctld(node_write_lock);
 		}
 		/* SPECIAL CASE: Mark node as IDLE if job already complete */
 		if (is_kill_msg &&
@@ -1356,12 +1621,40 @@ static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count)
 	queued_req_ptr->agent_arg_ptr = agent_arg_ptr;
 	queued_req_ptr->last_attempt  = time(NULL);
 	slurm_mutex_lock(&retry_mutex);
-	if (retry_list == NULL)
-		retry_list = list_create(_list_delete_retry);
-	(void) list_append(retry_list, (void *) queued_req_ptr);
+	_requeue_add(queued_req_ptr);
 	slurm_mutex_unlock(&retry_mutex);
 }
 
+/*
+ * _requeue_add - add a request to requeue_list, which is kept in order of
+ *	last_attempt so that _agent_retry() only looks at its head.
+ *	Call with retry_mutex locked.
+ */
+static void _requeue_add(queued_request_t *queued_req_ptr)
+{
+	queued_request_t *next_ptr;
+	ListIterator iter;
+
+	if (requeue_list == NULL)
+		requeue_list = list_create(_list_delete_retry);
+
+	if (!list_count(requeue_list) ||
+	    (queued_req_ptr->last_attempt >= requeue_last)) {
+		list_append(requeue_list, queued_req_ptr);
+		requeue_last = queued_req_ptr->last_attempt;
+		return;
+	}
+
+	/* The clock went backwards, find the place of this record */
+	iter = list_iterator_create(requeue_list);
+	while ((next_ptr = list_next(iter))) {
+		if (next_ptr->last_attempt > queued_req_ptr->last_attempt)
+			break;
+	}
+	list_insert(iter, queued_req_ptr);
+	list_iterator_destroy(iter);
+}
+
 /*
  * _list_delete_retry - delete an entry from the retry list,
  *	see common/list.h for documentation
@@ -1375,6 +1668,7 @@ static void _list_delete_retry(void *retry_entry)
 
 	queued_req_ptr = (queued_request_t *) retry_entry;
 	_purge_agent_args(queued_req_ptr->agent_arg_ptr);
+	xfree(queued_req_ptr->key);
 	xfree(queued_req_ptr);
 }
 
@@ -1460,14 +1754,37 @@ extern void agent_trigger(int min_wait, bool mail_too)
 	slurm_mutex_unlock(&pending_mutex);
 }
 
+/* Find the type slot of a queued request or make a new one */
+static int _count_pending_rpc(void *x, void *arg)
+{
+	queued_request_t *queued_req_ptr = x;
+	agent_arg_t *agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
+	int i;
+
+	if (rpc_count < DUMP_RPC_COUNT) {
+		rpc_type_list[rpc_count] = agent_arg_ptr->msg_type;
+		hostlist_ranged_string(agent_arg_ptr->hostlist,
+				       HOSTLIST_MAX_SIZE,
+				       rpc_host_list[rpc_count]);
+		rpc_count++;
+	}
+	for (i = 0; i < MAX_RPC_PACK_CNT; i++) {
+		if (rpc_stat_types[i] == 0) {
+			rpc_stat_types[i] = agent_arg_ptr->msg_type;
+			stat_type_count++;
+		} else if (rpc_stat_types[i] != agent_arg_ptr->msg_type)
+			continue;
+		rpc_stat_counts[i]++;
+		break;
+	}
+	return 0;
+}
+
 /* agent_pack_pending_rpc_stats - pack counts of pending RPCs into a buffer */
 extern void agent_pack_pending_rpc_stats(Buf buffer)
 {
 	time_t now;
 	int i;
-	queued_request_t *queued_req_ptr = NULL;
-	agent_arg_t *agent_arg_ptr = NULL;
-	ListIterator list_iter;
 
 	now = time(NULL);
 	if (difftime(now, cache_build_time) <= RPC_PACK_MAX_AGE)
@@ -1495,33 +1812,10 @@ extern void agent_pack_pending_rpc_stats(Buf buffer)
 	}
 
 	slurm_mutex_lock(&retry_mutex);
-	if (retry_list) {
-		list_iter = list_iterator_create(retry_list);
-		/* iterate through list, find type slot or make a new one */
-		while ((queued_req_ptr = list_next(list_iter))) {
-			agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
-			if (rpc_count < DUMP_RPC_COUNT) {
-				rpc_type_list[rpc_count] =
-						agent_arg_ptr->msg_type;
-				hostlist_ranged_string(agent_arg_ptr->hostlist,
-						HOSTLIST_MAX_SIZE,
-						rpc_host_list[rpc_count]);
-				rpc_count++;
-			}
-			for (i = 0; i < MAX_RPC_PACK_CNT; i++) {
-				if (rpc_stat_types[i] == 0) {
-					rpc_stat_types[i] =
-						agent_arg_ptr->msg_type;
-					stat_type_count++;
-				} else if (rpc_stat_types[i] !=
-					   agent_arg_ptr->msg_type)
-					continue;
-				rpc_stat_counts[i]++;
-				break;
-			}
-		}
-		list_iterator_destroy(list_iter);
-	}
+	if (retry_list)
+		(void) list_for_each(retry_list, _count_pending_rpc, NULL);
+	if (requeue_list)
+		(void) list_for_each(requeue_list, _count_pending_rpc, NULL);
 	slurm_mutex_unlock(&retry_mutex);
 
 pack_it:
@@ -1600,23 +1894,30 @@ static void _agent_retry(int min_wait, bool mail_too)
 	mail_info_t *mi = NULL;
 
 	slurm_mutex_lock(&retry_mutex);
-	if (retry_list) {
+	if (retry_list || requeue_list) {
 		static time_t last_msg_time = (time_t) 0;
 		uint32_t msg_type[5] = {0, 0, 0, 0, 0};
-		int i = 0, list_size = list_count(retry_list);
+		int i = 0, list_size = retry_list_size();
 		if (((list_size > 100) &&
 		     (difftime(now, last_msg_time) > 300)) ||
 		    ((list_size > 0) &&
 		     (slurmctld_conf.debug_flags & DEBUG_FLAG_AGENT))) {
 			/* Note sizable backlog (retry_list_size()) of work */
-			retry_iter = list_iterator_create(retry_list);
-			while ((queued_req_ptr = list_next(retry_iter))) {
-				agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
-				msg_type[i++] = agent_arg_ptr->msg_type;
-				if (i == 5)
-					break;
+			List queues[2] = { retry_list, requeue_list };
+			int j;
+
+			for (j = 0; (j < 2) && (i < 5); j++) {
+				if (!queues[j])
+					continue;
+				retry_iter = list_iterator_create(queues[j]);
+				while ((i < 5) &&
+				       (queued_req_ptr = list_next(retry_iter))) {
+					agent_arg_ptr =
+						queued_req_ptr->agent_arg_ptr;
+					msg_type[i++] = agent_arg_ptr->msg_type;
+				}
+				list_iterator_destroy(retry_iter);
 			}
-			list_iterator_destroy(retry_iter);
 			info("   retry_list retry_list_size:%d msg_type=%s,%s,%s,%s,%s",
 			     list_size, rpc_num2string(msg_type[0]),
 			     rpc_num2string(msg_type[1]),
@@ -1636,33 +1937,25 @@ static void _agent_retry(int min_wait, bool mail_too)
 	}
 	slurm_mutex_unlock(&agent_cnt_mutex);
 
-	if (retry_list) {
-		/* first try to find a new (never tried) record */
-		retry_iter = list_iterator_create(retry_list);
-		while ((queued_req_ptr = list_next(retry_iter))) {
- 			if (queued_req_ptr->last_attempt == 0) {
-				list_remove(retry_iter);
-				break;		/* Process this request now */
-			}
-		}
-		list_iterator_destroy(retry_iter);
+	/* first try to find a new (never tried) record */
+	queued_req_ptr = NULL;
+	if (retry_list && (queued_req_ptr = list_dequeue(retry_list)) &&
+	    queued_req_ptr->key) {
+		/* no more requests may merge into it */
+		xhash_delete_str(coalesce_hash, queued_req_ptr->key);
+		xfree(queued_req_ptr->key);
 	}
 
-	if (retry_list && (queued_req_ptr == NULL)) {
-		/* now try to find a requeue request that is
-		 * relatively old */
-		double age = 0;
-
-		retry_iter = list_iterator_create(retry_list);
-		/* next try to find an older record to retry */
-		while ((queued_req_ptr = list_next(retry_iter))) {
-			age = difftime(now, queued_req_ptr->last_attempt);
-			if (age > min_wait) {
-				list_remove(retry_iter);
-				break;
-			}
-		}
-		list_iterator_destroy(retry_iter);
+	/*
+	 * now try the oldest requeued request, which is only retried once
+	 * it is relatively old
+	 */
+	if (!queued_req_ptr && requeue_list &&
+	    (queued_req_ptr = list_peek(requeue_list))) {
+		if (difftime(now, queued_req_ptr->last_attempt) > min_wait)
+			(void) list_dequeue(requeue_list);
+		else
+			queued_req_ptr = NULL;
 	}
 	slurm_mutex_unlock(&retry_mutex);
 
@@ -1693,6 +1986,92 @@ static void _agent_retry(int min_wait, bool mail_too)
 	return;
 }
 
+static void _queued_req_id(void *item, const char **key, uint32_t *key_len)
+{
+	queued_request_t *queued_req_ptr = item;
+
+	*key = queued_req_ptr->key;
+	*key_len = strlen(queued_req_ptr->key);
+}
+
+/* Add a request to a composite message as its next part */
+static void _composite_add(composite_msg_t *comp_msg,
+			   slurm_msg_type_t msg_type, void *msg_args)
+{
+	slurm_msg_t *part = xmalloc(sizeof(slurm_msg_t));
+
+	slurm_msg_t_init(part);
+	part->msg_type = msg_type;
+	part->data = msg_args;
+	part->msg_index = list_count(comp_msg->msg_list) + 1;
+	list_append(comp_msg->msg_list, part);
+}
+
+/*
+ * Kill requests queued for the very same nodes are sent to them together,
+ * as the parts of one REQUEST_AGENT_COMPOSITE, so that killing many jobs
+ * at once does not cost a message and a thread per job and node.
+ * If another request for those nodes is still waiting in retry_list,
+ * merge this one into it.
+ * Call with retry_mutex locked.
+ * RET true if the request was merged and queued_req_ptr freed
+ */
+static bool _coalesce_request(queued_request_t *queued_req_ptr)
+{
+	agent_arg_t *agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
+	queued_request_t *match_ptr;
+	agent_arg_t *match_arg_ptr;
+	composite_msg_t *comp_msg;
+	char *hosts;
+
+	if (agent_arg_ptr->addr ||
+	    ((agent_arg_ptr->msg_type != REQUEST_TERMINATE_JOB)  &&
+	     (agent_arg_ptr->msg_type != REQUEST_KILL_PREEMPTED) &&
+	     (agent_arg_ptr->msg_type != REQUEST_KILL_TIMELIMIT)))
+		return false;
+	/* slurmd of older versions do not know REQUEST_AGENT_COMPOSITE */
+	if (agent_arg_ptr->protocol_version &&
+	    (agent_arg_ptr->protocol_version < SLURM_20_02_PROTOCOL_VERSION))
+		return false;
+
+	hosts = hostlist_ranged_string_xmalloc(agent_arg_ptr->hostlist);
+	queued_req_ptr->key = xstrdup_printf("%u:%u:%s",
+					     agent_arg_ptr->protocol_version,
+					     agent_arg_ptr->retry, hosts);
+	xfree(hosts);
+
+	if (!coalesce_hash)
+		coalesce_hash = xhash_init(_queued_req_id, NULL);
+	if (!(match_ptr = xhash_get_str(coalesce_hash, queued_req_ptr->key))) {
+		xhash_add(coalesce_hash, queued_req_ptr);
+		return false;
+	}
+
+	match_arg_ptr = match_ptr->agent_arg_ptr;
+	if (match_arg_ptr->msg_type != REQUEST_AGENT_COMPOSITE) {
+		comp_msg = xmalloc(sizeof(composite_msg_t));
+		comp_msg->msg_list = list_create(slurm_free_comp_msg_list);
+		_composite_add(comp_msg, match_arg_ptr->msg_type,
+			       match_arg_ptr->msg_args);
+		match_arg_ptr->msg_type = REQUEST_AGENT_COMPOSITE;
+		match_arg_ptr->msg_args = comp_msg;
+	}
+	comp_msg = match_arg_ptr->msg_args;
+	_composite_add(comp_msg, agent_arg_ptr->msg_type,
+		       agent_arg_ptr->msg_args);
+	agent_arg_ptr->msg_args = NULL;
+	_list_delete_retry(queued_req_ptr);
+
+	if (list_count(comp_msg->msg_list) >= AGENT_COMPOSITE_MAX) {
+		xhash_delete_str(coalesce_hash, match_ptr->key);
+		xfree(match_ptr->key);
+	}
+	if (slurmctld_conf.debug_flags & DEBUG_FLAG_AGENT)
+		info("%s: %d requests queued for the same nodes",
+		     __func__, list_count(comp_msg->msg_list));
+	return true;
+}
+
 /*
  * agent_queue_request - put a new request on the queue for execution or
  * 	execute now if not too busy
@@ -1732,9 +2111,11 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 		slurm_mutex_unlock(&defer_mutex);
 	} else {
 		slurm_mutex_lock(&retry_mutex);
-		if (retry_list == NULL)
-			retry_list = list_create(_list_delete_retry);
-		list_append(retry_list, (void *)queued_req_ptr);
+		if (!_coalesce_request(queued_req_ptr)) {
+			if (retry_list == NULL)
+				retry_list = list_create(_list_delete_retry);
+			list_append(retry_list, (void *)queued_req_ptr);
+		}
 		slurm_mutex_unlock(&retry_mutex);
 	}
 	/* now process the request in a separate pthread
@@ -1747,9 +2128,11 @@ extern void agent_purge(void)
 {
 	int i;
 
-	if (retry_list) {
+	if (retry_list || requeue_list) {
 		slurm_mutex_lock(&retry_mutex);
+		xhash_free(coalesce_hash);
 		FREE_NULL_LIST(retry_list);
+		FREE_NULL_LIST(requeue_list);
 		slurm_mutex_unlock(&retry_mutex);
 	}
 	if (defer_list) {
@@ -1812,6 +2195,8 @@ static void _purge_agent_args(agent_arg_t *agent_arg_ptr)
 			 (agent_arg_ptr->msg_type == REQUEST_KILL_PREEMPTED) ||
 			 (agent_arg_ptr->msg_type == REQUEST_KILL_TIMELIMIT))
 			slurm_free_kill_job_msg(agent_arg_ptr->msg_args);
+		else if (agent_arg_ptr->msg_type == REQUEST_AGENT_COMPOSITE)
+			slurm_free_composite_msg(agent_arg_ptr->msg_args);
 		else if (agent_arg_ptr->msg_type == SRUN_USER_MSG)
 			slurm_free_srun_user_msg(agent_arg_ptr->msg_args);
 		else if (agent_arg_ptr->msg_type == SRUN_EXEC)
@@ -1870,32 +2255,32 @@ static char **_build_mail_env(void)
 static void *_mail_proc(void *arg)
 {
 	mail_info_t *mi = (mail_info_t *) arg;
+	script_launch_t launch;
+	char *argv[5], **my_env;
 	pid_t pid;
+	int i;
 
-	pid = fork();
-	if (pid < 0) {		/* error */
+	argv[0] = "mail";
+	argv[1] = "-s";
+	argv[2] = mi->message;
+	argv[3] = mi->user_name;
+	argv[4] = NULL;
+	my_env = _build_mail_env();
+
+	memset(&launch, 0, sizeof(launch));
+	launch.path = slurmctld_conf.mail_prog;
+	launch.argv = argv;
+	launch.env = my_env;
+	launch.flags = SCRIPT_LAUNCH_NULL_STDIO;
+	pid = script_launcher_start(&launch);
+	if (pid < 0)		/* error */
 		error("fork(): %m");
-	} else if (pid == 0) {	/* child */
-		int fd_0, fd_1, fd_2, i;
-		char **my_env = NULL;
-		my_env = _build_mail_env();
-		for (i = 0; i < 1024; i++)
-			(void) close(i);
-		if ((fd_0 = open("/dev/null", O_RDWR)) == -1)	// fd = 0
-			error("Couldn't open /dev/null: %m");
-		if ((fd_1 = dup(fd_0)) == -1)			// fd = 1
-			error("Couldn't do a dup on fd 1: %m");
-		if ((fd_2 = dup(fd_0)) == -1)			// fd = 2
-			error("Couldn't do a dup on fd 2 %m");
-		execle(slurmctld_conf.mail_prog, "mail",
-			"-s", mi->message, mi->user_name,
-			NULL, my_env);
-		error("Failed to exec %s: %m",
-			slurmctld_conf.mail_prog);
-		exit(1);
-	} else {		/* parent */
-		waitpid(pid, NULL, 0);
-	}
+	else
+		(void) script_launcher_waitpid(pid, NULL, 0);
+
+	for (i = 0; my_env[i]; i++)
+		xfree(my_env[i]);
+	xfree(my_env);
 	_mail_free(mi);
 	slurm_mutex_lock(&agent_cnt_mutex);
 	if (agent_thread_cnt)
@@ -2240,12 +2625,16 @@ static int _signal_defer(queued_request_t *queued_req_ptr)
 	return 1;
 }
 
-/* Return length of agent's retry_list */
+/* Return count of requests in agent's retry_list and requeue_list */
 extern int retry_list_size(void)
 {
-	if (retry_list == NULL)
-		return 0;
-	return list_count(retry_list);
+	int cnt = 0;
+
+	if (retry_list)
+		cnt += list_count(retry_list);
+	if (requeue_list)
+		cnt += list_count(requeue_list);
+	return cnt;
 }
 
 static void _reboot_from_ctld(agent_arg_t *agent_arg_ptr)
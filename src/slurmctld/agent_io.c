@@ -0,0 +1,336 @@
+/*****************************************************************************\
+ *  agent_io.c - send one message to many nodes from a single thread
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "slurm/slurm_errno.h"
+
+#include "src/common/fd.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xsignal.h"
+#include "src/slurmctld/agent_io.h"
+
+/*
+ * Each connection goes through these steps. The deadline of the first two
+ * is the caller's timeout, the peer gets DRAIN_TIMEOUT to close its end
+ * once the whole message is written, as in slurm_send_only_node_msg().
+ */
+enum {
+	IO_CONNECT,	/* non-blocking connect() in progress */
+	IO_SEND,	/* writing the message */
+	IO_DRAIN,	/* written and shut down, waiting for the peer */
+	IO_END		/* rc is final, fd closed */
+};
+
+#define DRAIN_TIMEOUT	1000	/* msec */
+
+/* Pending deadlines, a binary heap ordered by time */
+typedef struct {
+	int64_t deadline;
+	int inx;		/* into the rpc array */
+} io_timer_t;
+
+typedef struct {
+	io_timer_t *timers;
+	int cnt;
+} timer_heap_t;
+
+static int64_t _now_ms(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return ((int64_t) tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+}
+
+static void _timer_push(timer_heap_t *heap, int64_t deadline, int inx)
+{
+	int i = heap->cnt++;
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (heap->timers[parent].deadline <= deadline)
+			break;
+		heap->timers[i] = heap->timers[parent];
+		i = parent;
+	}
+	heap->timers[i].deadline = deadline;
+	heap->timers[i].inx = inx;
+}
+
+static void _timer_pop(timer_heap_t *heap)
+{
+	io_timer_t last = heap->timers[--heap->cnt];
+	int i = 0, child;
+
+	while ((child = (2 * i) + 1) < heap->cnt) {
+		if ((child + 1 < heap->cnt) &&
+		    (heap->timers[child + 1].deadline <
+		     heap->timers[child].deadline))
+			child++;
+		if (last.deadline <= heap->timers[child].deadline)
+			break;
+		heap->timers[i] = heap->timers[child];
+		i = child;
+	}
+	heap->timers[i] = last;
+}
+
+/*
+ * Drop timers of connections that have moved on to another step or ended,
+ * RET the earliest deadline still pending or -1 if none is
+ */
+static int64_t _timer_next(timer_heap_t *heap, agent_io_rpc_t *rpc)
+{
+	while (heap->cnt) {
+		io_timer_t *top = &heap->timers[0];
+
+		if ((rpc[top->inx].state != IO_END) &&
+		    (rpc[top->inx].deadline == top->deadline))
+			return top->deadline;
+		_timer_pop(heap);
+	}
+	return -1;
+}
+
+static void _set_deadline(timer_heap_t *heap, agent_io_rpc_t *rpc, int inx,
+			  int64_t deadline)
+{
+	rpc[inx].deadline = deadline;
+	_timer_push(heap, deadline, inx);
+}
+
+static void _end(agent_io_rpc_t *rpc, int rc)
+{
+	if (rpc->fd >= 0)
+		(void) close(rpc->fd);
+	rpc->fd = -1;
+	rpc->rc = rc;
+	rpc->state = IO_END;
+}
+
+static void _connect(agent_io_rpc_t *rpc)
+{
+	rpc->offset = 0;
+	if ((rpc->addr.sin_family == 0) || (rpc->addr.sin_port == 0)) {
+		error("Error connecting, bad data: family = %u, port = %u",
+		      rpc->addr.sin_family, rpc->addr.sin_port);
+		_end(rpc, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return;
+	}
+	if ((rpc->fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+		error("Error creating slurm stream socket: %m");
+		_end(rpc, errno);
+		return;
+	}
+	fd_set_close_on_exec(rpc->fd);
+	fd_set_nonblocking(rpc->fd);
+
+	if (connect(rpc->fd, (struct sockaddr *) &rpc->addr,
+		    sizeof(rpc->addr)) == 0)
+		rpc->state = IO_SEND;
+	else if (errno == EINPROGRESS)
+		rpc->state = IO_CONNECT;
+	else
+		_end(rpc, errno);
+}
+
+/* Write as much of the message as the socket takes */
+static void _send(agent_io_rpc_t *rpc, Buf buffer, bool maybe)
+{
+	uint32_t size = get_buf_offset(buffer);
+	ssize_t len;
+
+	while (rpc->offset < size) {
+		len = send(rpc->fd, get_buf_data(buffer) + rpc->offset,
+			   size - rpc->offset, 0);
+		if (len < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			if (errno == EINTR)
+				continue;
+			_end(rpc, errno);
+			return;
+		}
+		rpc->offset += len;
+	}
+
+	if (maybe) {
+		_end(rpc, SLURM_SUCCESS);
+		return;
+	}
+	if (shutdown(rpc->fd, SHUT_WR))
+		debug("%s: shutdown call failed: %m", __func__);
+	rpc->state = IO_DRAIN;
+}
+
+/* Handle poll() events on one connection */
+static void _handle(agent_io_rpc_t *rpc, short revents, Buf buffer,
+		    bool maybe)
+{
+	int err = 0;
+	socklen_t errlen = sizeof(err);
+
+	if (revents & POLLERR) {
+		if (getsockopt(rpc->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) ||
+		    !err)
+			err = SLURM_COMMUNICATIONS_SEND_ERROR;
+		_end(rpc, err);
+		return;
+	}
+
+	switch (rpc->state) {
+	case IO_CONNECT:
+		if (getsockopt(rpc->fd, SOL_SOCKET, SO_ERROR, &err, &errlen))
+			err = errno;
+		if (err) {
+			_end(rpc, err);
+			return;
+		}
+		rpc->state = IO_SEND;
+		/* fall through */
+	case IO_SEND:
+		_send(rpc, buffer, maybe);
+		break;
+	case IO_DRAIN:
+		/* Closed (or answered) by the peer once it read the message */
+		_end(rpc, SLURM_SUCCESS);
+		break;
+	}
+}
+
+extern void agent_io_send(agent_io_rpc_t *rpc, int cnt, Buf buffer,
+			  int timeout, bool maybe)
+{
+	struct pollfd *pfds;
+	int *active;		/* rpc index of each pfds entry */
+	int active_cnt = 0, next = 0, i, j, rc;
+	timer_heap_t heap;
+	int64_t now, deadline;
+	SigFunc *ohandler;
+
+	/* Let send() fail with EPIPE if a peer closes early */
+	ohandler = xsignal(SIGPIPE, SIG_IGN);
+
+	pfds = xcalloc(AGENT_IO_ACTIVE, sizeof(struct pollfd));
+	active = xcalloc(AGENT_IO_ACTIVE, sizeof(int));
+	/* each connection sets at most two deadlines */
+	heap.timers = xcalloc(2 * cnt, sizeof(io_timer_t));
+	heap.cnt = 0;
+
+	while ((next < cnt) || active_cnt) {
+		now = _now_ms();
+
+		/* Start new connections as others end */
+		while ((active_cnt < AGENT_IO_ACTIVE) && (next < cnt)) {
+			rpc[next].fd = -1;
+			rpc[next].rc = SLURM_SUCCESS;
+			_connect(&rpc[next]);
+			if (rpc[next].state == IO_SEND)
+				_send(&rpc[next], buffer, maybe);
+			if (rpc[next].state != IO_END) {
+				_set_deadline(&heap, rpc, next,
+					      now + timeout);
+				if (rpc[next].state == IO_DRAIN)
+					_set_deadline(&heap, rpc, next,
+						      now + DRAIN_TIMEOUT);
+				active[active_cnt++] = next;
+			}
+			next++;
+		}
+		if (!active_cnt)
+			break;
+
+		for (i = 0; i < active_cnt; i++) {
+			agent_io_rpc_t *r = &rpc[active[i]];
+
+			pfds[i].fd = r->fd;
+			pfds[i].events = (r->state == IO_DRAIN) ?
+					 POLLIN : POLLOUT;
+			pfds[i].revents = 0;
+		}
+
+		deadline = _timer_next(&heap, rpc);
+		rc = poll(pfds, active_cnt,
+			  (deadline < 0) ? -1 : MAX(deadline - now, 0));
+		if ((rc < 0) && (errno != EINTR)) {
+			error("%s: poll: %m", __func__);
+			for (i = 0; i < active_cnt; i++)
+				_end(&rpc[active[i]], errno);
+			active_cnt = 0;
+			continue;
+		}
+
+		now = _now_ms();
+		for (i = 0; (rc > 0) && (i < active_cnt); i++) {
+			int inx = active[i];
+			int state = rpc[inx].state;
+
+			if (!pfds[i].revents)
+				continue;
+			_handle(&rpc[inx], pfds[i].revents, buffer, maybe);
+			if ((state != IO_DRAIN) &&
+			    (rpc[inx].state == IO_DRAIN))
+				_set_deadline(&heap, rpc, inx,
+					      now + DRAIN_TIMEOUT);
+		}
+
+		/* Expire connections whose current step took too long */
+		while (((deadline = _timer_next(&heap, rpc)) >= 0) &&
+		       (deadline <= now)) {
+			_end(&rpc[heap.timers[0].inx], ETIMEDOUT);
+			_timer_pop(&heap);
+		}
+
+		for (i = 0, j = 0; i < active_cnt; i++) {
+			if (rpc[active[i]].state != IO_END)
+				active[j++] = active[i];
+		}
+		active_cnt = j;
+	}
+
+	xfree(heap.timers);
+	xfree(active);
+	xfree(pfds);
+	xsignal(SIGPIPE, ohandler);
+}
@@ -0,0 +1,73 @@
+/*****************************************************************************\
+ *  agent_io.h - send one message to many nodes from a single thread
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _AGENT_IO_H
+#define _AGENT_IO_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_defs.h"
+
+#define AGENT_IO_ACTIVE		256	/* maximum connections in flight */
+
+typedef struct agent_io_rpc {
+	slurm_addr_t addr;	/* IN - where to send the message */
+	int rc;			/* OUT - SLURM_SUCCESS or why the send failed */
+
+	/* used by agent_io_send() only */
+	int fd;
+	int state;
+	uint32_t offset;	/* bytes of the message already sent */
+	int64_t deadline;	/* msec, when the current step times out */
+} agent_io_rpc_t;
+
+/*
+ * Send a message packed by slurm_pack_node_msg() to every address in rpc,
+ * with up to AGENT_IO_ACTIVE connections in flight at once. Like
+ * slurm_send_only_node_msg(), a send only succeeds once the peer has
+ * closed its end after reading the message, unless maybe is set, in which
+ * case (like slurm_send_msg_maybe()) the connection is closed as soon as
+ * the message is written.
+ * IN/OUT rpc - cnt records, rc is set in each of them
+ * IN buffer - packed message
+ * IN timeout - msec allowed to connect and write the message to each node
+ * IN maybe - do not wait for the peer to read the message
+ */
+extern void agent_io_send(agent_io_rpc_t *rpc, int cnt, Buf buffer,
+			  int timeout, bool maybe);
+
+#endif
@@ -65,6 +65,7 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/state_stream.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 #define _DEBUG		0
@@ -395,6 +396,14 @@ static void *_background_rpc_mgr(void *no_data)
 		if (slurm_receive_msg(newsockfd, &msg, 0) != 0)
 			error("slurm_receive_msg: %m");
 
+		if (msg.msg_type == REQUEST_STATE_STREAM) {
+			/* The connection is kept for the files that follow */
+			if (!state_stream_accept(&msg))
+				close(newsockfd);
+			slurm_free_msg_members(&msg);
+			continue;
+		}
+
 		error_code = _background_process_msg(&msg);
 		if ((error_code == SLURM_SUCCESS)			&&
 		    (msg.msg_type == REQUEST_SHUTDOWN_IMMEDIATE)	&&
@@ -60,6 +60,7 @@
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/checkpoint.h"
+#include "src/common/conn_cache.h"
 #include "src/common/daemonize.h"
 #include "src/common/fd.h"
 #include "src/common/gres.h"
@@ -115,10 +116,12 @@
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/sched_plugin.h"
+#include "src/slurmctld/script_launcher.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
 #include "src/slurmctld/srun_comm.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 
@@ -251,6 +254,7 @@ static void *       _slurmctld_rpc_mgr(void *no_data);
 static void *       _slurmctld_signal_hand(void *no_data);
 static void         _test_thread_limit(void);
 static void         _update_assoc(slurmdb_assoc_rec_t *rec);
+static void         _update_conn_cache(void);
 inline static void  _update_cred_key(void);
 static void         _update_diag_job_state_counts(void);
 static void         _update_cluster_tres(void);
@@ -405,6 +409,10 @@ int main(int argc, char **argv)
 	test_core_limit();
 	_test_thread_limit();
 
+	/* Fork the script launcher while slurmctld is still small */
+	if (!test_config)
+		script_launcher_init();
+
 	/*
 	 * This must happen before we spawn any threads
 	 * which are not designed to handle them
@@ -664,6 +672,7 @@ int main(int argc, char **argv)
 				      slurmctld_conf.slurm_conf,
 				      slurm_strerror(error_code));
 			}
+			_update_conn_cache();
 			unlock_slurmctld(config_write_lock);
 			select_g_select_nodeinfo_set_all();
 
@@ -697,6 +706,7 @@ int main(int argc, char **argv)
 		_run_primary_prog(true);
 		control_time = time(NULL);
 		heartbeat_start();
+		state_stream_start();
 		if ((slurmctld_config.resume_backup == false) &&
 		    (slurmctld_primary == 1)) {
 			trigger_primary_ctld_res_op();
@@ -809,6 +819,7 @@ int main(int argc, char **argv)
 		slurmctld_config.thread_id_power = (pthread_t) 0;
 
 		/* stop the heartbeat last */
+		state_stream_stop();
 		heartbeat_stop();
 
 		/*
@@ -899,6 +910,7 @@ int main(int argc, char **argv)
 	route_fini();
 
 	/* purge remaining data structures */
+	conn_cache_fini();
 	group_cache_purge();
 	license_free();
 	slurm_cred_ctx_destroy(slurmctld_config.cred_ctx);
@@ -935,6 +947,7 @@ int main(int argc, char **argv)
 		info("Slurmctld shutdown completing with %d active agent thread",
 		     cnt);
 	}
+	script_launcher_fini();
 	log_fini();
 	sched_log_fini();
 
@@ -1012,6 +1025,7 @@ static void _reconfigure_slurm(void)
 		error("read_slurm_conf: %s", slurm_strerror(rc));
 	else {
 		_update_cred_key();
+		_update_conn_cache();
 		set_slurmctld_state_loc();
 	}
 
@@ -1211,6 +1225,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 		conn_arg = xmalloc(sizeof(connection_arg_t));
 		conn_arg->newsockfd = newsockfd;
 		memcpy(&conn_arg->cli_addr, &cli_addr, sizeof(slurm_addr_t));
+		gettimeofday(&conn_arg->accept_time, NULL);
 
 		if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
 			char inetbuf[64];
@@ -1956,6 +1971,7 @@ static void *_slurmctld_background(void *no_data)
 	(void) pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 	debug3("_slurmctld_background pid = %u", getpid());
+	(void) lock_stats_caller("background");
 
 	while (1) {
 		for (i = 0; ((i < 10) && (slurmctld_config.shutdown_time == 0));
@@ -2795,6 +2811,21 @@ static int _shutdown_backup_controller(void)
 	return bu_rc;
 }
 
+/*
+ * Keep connections to slurmd open between pings unless
+ * CommunicationParameters=NoConnCache is configured
+ */
+static void _update_conn_cache(void)
+{
+	xassert(verify_lock(CONF_LOCK, READ_LOCK));
+
+	if (xstrcasestr(slurmctld_conf.comm_params, "NoConnCache"))
+		conn_cache_fini();
+	else
+		conn_cache_init(slurmctld_conf.slurmd_timeout ?
+				slurmctld_conf.slurmd_timeout : 300);
+}
+
 /* Reset the job credential key based upon configuration parameters */
 static void _update_cred_key(void)
 {
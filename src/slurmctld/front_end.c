@@ -56,6 +56,7 @@
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
@@ -95,6 +96,9 @@ static Buf _open_front_end_state_file(char **state_file)
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/front_end_state");
 
+	if ((buf = state_stream_get(*state_file)))
+		return buf;
+
 	if (!(buf = create_mmap_buf(*state_file)))
 		error("Could not open front_end state file %s: %m",
 		      *state_file);
@@ -737,6 +741,7 @@ extern int dump_all_front_end_state(void)
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink (new_file);
+		state_stream_queue (reg_file, buffer);
 	}
 	xfree (old_file);
 	xfree (reg_file);
@@ -103,6 +103,7 @@
 #include "src/slurmctld/slurmctld_plugstack.h"
 #include "src/slurmctld/srun_comm.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 #define ARRAY_ID_BUF_SIZE 32
@@ -111,6 +112,7 @@
 #define SLURM_CREATE_JOB_FLAG_NO_ALLOCATE_0 0
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 #define PURGE_OLD_JOB_IN_SEC 2592000 /* 30 days in seconds */
+#define JOB_INFO_CHUNK_SIZE (64 * 1024 * 1024) /* see pack_all_jobs() */
 
 #define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
 #define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
@@ -135,6 +137,7 @@ typedef struct {
 
 typedef struct {
 	Buf       buffer;
+	List      chunks;
 	uint32_t  filter_uid;
 	uint32_t *jobs_packed;
 	uint16_t  protocol_version;
@@ -221,7 +224,7 @@ static void _pack_pending_job_details(struct job_details *detail_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
 static bool _parse_array_tok(char *tok, bitstr_t *array_bitmap, uint32_t max);
-static void _purge_missing_jobs(int node_inx, time_t now);
+static void _purge_missing_jobs(bitstr_t *node_bitmap, time_t now);
 static int  _read_data_array_from_file(int fd, char *file_name, char ***data,
 				       uint32_t * size,
 				       struct job_record *job_ptr);
@@ -922,6 +925,7 @@ int dump_all_job_state(void)
 			       new_file, reg_file);
 		(void) unlink(new_file);
 		last_file_write_time = now;
+		state_stream_queue(reg_file, buffer);
 	}
 	xfree(old_file);
 	xfree(reg_file);
@@ -957,6 +961,9 @@ static Buf _open_job_state_file(char **state_file)
 	*state_file = xstrdup_printf("%s/job_state",
 				     slurmctld_conf.state_save_location);
 
+	if ((buf = state_stream_get(*state_file)))
+		return buf;
+
 	if (!(buf = create_mmap_buf(*state_file)))
 		error("Could not open job state file %s: %m", *state_file);
 	else
@@ -6845,18 +6852,11 @@ static int _job_create(job_desc_msg_t *job_desc, int allocate, int will_run,
 			goto cleanup_fail;
 		}
 	}
-	if (exc_bitmap && req_bitmap) {
-		bitstr_t *tmp_bitmap = NULL;
-		bitoff_t first_set;
-		tmp_bitmap = bit_copy(exc_bitmap);
-		bit_and(tmp_bitmap, req_bitmap);
-		first_set = bit_ffs(tmp_bitmap);
-		FREE_NULL_BITMAP(tmp_bitmap);
-		if (first_set != -1) {
-			info("Job's required and excluded node lists overlap");
-			error_code = ESLURM_INVALID_NODE_NAME;
-			goto cleanup_fail;
-		}
+	if (exc_bitmap && req_bitmap &&
+	    bit_overlap_any(exc_bitmap, req_bitmap)) {
+		info("Job's required and excluded node lists overlap");
+		error_code = ESLURM_INVALID_NODE_NAME;
+		goto cleanup_fail;
 	}
 
 	if (job_desc->min_nodes == NO_VAL)
@@ -9329,6 +9329,27 @@ static bool _hide_job(struct job_record *job_ptr, uid_t uid,
 	return false;
 }
 
+/* Start a job info message body with a place holder record count */
+static Buf _init_job_info_buf(void)
+{
+	Buf buffer = init_buf(BUF_SIZE);
+
+	pack32(0, buffer);
+	pack_time(time(NULL), buffer);
+
+	return buffer;
+}
+
+/* Put the real record count in the message body header */
+static void _set_jobs_packed(Buf buffer, uint32_t jobs_packed)
+{
+	uint32_t tmp_offset = get_buf_offset(buffer);
+
+	set_buf_offset(buffer, 0);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+}
+
 static void _pack_job(struct job_record *job_ptr,
 		      _foreach_pack_job_info_t *pack_info)
 {
@@ -9350,6 +9371,14 @@ static void _pack_job(struct job_record *job_ptr,
 		 pack_info->protocol_version, pack_info->uid);
 
 	(*pack_info->jobs_packed)++;
+
+	if (pack_info->chunks &&
+	    (get_buf_offset(pack_info->buffer) >= JOB_INFO_CHUNK_SIZE)) {
+		_set_jobs_packed(pack_info->buffer, *pack_info->jobs_packed);
+		list_append(pack_info->chunks, pack_info->buffer);
+		pack_info->buffer = _init_job_info_buf();
+		*pack_info->jobs_packed = 0;
+	}
 }
 
 static int _foreach_pack_jobid(void *object, void *arg)
@@ -9371,6 +9400,10 @@ static int _foreach_pack_jobid(void *object, void *arg)
  *	machine independent form (for network transmission)
  * OUT buffer_ptr - the pointer is set to the allocated buffer.
  * OUT buffer_size - set to size of the buffer in bytes
+ * IN/OUT chunks - if not NULL, once the buffer reaches JOB_INFO_CHUNK_SIZE
+ *	bytes the remaining jobs are packed into further self-contained
+ *	buffers (Buf) appended to this list, to be sent with
+ *	slurm_send_node_msg_chunked()
  * IN show_flags - job filtering options
  * IN uid - uid of user making request (for partition filtering)
  * IN filter_uid - pack only jobs belonging to this user if not NO_VAL
@@ -9379,11 +9412,11 @@ static int _foreach_pack_jobid(void *object, void *arg)
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
  *	whenever the data format changes
  */
-extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
+extern void pack_all_jobs(char **buffer_ptr, int *buffer_size, List chunks,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version)
 {
-	uint32_t jobs_packed = 0, tmp_offset;
+	uint32_t jobs_packed = 0;
 	_foreach_pack_job_info_t pack_info = {0};
 	Buf buffer;
 	ListIterator itr;
@@ -9392,15 +9425,12 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
 
-	buffer = init_buf(BUF_SIZE);
-
 	/* write message body header : size and time */
-	/* put in a place holder job record count of 0 for now */
-	pack32(jobs_packed, buffer);
-	pack_time(time(NULL), buffer);
+	buffer = _init_job_info_buf();
 
 	/* write individual job records */
 	pack_info.buffer           = buffer;
+	pack_info.chunks           = chunks;
 	pack_info.filter_uid       = filter_uid;
 	pack_info.jobs_packed      = &jobs_packed;
 	pack_info.protocol_version = protocol_version;
@@ -9413,11 +9443,17 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	}
 	list_iterator_destroy(itr);
 
-	/* put the real record count in the message body header */
-	tmp_offset = get_buf_offset(buffer);
-	set_buf_offset(buffer, 0);
-	pack32(jobs_packed, buffer);
-	set_buf_offset(buffer, tmp_offset);
+	buffer = pack_info.buffer;
+	_set_jobs_packed(buffer, jobs_packed);
+
+	/* The first chunk is the message body, the rest follow it */
+	if (chunks && list_count(chunks)) {
+		if (jobs_packed)
+			list_append(chunks, buffer);
+		else
+			free_buf(buffer);
+		buffer = list_pop(chunks);
+	}
 
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
@@ -9441,7 +9477,7 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 			   uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			   uint16_t protocol_version)
 {
-	uint32_t jobs_packed = 0, tmp_offset;
+	uint32_t jobs_packed = 0;
 	_foreach_pack_job_info_t pack_info = {0};
 	Buf buffer;
 
@@ -9450,12 +9486,8 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
 
-	buffer = init_buf(BUF_SIZE);
-
 	/* write message body header : size and time */
-	/* put in a place holder job record count of 0 for now */
-	pack32(jobs_packed, buffer);
-	pack_time(time(NULL), buffer);
+	buffer = _init_job_info_buf();
 
 	/* write individual job records */
 	pack_info.buffer           = buffer;
@@ -9467,11 +9499,7 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 
 	list_for_each(job_ids, _foreach_pack_jobid, &pack_info);
 
-	/* put the real record count in the message body header */
-	tmp_offset = get_buf_offset(buffer);
-	set_buf_offset(buffer, 0);
-	pack32(jobs_packed, buffer);
-	set_buf_offset(buffer, tmp_offset);
+	_set_jobs_packed(buffer, jobs_packed);
 
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
@@ -13766,13 +13794,12 @@ static char *_build_step_id(char *buf, int buf_len, uint32_t step_id)
 }
 
 /*
- * validate_jobs_on_node - validate that any jobs that should be on the node
- *	are actually running, if not clean up the job records and/or node
- *	records.
- * IN reg_msg - node registration message
+ * Validate the jobs reported by one node. If purge_bitmap is set, the node
+ * is added to it if the jobs that are not reported must be looked for,
+ * else that is done here.
  */
-extern void
-validate_jobs_on_node(slurm_node_registration_status_msg_t *reg_msg)
+static void _validate_jobs_on_node(
+	slurm_node_registration_status_msg_t *reg_msg, bitstr_t *purge_bitmap)
 {
 	int i, node_inx, jobs_on_node;
 	struct node_record *node_ptr;
@@ -13913,8 +13940,15 @@ validate_jobs_on_node(slurm_node_registration_status_msg_t *reg_msg)
 	}
 
 	jobs_on_node = node_ptr->run_job_cnt + node_ptr->comp_job_cnt;
-	if (jobs_on_node)
-		_purge_missing_jobs(node_inx, now);
+	if (jobs_on_node && purge_bitmap) {
+		bit_set(purge_bitmap, node_inx);
+	} else if (jobs_on_node) {
+		bitstr_t *node_bitmap = bit_alloc(node_record_count);
+
+		bit_set(node_bitmap, node_inx);
+		_purge_missing_jobs(node_bitmap, now);
+		FREE_NULL_BITMAP(node_bitmap);
+	}
 
 	if (jobs_on_node != reg_msg->job_count) {
 		/* slurmd will not know of a job unless the job has
@@ -13929,65 +13963,128 @@ validate_jobs_on_node(slurm_node_registration_status_msg_t *reg_msg)
 	return;
 }
 
-/* Purge any batch job that should have its script running on node
- * node_inx, but is not. Allow BatchStartTimeout + ResumeTimeout seconds
+/*
+ * validate_jobs_on_node - validate that any jobs that should be on the node
+ *	are actually running, if not clean up the job records and/or node
+ *	records.
+ * IN reg_msg - node registration message
+ */
+extern void
+validate_jobs_on_node(slurm_node_registration_status_msg_t *reg_msg)
+{
+	_validate_jobs_on_node(reg_msg, NULL);
+}
+
+/*
+ * validate_jobs_on_nodes - validate_jobs_on_node() for several nodes at
+ *	once, walking the job list once for all of them
+ * IN reg_msgs - node registration messages
+ * IN reg_cnt - count of reg_msgs
+ */
+extern void
+validate_jobs_on_nodes(slurm_node_registration_status_msg_t **reg_msgs,
+		       int reg_cnt)
+{
+	bitstr_t *purge_bitmap = bit_alloc(node_record_count);
+	int i;
+
+	for (i = 0; i < reg_cnt; i++)
+		_validate_jobs_on_node(reg_msgs[i], purge_bitmap);
+	if (bit_ffs(purge_bitmap) != -1)
+		_purge_missing_jobs(purge_bitmap, time(NULL));
+	FREE_NULL_BITMAP(purge_bitmap);
+}
+
+/*
+ * Purge a running job found missing from node node_inx, see below.
+ * The timeouts are read once by the caller for all jobs and nodes.
+ */
+static void _purge_missing_job(struct job_record *job_ptr, int node_inx,
+			       time_t now, time_t batch_startup_time,
+			       uint16_t msg_timeout, uint16_t resume_timeout,
+			       uint32_t suspend_time)
+{
+	struct node_record *node_ptr = node_record_table_ptr + node_inx;
+	time_t node_boot_time = (time_t) 0, startup_time;
+
+	if (node_ptr->boot_time > (msg_timeout + 5)) {
+		/* allow for message timeout and other delays */
+		node_boot_time = node_ptr->boot_time - (msg_timeout + 5);
+	}
+
+	if ((job_ptr->batch_flag != 0)			&&
+	    (suspend_time != 0) /* power mgmt on */	&&
+	    (job_ptr->start_time < node_boot_time)) {
+		startup_time = batch_startup_time - resume_timeout;
+	} else
+		startup_time = batch_startup_time;
+
+	if ((job_ptr->batch_flag != 0)			&&
+	    (job_ptr->pack_job_offset == 0)		&&
+	    (job_ptr->time_last_active < startup_time)	&&
+	    (job_ptr->start_time       < startup_time)	&&
+	    (node_ptr == find_node_record(job_ptr->batch_host))) {
+		bool requeue = false;
+		char *requeue_msg = "";
+		if (job_ptr->details && job_ptr->details->requeue) {
+			requeue = true;
+			requeue_msg = ", Requeuing job";
+		}
+		info("Batch %pJ missing from batch node %s (not found BatchStartTime after startup)%s",
+		     job_ptr, job_ptr->batch_host, requeue_msg);
+		job_ptr->exit_code = 1;
+		job_complete(job_ptr->job_id,
+			     slurmctld_conf.slurm_user_id,
+			     requeue, true, NO_VAL);
+	} else {
+		_notify_srun_missing_step(job_ptr, node_inx,
+					  now, node_boot_time);
+	}
+}
+
+/* Purge any batch job that should have its script running on a node of
+ * node_bitmap, but is not. Allow BatchStartTimeout + ResumeTimeout seconds
  * for startup.
  *
  * Purge all job steps that were started before the node was last booted.
  *
- * Also notify srun if any job steps should be active on this node
+ * Also notify srun if any job steps should be active on these nodes
  * but are not found. */
-static void _purge_missing_jobs(int node_inx, time_t now)
+static void _purge_missing_jobs(bitstr_t *node_bitmap, time_t now)
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	struct node_record *node_ptr = node_record_table_ptr + node_inx;
 	uint16_t batch_start_timeout	= slurm_get_batch_start_timeout();
 	uint16_t msg_timeout		= slurm_get_msg_timeout();
 	uint16_t resume_timeout		= slurm_get_resume_timeout();
 	uint32_t suspend_time		= slurm_get_suspend_time();
-	time_t batch_startup_time, node_boot_time = (time_t) 0, startup_time;
+	time_t batch_startup_time;
+	int first_inx, last_inx, node_inx, i_first, i_last;
 
-	if (node_ptr->boot_time > (msg_timeout + 5)) {
-		/* allow for message timeout and other delays */
-		node_boot_time = node_ptr->boot_time - (msg_timeout + 5);
-	}
 	batch_startup_time  = now - batch_start_timeout;
 	batch_startup_time -= MIN(DEFAULT_MSG_TIMEOUT, msg_timeout);
+	first_inx = bit_ffs(node_bitmap);
+	last_inx = bit_fls(node_bitmap);
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if ((IS_JOB_CONFIGURING(job_ptr) ||
 		    (!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr))) ||
-		    (!bit_test(job_ptr->node_bitmap, node_inx)))
+		    !bit_overlap_any(job_ptr->node_bitmap, node_bitmap))
 			continue;
-		if ((job_ptr->batch_flag != 0)			&&
-		    (suspend_time != 0) /* power mgmt on */	&&
-		    (job_ptr->start_time < node_boot_time)) {
-			startup_time = batch_startup_time - resume_timeout;
-		} else
-			startup_time = batch_startup_time;
-
-		if ((job_ptr->batch_flag != 0)			&&
-		    (job_ptr->pack_job_offset == 0)		&&
-		    (job_ptr->time_last_active < startup_time)	&&
-		    (job_ptr->start_time       < startup_time)	&&
-		    (node_ptr == find_node_record(job_ptr->batch_host))) {
-			bool requeue = false;
-			char *requeue_msg = "";
-			if (job_ptr->details && job_ptr->details->requeue) {
-				requeue = true;
-				requeue_msg = ", Requeuing job";
-			}
-			info("Batch %pJ missing from batch node %s (not found BatchStartTime after startup)%s",
-			     job_ptr, job_ptr->batch_host, requeue_msg);
-			job_ptr->exit_code = 1;
-			job_complete(job_ptr->job_id,
-				     slurmctld_conf.slurm_user_id,
-				     requeue, true, NO_VAL);
-		} else {
-			_notify_srun_missing_step(job_ptr, node_inx,
-						  now, node_boot_time);
+		i_first = MAX(first_inx, bit_ffs(job_ptr->node_bitmap));
+		i_last = MIN(last_inx, bit_fls(job_ptr->node_bitmap));
+		for (node_inx = i_first; node_inx <= i_last; node_inx++) {
+			if (!bit_test(node_bitmap, node_inx) ||
+			    !bit_test(job_ptr->node_bitmap, node_inx))
+				continue;
+			/* Purged while checking an earlier node */
+			if (!IS_JOB_RUNNING(job_ptr) &&
+			    !IS_JOB_SUSPENDED(job_ptr))
+				break;
+			_purge_missing_job(job_ptr, node_inx, now,
+					   batch_startup_time, msg_timeout,
+					   resume_timeout, suspend_time);
 		}
 	}
 	list_iterator_destroy(job_iterator);
@@ -89,6 +89,7 @@
 #include "src/slurmctld/preempt.h"
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/script_launcher.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
 #include "src/slurmctld/state_save.h"
@@ -764,6 +765,7 @@ extern int schedule(uint32_t job_limit)
 	int job_count = 0;
 	struct timeval now;
 	long delta_t;
+	const char *caller;
 
 	if (slurmctld_config.scheduling_disabled)
 		return 0;
@@ -800,7 +802,9 @@ extern int schedule(uint32_t job_limit)
 		sched_job_limit = NO_VAL;
 		slurm_mutex_unlock(&sched_mutex);
 
+		caller = lock_stats_caller("schedule");
 		job_count = _schedule(job_limit);
+		(void) lock_stats_caller(caller);
 
 		slurm_mutex_lock(&sched_mutex);
 		gettimeofday(&now, NULL);
@@ -3825,21 +3829,19 @@ static void *_run_epilog(void *arg)
 	char *argv[2];
 	uint16_t tm;
 	track_script_rec_t *track_script_rec;
+	script_launch_t launch;
 
 	argv[0] = epilog_arg->epilog_slurmctld;
 	argv[1] = NULL;
 
-	if ((cpid = fork()) < 0) {
+	memset(&launch, 0, sizeof(launch));
+	launch.path = argv[0];
+	launch.argv = argv;
+	launch.env = epilog_arg->my_env;
+	if ((cpid = script_launcher_start(&launch)) < 0) {
 		error("epilog_slurmctld fork error: %m");
 		goto fini;
 	}
-	if (cpid == 0) {
-		for (i = 0; i < 1024; i++)
-			(void) close(i);
-		setpgid(0, 0);
-		execve(argv[0], argv, epilog_arg->my_env);
-		exit(127);
-	}
 
 	/* Start tracking this new process */
 	track_script_rec = track_script_rec_add(epilog_arg->job_id, cpid,
@@ -3962,7 +3964,7 @@ extern bitstr_t *node_features_reboot(struct job_record *job_ptr)
 extern bool node_features_reboot_test(struct job_record *job_ptr,
 				      bitstr_t *node_bitmap)
 {
-	bitstr_t *active_bitmap = NULL, *boot_node_bitmap = NULL;
+	bitstr_t *active_bitmap = NULL;
 	int node_cnt;
 
 	if (job_ptr->reboot)
@@ -3976,11 +3978,8 @@ extern bool node_features_reboot_test(struct job_record *job_ptr,
 	if (active_bitmap == NULL)	/* All have desired features */
 		return false;
 
-	boot_node_bitmap = bit_copy(node_bitmap);
-	bit_and_not(boot_node_bitmap, active_bitmap);
-	node_cnt = bit_set_count(boot_node_bitmap);
+	node_cnt = bit_and_not_count(node_bitmap, active_bitmap);
 	FREE_NULL_BITMAP(active_bitmap);
-	FREE_NULL_BITMAP(boot_node_bitmap);
 
 	if (node_cnt == 0)
 		return false;
@@ -4277,6 +4276,7 @@ static void *_run_prolog(void *arg)
 	uint16_t resume_timeout = slurm_get_resume_timeout();
 	uint16_t tm;
 	track_script_rec_t *track_script_rec;
+	script_launch_t launch;
 
 	lock_slurmctld(config_read_lock);
 	job_id = job_ptr->job_id;
@@ -4297,17 +4297,14 @@ static void *_run_prolog(void *arg)
 	}
 	unlock_slurmctld(config_read_lock);
 
-	if ((cpid = fork()) < 0) {
+	memset(&launch, 0, sizeof(launch));
+	launch.path = argv[0];
+	launch.argv = argv;
+	launch.env = my_env;
+	if ((cpid = script_launcher_start(&launch)) < 0) {
 		error("prolog_slurmctld fork error: %m");
 		goto fini;
 	}
-	if (cpid == 0) {
-		for (i = 0; i < 1024; i++)
-			(void) close(i);
-		setpgid(0, 0);
-		execve(argv[0], argv, my_env);
-		exit(127);
-	}
 
 	/* Start tracking this new process */
 	track_script_rec = track_script_rec_add(job_ptr->job_id,
@@ -4892,7 +4889,7 @@ waitpid_timeout(const char *name, pid_t pid, int *pstatus, int timeout)
 	if (timeout <= 0 || timeout == NO_VAL16)
 		options = 0;
 
-	while ((rc = waitpid (pid, pstatus, options)) <= 0) {
+	while ((rc = script_launcher_waitpid(pid, pstatus, options)) <= 0) {
 		if (rc < 0) {
 			if (errno == EINTR)
 				continue;
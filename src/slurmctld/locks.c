@@ -37,18 +37,72 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include "config.h"
+
 #include <errno.h>
 #include <pthread.h>
 #include <string.h>
 #include <sys/types.h>
+#include <time.h>
+
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
 
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
+#define LOCK_STATS_CALLERS	256	/* size of the caller hash table */
+
+typedef struct {
+	uint64_t cnt;		/* times acquired */
+	uint64_t wait;		/* usec spent waiting for the lock */
+	uint64_t wait_max;
+	uint64_t hold;		/* usec the lock was held */
+	uint64_t hold_max;
+} lock_stat_t;
+
+typedef struct {
+	char name[40];		/* RPC type or thread name, "" if unused */
+	uint16_t levels;	/* lock levels, LOCK_STATS_LEVEL_BITS each */
+	lock_stat_t stat;
+} lock_caller_t;
+
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_rwlock_t slurmctld_locks[ENTITY_COUNT];
 
+/*
+ * Lock statistics, only gathered with SlurmctldParameters=lock_stats.
+ * Every lock_slurmctld() call is counted under its caller, the name set
+ * with lock_stats_caller() or else the name of the thread.
+ */
+static bool lock_stats_enabled = false;
+static pthread_mutex_t lock_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lock_stat_t lock_stats[ENTITY_COUNT][2];	/* read, write */
+static lock_caller_t lock_callers[LOCK_STATS_CALLERS];
+static int lock_caller_cnt = 0;
+static uint32_t lock_stats_gen = 0;	/* bumped by lock_stats_reset() */
+
+/*
+ * Locks held by this thread and counted, most recent last. A thread may
+ * hold locks from overlapping lock_slurmctld() calls, unlock_slurmctld()
+ * matches the record by its levels.
+ */
+#define LOCK_STATS_HELD 4
+typedef struct {
+	uint64_t acquired;	/* usec */
+	int caller_inx;
+	uint32_t gen;		/* lock_stats_gen when acquired */
+	uint16_t levels;	/* _pack_levels() of the lock_slurmctld() call */
+} lock_held_t;
+
+static __thread const char *lock_caller = NULL;
+static __thread lock_held_t lock_held[LOCK_STATS_HELD];
+static __thread int lock_held_cnt = 0;
+static __thread bool lock_wait_timed = false;	/* see lock_stats_wait_start */
+static __thread uint64_t lock_wait_sum = 0;
+
 #ifndef NDEBUG
 /*
  * Used to protect against double-locking within a single thread. Calling
@@ -102,42 +156,187 @@ extern bool verify_lock(lock_datatype_t datatype, lock_level_t level)
 }
 #endif
 
+static uint64_t _now_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static void _add_stat(lock_stat_t *stat, uint64_t wait, uint64_t hold)
+{
+	if (wait != NO_VAL64) {
+		stat->cnt++;
+		stat->wait += wait;
+		stat->wait_max = MAX(stat->wait_max, wait);
+	}
+	if (hold != NO_VAL64) {
+		stat->hold += hold;
+		stat->hold_max = MAX(stat->hold_max, hold);
+	}
+}
+
+static uint16_t _pack_levels(lock_level_t *levels)
+{
+	uint16_t packed = 0;
+	int i;
+
+	for (i = 0; i < ENTITY_COUNT; i++)
+		packed |= levels[i] << (i * LOCK_STATS_LEVEL_BITS);
+	return packed;
+}
+
+/*
+ * Find or add the caller record of name and levels.
+ * Callers beyond three quarters of the table are counted as "other".
+ * Called with lock_stats_mutex held.
+ */
+static int _find_caller(const char *name, uint16_t levels)
+{
+	uint32_t hash = levels;
+	const char *p;
+	int inx;
+
+	if (lock_caller_cnt >= ((LOCK_STATS_CALLERS * 3) / 4)) {
+		name = "other";
+		levels = 0;
+		hash = 0;
+	}
+	for (p = name; *p; p++)
+		hash = (hash * 31) + (unsigned char) *p;
+
+	for (inx = hash % LOCK_STATS_CALLERS; ;
+	     inx = (inx + 1) % LOCK_STATS_CALLERS) {
+		lock_caller_t *caller = &lock_callers[inx];
+
+		if (!caller->name[0]) {
+			strlcpy(caller->name, name, sizeof(caller->name));
+			caller->levels = levels;
+			lock_caller_cnt++;
+			return inx;
+		}
+		if ((caller->levels == levels) &&
+		    !strncmp(caller->name, name, sizeof(caller->name) - 1))
+			return inx;
+	}
+}
+
+/* Count a lock_slurmctld() call, wait[] is the usec waited for each lock */
+static void _count_lock(lock_level_t *levels, uint64_t *wait)
+{
+	char thread_name[17] = "";
+	const char *name = lock_caller;
+	uint64_t wait_sum = 0;
+	uint16_t packed = _pack_levels(levels);
+	lock_held_t *held = NULL;
+	int i, caller_inx;
+
+	if (!name) {
+#if HAVE_SYS_PRCTL_H
+		if (prctl(PR_GET_NAME, thread_name, NULL, NULL, NULL) < 0)
+			thread_name[0] = '\0';
+#endif
+		name = thread_name[0] ? thread_name : "unknown";
+	}
+
+	slurm_mutex_lock(&lock_stats_mutex);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		if (!levels[i])
+			continue;
+		_add_stat(&lock_stats[i][levels[i] - 1], wait[i], NO_VAL64);
+		wait_sum += wait[i];
+	}
+	caller_inx = _find_caller(name, packed);
+	_add_stat(&lock_callers[caller_inx].stat, wait_sum, NO_VAL64);
+	if (lock_held_cnt < LOCK_STATS_HELD) {
+		/* Deeper nesting only has its wait counted */
+		held = &lock_held[lock_held_cnt++];
+		held->caller_inx = caller_inx;
+		held->gen = lock_stats_gen;
+		held->levels = packed;
+	}
+	slurm_mutex_unlock(&lock_stats_mutex);
+
+	if (held)
+		held->acquired = _now_usec();
+}
+
+/*
+ * Count how long the locks of the lock_slurmctld() call matching levels
+ * were held, if it was counted
+ */
+static void _count_unlock(lock_level_t *levels)
+{
+	uint16_t packed = _pack_levels(levels);
+	lock_held_t held;
+	uint64_t hold;
+	int i;
+
+	for (i = lock_held_cnt - 1; i >= 0; i--) {
+		if (lock_held[i].levels == packed)
+			break;
+	}
+	if (i < 0)
+		return;
+	held = lock_held[i];
+	hold = _now_usec() - held.acquired;
+	lock_held_cnt--;
+	memmove(&lock_held[i], &lock_held[i + 1],
+		sizeof(lock_held_t) * (lock_held_cnt - i));
+
+	slurm_mutex_lock(&lock_stats_mutex);
+	if (held.gen == lock_stats_gen) {
+		for (i = 0; i < ENTITY_COUNT; i++) {
+			if (!levels[i])
+				continue;
+			_add_stat(&lock_stats[i][levels[i] - 1], NO_VAL64,
+				  hold);
+		}
+		_add_stat(&lock_callers[held.caller_inx].stat, NO_VAL64, hold);
+	}
+	slurm_mutex_unlock(&lock_stats_mutex);
+}
+
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
 extern void lock_slurmctld(slurmctld_lock_t lock_levels)
 {
 	static bool init_run = false;
+	lock_level_t *levels = (lock_level_t *) &lock_levels;
+	uint64_t start = 0, wait[ENTITY_COUNT];
+	bool stats = lock_stats_enabled;
+	bool timed = stats || lock_wait_timed;
+	int i;
+
 	xassert(_store_locks(lock_levels));
 
 	if (!init_run) {
 		init_run = true;
-		for (int i = 0; i < ENTITY_COUNT; i++)
+		for (i = 0; i < ENTITY_COUNT; i++)
 			slurm_rwlock_init(&slurmctld_locks[i]);
 	}
 
-	if (lock_levels.conf == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[CONF_LOCK]);
-	else if (lock_levels.conf == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[CONF_LOCK]);
-
-	if (lock_levels.job == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[JOB_LOCK]);
-	else if (lock_levels.job == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[JOB_LOCK]);
-
-	if (lock_levels.node == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[NODE_LOCK]);
-	else if (lock_levels.node == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[NODE_LOCK]);
-
-	if (lock_levels.part == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[PART_LOCK]);
-	else if (lock_levels.part == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[PART_LOCK]);
+	/* Locks are acquired in the order of lock_datatype_t */
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		if (timed) {
+			wait[i] = 0;
+			if (levels[i])
+				start = _now_usec();
+		}
+		if (levels[i] == READ_LOCK)
+			slurm_rwlock_rdlock(&slurmctld_locks[i]);
+		else if (levels[i] == WRITE_LOCK)
+			slurm_rwlock_wrlock(&slurmctld_locks[i]);
+		else
+			continue;
+		if (timed) {
+			wait[i] = _now_usec() - start;
+			lock_wait_sum += wait[i];
+		}
+	}
 
-	if (lock_levels.fed == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[FED_LOCK]);
-	else if (lock_levels.fed == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[FED_LOCK]);
+	if (stats)
+		_count_lock(levels, wait);
 }
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
@@ -146,6 +345,9 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 {
 	xassert(_clear_locks(lock_levels));
 
+	if (lock_held_cnt)
+		_count_unlock((lock_level_t *) &lock_levels);
+
 	if (lock_levels.fed)
 		slurm_rwlock_unlock(&slurmctld_locks[FED_LOCK]);
 
@@ -206,6 +408,122 @@ int report_locks_set(void)
 }
 
 
+extern void lock_stats_enable(bool enable)
+{
+	if (enable != lock_stats_enabled)
+		info("%s lock statistics", enable ? "Enabling" : "Disabling");
+	lock_stats_enabled = enable;
+}
+
+extern const char *lock_stats_caller(const char *name)
+{
+	const char *old_name = lock_caller;
+
+	lock_caller = name;
+	return old_name;
+}
+
+extern void lock_stats_wait_start(void)
+{
+	lock_wait_timed = true;
+	lock_wait_sum = 0;
+}
+
+extern uint64_t lock_stats_wait_end(void)
+{
+	lock_wait_timed = false;
+	return lock_wait_sum;
+}
+
+extern void lock_stats_reset(void)
+{
+	slurm_mutex_lock(&lock_stats_mutex);
+	memset(lock_stats, 0, sizeof(lock_stats));
+	memset(lock_callers, 0, sizeof(lock_callers));
+	lock_caller_cnt = 0;
+	lock_stats_gen++;
+	slurm_mutex_unlock(&lock_stats_mutex);
+}
+
+static void _pack_stats(lock_stat_t **stats, uint32_t cnt, Buf buffer)
+{
+	uint64_t *val = xcalloc(cnt, sizeof(uint64_t));
+	int i;
+
+#define PACK_FIELD(field)				\
+	do {						\
+		for (i = 0; i < cnt; i++)		\
+			val[i] = stats[i]->field;	\
+		pack64_array(val, cnt, buffer);		\
+	} while (0)
+
+	PACK_FIELD(cnt);
+	PACK_FIELD(wait);
+	PACK_FIELD(wait_max);
+	PACK_FIELD(hold);
+	PACK_FIELD(hold_max);
+#undef PACK_FIELD
+
+	xfree(val);
+}
+
+static int _sort_callers_by_hold(const void *x, const void *y)
+{
+	const lock_caller_t *c1 = *(lock_caller_t **) x;
+	const lock_caller_t *c2 = *(lock_caller_t **) y;
+
+	if (c1->stat.hold > c2->stat.hold)
+		return -1;
+	if (c1->stat.hold < c2->stat.hold)
+		return 1;
+	return 0;
+}
+
+extern void lock_stats_pack(Buf buffer)
+{
+	static char *lock_names[ENTITY_COUNT][2] = {
+		{ "config read", "config write" },
+		{ "job read", "job write" },
+		{ "node read", "node write" },
+		{ "partition read", "partition write" },
+		{ "federation read", "federation write" },
+	};
+	lock_stat_t *stats[LOCK_STATS_CALLERS];
+	lock_caller_t *callers[LOCK_STATS_CALLERS];
+	char *names[LOCK_STATS_CALLERS];
+	uint16_t levels[LOCK_STATS_CALLERS];
+	uint32_t cnt = 0;
+	int i, j;
+
+	slurm_mutex_lock(&lock_stats_mutex);
+	pack16((uint16_t) lock_stats_enabled, buffer);
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		for (j = 0; j < 2; j++) {
+			names[cnt] = lock_names[i][j];
+			stats[cnt++] = &lock_stats[i][j];
+		}
+	}
+	packstr_array(names, cnt, buffer);
+	_pack_stats(stats, cnt, buffer);
+
+	cnt = 0;
+	for (i = 0; i < LOCK_STATS_CALLERS; i++) {
+		if (lock_callers[i].name[0])
+			callers[cnt++] = &lock_callers[i];
+	}
+	qsort(callers, cnt, sizeof(lock_caller_t *), _sort_callers_by_hold);
+	for (i = 0; i < cnt; i++) {
+		names[i] = callers[i]->name;
+		levels[i] = callers[i]->levels;
+		stats[i] = &callers[i]->stat;
+	}
+	packstr_array(names, cnt, buffer);
+	pack16_array(levels, cnt, buffer);
+	_pack_stats(stats, cnt, buffer);
+	slurm_mutex_unlock(&lock_stats_mutex);
+}
+
 /* un/lock semaphore used for saving state of slurmctld */
 extern void lock_state_files(void)
 {
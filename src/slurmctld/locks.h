@@ -93,6 +93,8 @@
 
 #include <stdbool.h>
 
+#include "src/common/pack.h"
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -135,6 +137,34 @@ extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
 extern int report_locks_set(void);
 
+/* Bits per lock level in the levels reported by lock_stats_pack() */
+#define LOCK_STATS_LEVEL_BITS	2
+
+/* Start or stop gathering lock statistics */
+extern void lock_stats_enable(bool enable);
+
+/*
+ * Count the locks taken by this thread under name, which must stay valid
+ * until it is replaced. NULL counts them under the name of the thread.
+ * RET the name it replaces, to restore once done
+ */
+extern const char *lock_stats_caller(const char *name);
+
+/*
+ * Add up the usec this thread waits for locks from now on, whether or not
+ * lock statistics are gathered, until lock_stats_wait_end() is called.
+ */
+extern void lock_stats_wait_start(void);
+
+/* RET the usec waited for locks since lock_stats_wait_start() */
+extern uint64_t lock_stats_wait_end(void);
+
+/* Pack the lock statistics for sdiag */
+extern void lock_stats_pack(Buf buffer);
+
+/* Clear the lock statistics */
+extern void lock_stats_reset(void);
+
 /* un/lock semaphore used for saving state of slurmctld */
 extern void lock_state_files ( void );
 extern void unlock_state_files ( void );
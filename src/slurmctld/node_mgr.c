@@ -81,6 +81,7 @@
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 #include "src/common/timers.h"
 #include "src/slurmctld/trigger_mgr.h"
 
@@ -202,6 +203,7 @@ int dump_all_node_state ( void )
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink (new_file);
+		state_stream_queue (reg_file, buffer);
 	}
 	xfree (old_file);
 	xfree (reg_file);
@@ -262,6 +264,9 @@ static Buf _open_node_state_file(char **state_file)
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/node_state");
 
+	if ((buf = state_stream_get(*state_file)))
+		return buf;
+
 	if (!(buf = create_mmap_buf(*state_file)))
 		error("Could not open node state file %s: %m", *state_file);
 	else
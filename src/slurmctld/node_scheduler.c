@@ -2154,25 +2154,32 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 				continue;
 			}
 
-			/* NOTE: select_g_job_test() is destructive of
-			 * avail_bitmap, so save a backup copy */
-			backup_bitmap = bit_copy(avail_bitmap);
+			/* Count usable nodes without modifying avail_bitmap
+			 * so we can keep accumulating without a copy */
 			FREE_NULL_LIST(*preemptee_job_list);
-			if (job_ptr->details->req_node_bitmap == NULL)
-				bit_and(avail_bitmap, avail_node_bitmap);
-
-			bit_and(avail_bitmap, share_node_bitmap);
-
-			avail_nodes = bit_set_count(avail_bitmap);
+			if (job_ptr->details->req_node_bitmap == NULL) {
+				avail_nodes = bit_and3_count(avail_bitmap,
+							     avail_node_bitmap,
+							     share_node_bitmap);
+			} else {
+				avail_nodes = bit_overlap(avail_bitmap,
+							  share_node_bitmap);
+			}
 			if (((avail_nodes  < min_nodes)	||
 			     ((avail_nodes >= min_nodes) &&
 			      (avail_nodes < req_nodes))) &&
 			    ((i+1) < node_set_size)) {
-				FREE_NULL_BITMAP(avail_bitmap);
-				avail_bitmap = backup_bitmap;
 				continue;	/* Keep accumulating nodes */
 			}
 
+			/* NOTE: select_g_job_test() is destructive of
+			 * avail_bitmap, so save a backup copy */
+			backup_bitmap = bit_copy(avail_bitmap);
+			if (job_ptr->details->req_node_bitmap == NULL)
+				bit_and(avail_bitmap, avail_node_bitmap);
+
+			bit_and(avail_bitmap, share_node_bitmap);
+
 			/* Only preempt jobs when all possible nodes are being
 			 * considered for use, otherwise we would preempt jobs
 			 * to use the lowest weight nodes. */
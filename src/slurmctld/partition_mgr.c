@@ -72,6 +72,7 @@
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define PART_STATE_VERSION        "PROTOCOL_VERSION"
@@ -493,6 +494,7 @@ int dump_all_part_state(void)
 			       new_file, reg_file);
 		}
 		(void) unlink(new_file);
+		state_stream_queue(reg_file, buffer);
 	}
 	xfree(old_file);
 	xfree(reg_file);
@@ -565,6 +567,8 @@ static Buf _open_part_state_file(char **state_file)
 
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/part_state");
+	if ((buf = state_stream_get(*state_file)))
+		return buf;
 	buf = create_mmap_buf(*state_file);
 	if (!buf) {
 		error("Could not open partition state file %s: %m",
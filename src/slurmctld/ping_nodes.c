@@ -43,9 +43,11 @@
 #include <string.h>
 #include <time.h>
 
+#include "src/common/conn_cache.h"
 #include "src/common/hostlist.h"
 #include "src/common/node_select.h"
 #include "src/common/read_config.h"
+#include "src/common/slurm_route.h"
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/ping_nodes.h"
@@ -164,6 +166,9 @@ void ping_nodes (void)
 	reg_agent_args->protocol_version = SLURM_PROTOCOL_VERSION;
 	reg_agent_args->hostlist = hostlist_create(NULL);
 
+	if (slurmctld_conf.debug_flags & DEBUG_FLAG_AGENT)
+		conn_cache_log_stats();
+
 	/*
 	 * If there are a large number of down nodes, the node ping
 	 * can take a long time to complete:
@@ -265,6 +270,11 @@ void ping_nodes (void)
 #else
 	for (i = 0, node_ptr = node_record_table_ptr;
 	     i < node_record_count; i++, node_ptr++) {
+		/* Keep nodes that can not answer out of forwarding trees */
+		route_set_node_avail(node_ptr->name,
+				     !(IS_NODE_DOWN(node_ptr) ||
+				       IS_NODE_NO_RESPOND(node_ptr) ||
+				       IS_NODE_POWER_SAVE(node_ptr)));
 		if (IS_NODE_FUTURE(node_ptr) ||
 		    IS_NODE_POWER_SAVE(node_ptr) ||
 		    IS_NODE_POWER_UP(node_ptr))
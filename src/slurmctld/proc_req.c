@@ -115,9 +115,36 @@ static uint32_t *rpc_user_id = NULL;
 static uint32_t *rpc_user_cnt = NULL;
 static uint64_t *rpc_user_time = NULL;
 
+/*
+ * Latency histograms, RPC_LATENCY_PARTS of them for each RPC type and user.
+ * Each power of two usec is split into four buckets, so the percentiles
+ * reported are within 25% of the actual latency.
+ */
+#define RPC_HIST_BUCKETS	124	/* up to 2^32 usec */
+typedef struct {
+	uint32_t bucket[RPC_HIST_BUCKETS];
+	uint64_t max;
+} rpc_hist_t;
+static rpc_hist_t *rpc_type_hist = NULL;
+static rpc_hist_t *rpc_user_hist = NULL;
+
 static pthread_mutex_t throttle_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t throttle_cond = PTHREAD_COND_INITIALIZER;
 
+/* Node registrations waiting to be validated, see _node_reg_batch() */
+#define NODE_REG_BATCH_MAX 128
+typedef struct {
+	slurm_msg_t *msg;
+	int error_code;
+	bool newly_up;
+	bool done;
+} node_reg_t;
+
+static pthread_mutex_t node_reg_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t node_reg_cond = PTHREAD_COND_INITIALIZER;
+static List node_reg_list = NULL;
+static bool node_reg_busy = false;
+
 static void         _create_pack_job_id_set(hostset_t jobid_hostset,
 					    uint32_t pack_job_offset,
 					    char **pack_job_id_set);
@@ -249,6 +276,74 @@ extern diag_stats_t slurmctld_diag_stats;
 static __thread bool drop_priv = false;
 #endif
 
+/* Histogram bucket of a latency in usec, see RPC_HIST_BUCKETS */
+static int _hist_bucket(uint64_t usec)
+{
+	int bits;
+
+	if (usec < 4)
+		return usec;
+	usec = MIN(usec, UINT32_MAX);
+	bits = 63 - __builtin_clzll(usec);
+	return ((bits - 1) << 2) + ((usec >> (bits - 2)) & 0x3);
+}
+
+/* Highest latency in usec counted in a histogram bucket */
+static uint64_t _hist_bucket_max(int bucket)
+{
+	int shift;
+
+	if (bucket < 4)
+		return bucket;
+	shift = (bucket >> 2) - 1;
+	return ((uint64_t) ((bucket & 0x3) + 5) << shift) - 1;
+}
+
+/* Add the latency of each part of an RPC to its histograms */
+static void _add_latency(rpc_hist_t *hist, uint64_t *latency)
+{
+	int i;
+
+	for (i = 0; i < RPC_LATENCY_PARTS; i++) {
+		hist[i].bucket[_hist_bucket(latency[i])]++;
+		hist[i].max = MAX(hist[i].max, latency[i]);
+	}
+}
+
+/* Fill in the RPC_LATENCY_PCTS percentiles of a histogram */
+static void _hist_percentiles(rpc_hist_t *hist, uint64_t *pcts)
+{
+	static const int pct[] = { 50, 90, 99 };
+	uint64_t cnt = 0, sum = 0, want;
+	int i, b = 0;
+
+	for (i = 0; i < RPC_HIST_BUCKETS; i++)
+		cnt += hist->bucket[i];
+
+	for (i = 0; i < (sizeof(pct) / sizeof(pct[0])); i++) {
+		want = ((cnt * pct[i]) + 99) / 100;
+		while ((b < RPC_HIST_BUCKETS) &&
+		       (!want || (sum + hist->bucket[b] < want)))
+			sum += hist->bucket[b++];
+		pcts[i] = (b < RPC_HIST_BUCKETS) ?
+			  MIN(_hist_bucket_max(b), hist->max) : hist->max;
+	}
+	pcts[RPC_LATENCY_MAX] = hist->max;
+}
+
+/* Pack the latency percentiles of cnt RPC types or users */
+static void _pack_latency(rpc_hist_t *hist, uint32_t cnt, Buf buffer)
+{
+	uint32_t vals = RPC_LATENCY_PARTS * RPC_LATENCY_PCTS;
+	uint64_t *pcts = xcalloc(cnt * vals, sizeof(uint64_t));
+	int i;
+
+	for (i = 0; i < cnt * RPC_LATENCY_PARTS; i++)
+		_hist_percentiles(&hist[i], &pcts[i * RPC_LATENCY_PCTS]);
+	pack64_array(pcts, cnt * vals, buffer);
+	xfree(pcts);
+}
+
 /*
  * slurmctld_req  - Process an individual RPC request
  * IN/OUT msg - the request message, data associated with the message is freed
@@ -258,6 +353,7 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	DEF_TIMERS;
 	int i, rpc_type_index = -1, rpc_user_index = -1;
 	uint32_t rpc_uid;
+	uint64_t latency[RPC_LATENCY_PARTS];
 
 	if (arg && (arg->newsockfd >= 0))
 		fd_set_nonblocking(arg->newsockfd);
@@ -280,6 +376,8 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 		rpc_type_id   = xmalloc(sizeof(uint16_t) * rpc_type_size);
 		rpc_type_cnt  = xmalloc(sizeof(uint32_t) * rpc_type_size);
 		rpc_type_time = xmalloc(sizeof(uint64_t) * rpc_type_size);
+		rpc_type_hist = xcalloc(rpc_type_size * RPC_LATENCY_PARTS,
+					sizeof(rpc_hist_t));
 	}
 	for (i = 0; i < rpc_type_size; i++) {
 		if (rpc_type_id[i] == 0)
@@ -294,6 +392,8 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 		rpc_user_id   = xmalloc(sizeof(uint32_t) * rpc_user_size);
 		rpc_user_cnt  = xmalloc(sizeof(uint32_t) * rpc_user_size);
 		rpc_user_time = xmalloc(sizeof(uint64_t) * rpc_user_size);
+		rpc_user_hist = xcalloc(rpc_user_size * RPC_LATENCY_PARTS,
+					sizeof(rpc_hist_t));
 	}
 	for (i = 0; i < rpc_user_size; i++) {
 		if ((rpc_user_id[i] == 0) && (i != 0))
@@ -305,9 +405,13 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	}
 	slurm_mutex_unlock(&rpc_mutex);
 
+	latency[RPC_LATENCY_QUEUE] = arg ? slurm_delta_tv(&arg->accept_time) : 0;
+
 	/* Debug the protocol layer.
 	 */
 	START_TIMER;
+	(void) lock_stats_caller(rpc_num2string(msg->msg_type));
+	lock_stats_wait_start();
 	if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
 		char *p = rpc_num2string(msg->msg_type);
 		if (msg->conn) {
@@ -603,14 +707,27 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	}
 
 	END_TIMER;
+	(void) lock_stats_caller(NULL);
+	latency[RPC_LATENCY_LOCK] = lock_stats_wait_end();
+	/* The lock wait is timed with another clock, it may be off a bit */
+	if (DELTA_TIMER > latency[RPC_LATENCY_LOCK])
+		latency[RPC_LATENCY_PROC] = DELTA_TIMER -
+					    latency[RPC_LATENCY_LOCK];
+	else
+		latency[RPC_LATENCY_PROC] = 0;
+
 	slurm_mutex_lock(&rpc_mutex);
 	if (rpc_type_index >= 0) {
 		rpc_type_cnt[rpc_type_index]++;
 		rpc_type_time[rpc_type_index] += DELTA_TIMER;
+		_add_latency(&rpc_type_hist[rpc_type_index *
+					    RPC_LATENCY_PARTS], latency);
 	}
 	if (rpc_user_index >= 0) {
 		rpc_user_cnt[rpc_user_index]++;
 		rpc_user_time[rpc_user_index] += DELTA_TIMER;
+		_add_latency(&rpc_user_hist[rpc_user_index *
+					    RPC_LATENCY_PARTS], latency);
 	}
 	slurm_mutex_unlock(&rpc_mutex);
 }
@@ -1835,12 +1952,18 @@ static void _slurm_rpc_dump_conf(slurm_msg_t * msg)
 	}
 }
 
+static void _del_buf(void *x)
+{
+	free_buf((Buf) x);
+}
+
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
 static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	List chunks = NULL;
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
@@ -1851,6 +1974,9 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
+	if (!msg->conn &&
+	    (msg->protocol_version >= SLURM_20_02_PROTOCOL_VERSION))
+		chunks = list_create(_del_buf);
 	lock_slurmctld(job_read_lock);
 
 	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
@@ -1864,7 +1990,7 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 				       job_info_request_msg->show_flags, uid,
 				       NO_VAL, msg->protocol_version);
 		} else {
-			pack_all_jobs(&dump, &dump_size,
+			pack_all_jobs(&dump, &dump_size, chunks,
 				      job_info_request_msg->show_flags, uid,
 				      NO_VAL, msg->protocol_version);
 		}
@@ -1880,9 +2006,11 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 		response_msg.data_size = dump_size;
 
 		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
+		slurm_send_node_msg_chunked(msg->conn_fd, &response_msg,
+					    chunks);
 		xfree(dump);
 	}
+	FREE_NULL_LIST(chunks);
 }
 
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
@@ -1891,6 +2019,7 @@ static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	List chunks = NULL;
 	slurm_msg_t response_msg;
 	job_user_id_msg_t *job_info_request_msg =
 		(job_user_id_msg_t *) msg->data;
@@ -1901,8 +2030,12 @@ static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_USER_INFO from uid=%d", uid);
+	if (!msg->conn &&
+	    (msg->protocol_version >= SLURM_20_02_PROTOCOL_VERSION))
+		chunks = list_create(_del_buf);
 	lock_slurmctld(job_read_lock);
-	pack_all_jobs(&dump, &dump_size, job_info_request_msg->show_flags, uid,
+	pack_all_jobs(&dump, &dump_size, chunks,
+		      job_info_request_msg->show_flags, uid,
 		      job_info_request_msg->user_id, msg->protocol_version);
 	unlock_slurmctld(job_read_lock);
 	END_TIMER2("_slurm_rpc_dump_job_user");
@@ -1916,8 +2049,9 @@ static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 	response_msg.data_size = dump_size;
 
 	/* send message */
-	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	slurm_send_node_msg_chunked(msg->conn_fd, &response_msg, chunks);
 	xfree(dump);
+	FREE_NULL_LIST(chunks);
 }
 
 /* _slurm_rpc_dump_job_single - process RPC for one job's state information */
@@ -3058,6 +3192,86 @@ static void _slurm_rpc_event_log(slurm_msg_t * msg)
 	slurm_send_rc_msg(msg, error_code);
 }
 
+/* Validate node registrations, call with job and node write locks held */
+static void _validate_node_regs(node_reg_t **regs, int reg_cnt)
+{
+	slurm_node_registration_status_msg_t *reg_msg;
+	int i;
+#ifdef HAVE_FRONT_END		/* Operates only on front-end */
+	for (i = 0; i < reg_cnt; i++) {
+		reg_msg = regs[i]->msg->data;
+		regs[i]->error_code = validate_nodes_via_front_end(
+			reg_msg, regs[i]->msg->protocol_version,
+			&regs[i]->newly_up);
+	}
+#else
+	slurm_node_registration_status_msg_t **reg_msgs;
+
+	reg_msgs = xcalloc(reg_cnt, sizeof(*reg_msgs));
+	for (i = 0; i < reg_cnt; i++)
+		reg_msgs[i] = regs[i]->msg->data;
+	validate_jobs_on_nodes(reg_msgs, reg_cnt);
+	for (i = 0; i < reg_cnt; i++) {
+		reg_msg = reg_msgs[i];
+		regs[i]->error_code = validate_node_specs(
+			reg_msg, regs[i]->msg->protocol_version,
+			&regs[i]->newly_up);
+	}
+	xfree(reg_msgs);
+#endif
+}
+
+/*
+ * Validate a node registration together with those that arrive meanwhile.
+ * When many nodes register at once (slurmctld restart, rack power up),
+ * the RPC threads would otherwise each take the job and node write locks
+ * in turn. Here the first thread to find no batch in progress validates
+ * every registration queued so far under one lock, and the threads whose
+ * registration it took wait for it rather than for the locks.
+ */
+static int _node_reg_batch(slurm_msg_t *msg, bool *newly_up)
+{
+	/* Locks: Read config, write job, write node */
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, READ_LOCK };
+	node_reg_t reg = { .msg = msg }, *regs[NODE_REG_BATCH_MAX];
+	int i, reg_cnt;
+
+	slurm_mutex_lock(&node_reg_mutex);
+	if (!node_reg_list)
+		node_reg_list = list_create(NULL);
+	list_append(node_reg_list, &reg);
+	while (!reg.done) {
+		if (node_reg_busy) {
+			slurm_cond_wait(&node_reg_cond, &node_reg_mutex);
+			continue;
+		}
+		node_reg_busy = true;
+		for (reg_cnt = 0; reg_cnt < NODE_REG_BATCH_MAX; reg_cnt++) {
+			if (!(regs[reg_cnt] = list_pop(node_reg_list)))
+				break;
+		}
+		slurm_mutex_unlock(&node_reg_mutex);
+
+		lock_slurmctld(job_write_lock);
+		_validate_node_regs(regs, reg_cnt);
+		unlock_slurmctld(job_write_lock);
+		if (reg_cnt > 1)
+			debug2("%s: validated %d node registrations at once",
+			       __func__, reg_cnt);
+
+		slurm_mutex_lock(&node_reg_mutex);
+		for (i = 0; i < reg_cnt; i++)
+			regs[i]->done = true;
+		node_reg_busy = false;
+		slurm_cond_broadcast(&node_reg_cond);
+	}
+	slurm_mutex_unlock(&node_reg_mutex);
+
+	*newly_up = reg.newly_up;
+	return reg.error_code;
+}
+
 /* _slurm_rpc_node_registration - process RPC to determine if a node's
  *	actual configuration satisfies the configured specification */
 static void _slurm_rpc_node_registration(slurm_msg_t * msg,
@@ -3069,9 +3283,6 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg,
 	bool newly_up = false;
 	slurm_node_registration_status_msg_t *node_reg_stat_msg =
 		(slurm_node_registration_status_msg_t *) msg->data;
-	/* Locks: Read config, write job, write node */
-	slurmctld_lock_t job_write_lock = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
 
 	START_TIMER;
@@ -3100,20 +3311,15 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg,
 			      "set DebugFlags=NO_CONF_HASH in your slurm.conf.",
 			      node_reg_stat_msg->node_name);
 		}
-		if (!running_composite)
-			lock_slurmctld(job_write_lock);
-#ifdef HAVE_FRONT_END		/* Operates only on front-end */
-		error_code = validate_nodes_via_front_end(node_reg_stat_msg,
-							  msg->protocol_version,
-							  &newly_up);
-#else
-		validate_jobs_on_node(node_reg_stat_msg);
-		error_code = validate_node_specs(node_reg_stat_msg,
-						 msg->protocol_version,
-						 &newly_up);
-#endif
-		if (!running_composite)
-			unlock_slurmctld(job_write_lock);
+		if (running_composite) {
+			/* the caller holds the locks */
+			node_reg_t reg = { .msg = msg }, *regs = &reg;
+
+			_validate_node_regs(&regs, 1);
+			error_code = reg.error_code;
+			newly_up = reg.newly_up;
+		} else
+			error_code = _node_reg_batch(msg, &newly_up);
 		END_TIMER2("_slurm_rpc_node_registration");
 		if (newly_up) {
 			queue_job_scheduler();
@@ -6116,13 +6322,19 @@ static void _clear_rpc_stats(void)
 		rpc_user_id[i] = 0;
 		rpc_user_time[i] = 0;
 	}
+	if (rpc_type_hist)
+		memset(rpc_type_hist, 0, sizeof(rpc_hist_t) * rpc_type_size *
+					 RPC_LATENCY_PARTS);
+	if (rpc_user_hist)
+		memset(rpc_user_hist, 0, sizeof(rpc_hist_t) * rpc_user_size *
+					 RPC_LATENCY_PARTS);
 	slurm_mutex_unlock(&rpc_mutex);
 }
 
 static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 			    uint16_t protocol_version)
 {
-	uint32_t i;
+	uint32_t i, type_cnt;
 	Buf buffer;
 
 	slurm_mutex_lock(&rpc_mutex);
@@ -6134,6 +6346,7 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 			if (rpc_type_id[i] == 0)
 				break;
 		}
+		type_cnt = i;
 		pack32(i, buffer);
 		pack16_array(rpc_type_id,   i, buffer);
 		pack32_array(rpc_type_cnt,  i, buffer);
@@ -6149,7 +6362,10 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 		pack64_array(rpc_user_time, i, buffer);
 
 		agent_pack_pending_rpc_stats(buffer);
+		lock_stats_pack(buffer);
 
+		_pack_latency(rpc_type_hist, type_cnt, buffer);
+		_pack_latency(rpc_user_hist, i, buffer);
 	}
 
 	slurm_mutex_unlock(&rpc_mutex);
@@ -6284,11 +6500,13 @@ extern void free_rpc_stats(void)
 	xfree(rpc_type_cnt);
 	xfree(rpc_type_id);
 	xfree(rpc_type_time);
+	xfree(rpc_type_hist);
 	rpc_type_size = 0;
 
 	xfree(rpc_user_cnt);
 	xfree(rpc_user_id);
 	xfree(rpc_user_time);
+	xfree(rpc_user_hist);
 	rpc_user_size = 0;
 	slurm_mutex_unlock(&rpc_mutex);
 }
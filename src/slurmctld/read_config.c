@@ -42,6 +42,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -93,6 +94,7 @@
 #include "src/slurmctld/trigger_mgr.h"
 
 #define FEATURE_MAGIC	0x34dfd8b5
+#define PREFETCH_CHUNK	(1024 * 1024)
 
 /* Global variables */
 List active_feature_list;	/* list of currently active features_records */
@@ -100,6 +102,9 @@ List avail_feature_list;	/* list of available features_records */
 bool node_features_updated = false;
 bool slurmctld_init_db = true;
 
+/* slurm.conf values the node and partition records were built from */
+static Buf conf_records = NULL;
+
 static void _acct_restore_active_jobs(void);
 static void _add_config_feature(List feature_list, char *feature,
 				bitstr_t *node_bitmap);
@@ -111,7 +116,8 @@ static int  _compare_hostnames(struct node_record *old_node_table,
 			       int old_node_count,
 			       struct node_record *node_table, int node_count);
 static void _gres_reconfig(bool reconfig);
-static int  _init_all_slurm_conf(void);
+static int  _init_all_slurm_conf(bool reread);
+static void _log_recover_time(const char *state, struct timeval *tv);
 static void _list_delete_feature(void *feature_entry);
 static int  _preserve_select_type_param(slurm_ctl_conf_t * ctl_conf_ptr,
 					uint16_t old_select_type_p);
@@ -122,6 +128,7 @@ static int  _preserve_plugins(slurm_ctl_conf_t * ctl_conf_ptr,
 			      char *old_bb_type);
 static void _purge_old_node_state(struct node_record *old_node_table_ptr,
 				int old_node_record_count);
+static void _prefetch_state_files(char *state_save_dir, int recover);
 static void _purge_old_part_state(List old_part_list, char *old_def_part_name);
 static int  _reset_node_bitmaps(void *x, void *arg);
 static int  _restore_job_dependencies(void);
@@ -493,17 +500,21 @@ static int _build_bitmaps(void)
 /*
  * _init_all_slurm_conf - initialize or re-initialize the slurm
  *	configuration values.
+ * IN reread - read slurm.conf again, false if it was just read
  * RET 0 if no error, otherwise an error code.
  * NOTE: We leave the job table intact
- * NOTE: Operates on common variables, no arguments
+ * NOTE: Operates on common variables
  */
-static int _init_all_slurm_conf(void)
+static int _init_all_slurm_conf(bool reread)
 {
 	int error_code;
-	char *conf_name = xstrdup(slurmctld_conf.slurm_conf);
+	char *conf_name;
 
-	slurm_conf_reinit(conf_name);
-	xfree(conf_name);
+	if (reread) {
+		conf_name = xstrdup(slurmctld_conf.slurm_conf);
+		slurm_conf_reinit(conf_name);
+		xfree(conf_name);
+	}
 
 	if ((error_code = init_node_conf()))
 		return error_code;
@@ -1095,6 +1106,41 @@ static void _test_cgroup_plugin_use(void)
 	xfree(plugins);
 }
 
+/*
+ * Pack the slurm.conf lines and values that the node, front end and
+ * partition records are built from, so that a reconfiguration can tell
+ * whether those records need to be built again.
+ */
+static Buf _pack_conf_records(void)
+{
+	Buf buffer = init_buf(BUF_SIZE);
+
+	slurm_conf_pack_node_lines(buffer);
+	packstr(slurmctld_conf.accounting_storage_tres, buffer);
+	pack16(slurmctld_conf.disable_root_jobs, buffer);
+	pack16(slurmctld_conf.fast_schedule, buffer);
+	packstr(slurmctld_conf.gres_plugins, buffer);
+	packstr(slurmctld_conf.node_features_plugins, buffer);
+	packstr(slurmctld_conf.priority_weight_tres, buffer);
+	packstr(slurmctld_conf.select_type, buffer);
+	pack16(slurmctld_conf.select_type_param, buffer);
+	pack32(slurmctld_conf.slurmd_port, buffer);
+	pack16((slurmctld_conf.suspend_program &&
+		slurmctld_conf.resume_program), buffer);
+	packstr(slurmctld_conf.topology_plugin, buffer);
+
+	return buffer;
+}
+
+static bool _same_conf_records(Buf buffer)
+{
+	if (!conf_records ||
+	    (get_buf_offset(conf_records) != get_buf_offset(buffer)))
+		return false;
+	return !memcmp(get_buf_data(conf_records), get_buf_data(buffer),
+		       get_buf_offset(buffer));
+}
+
 /*
  * read_slurm_conf - load the slurm configuration from the configured file.
  * read_slurm_conf can be called more than once if so desired.
@@ -1107,13 +1153,16 @@ static void _test_cgroup_plugin_use(void)
  *              2 = recover all saved state
  * IN reconfig - true if SIGHUP or "scontrol reconfig" and there is state in
  *		 memory to preserve, otherwise recover state from disk
+ *		 With SlurmctldParameters=reconfig_in_place the node and
+ *		 partition records are kept as they are if the slurm.conf
+ *		 lines they were built from did not change.
  * RET SLURM_SUCCESS if no error, otherwise an error code
  * Note: Operates on common variables only
  */
 int read_slurm_conf(int recover, bool reconfig)
 {
 	DEF_TIMERS;
-	int error_code, i, rc, load_job_ret = SLURM_SUCCESS;
+	int error_code = SLURM_SUCCESS, i, rc, load_job_ret = SLURM_SUCCESS;
 	int old_node_record_count = 0;
 	struct node_record *old_node_table_ptr = NULL, *node_ptr;
 	bool do_reorder_nodes = false;
@@ -1132,9 +1181,14 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *mpi_params;
 	uint16_t old_select_type_p = slurmctld_conf.select_type_param;
 	bool cgroup_mem_confinement = false;
+	struct timeval recover_tv = { 0, 0 };
+	bool in_place = false, reread = true;
+	Buf new_records = NULL;
 
 	/* initialization */
 	START_TIMER;
+	if (!reconfig && recover && !test_config)
+		_prefetch_state_files(state_save_dir, recover);
 
 	xfree(slurmctld_config.auth_info);
 	slurmctld_config.auth_info = slurm_get_auth_info();
@@ -1144,7 +1198,25 @@ int read_slurm_conf(int recover, bool reconfig)
 		 * update nodes_completing string (based on node bitmaps)
 		 */
 		update_job_nodes_completing();
+	}
 
+	if (reconfig && conf_records &&
+	    xstrcasestr(slurmctld_conf.slurmctld_params, "reconfig_in_place")) {
+		char *conf_name = xstrdup(slurmctld_conf.slurm_conf);
+
+		slurm_conf_reinit(conf_name);
+		xfree(conf_name);
+		reread = false;
+		new_records = _pack_conf_records();
+		if (_same_conf_records(new_records)) {
+			info("%s: node and partition configuration unchanged, reconfiguring in place",
+			     __func__);
+			in_place = true;
+		}
+		FREE_NULL_BUFFER(new_records);
+	}
+
+	if (reconfig && !in_place) {
 		/* save node and partition states for reconfig RPC */
 		old_node_record_count = node_record_count;
 		old_node_table_ptr    = node_record_table_ptr;
@@ -1168,7 +1240,7 @@ int read_slurm_conf(int recover, bool reconfig)
 		default_part_name = NULL;
 	}
 
-	if ((error_code = _init_all_slurm_conf())) {
+	if (!in_place && (error_code = _init_all_slurm_conf(reread))) {
 		node_record_table_ptr = old_node_table_ptr;
 		node_record_count = old_node_record_count;
 		part_list = old_part_list;
@@ -1210,17 +1282,18 @@ int read_slurm_conf(int recover, bool reconfig)
 	}
 
 	/* Build node and partition information based upon slurm.conf file */
-	_build_all_nodeline_info();
-	if (reconfig) {
-		if (_compare_hostnames(old_node_table_ptr,
-				       old_node_record_count,
-				       node_record_table_ptr,
-				       node_record_count) < 0) {
+	if (!in_place) {
+		_build_all_nodeline_info();
+		if (reconfig &&
+		    (_compare_hostnames(old_node_table_ptr,
+					old_node_record_count,
+					node_record_table_ptr,
+					node_record_count) < 0)) {
 			fatal("%s: hostnames inconsistency detected", __func__);
 		}
+		_handle_all_downnodes();
+		_build_all_partitionline_info();
 	}
-	_handle_all_downnodes();
-	_build_all_partitionline_info();
 	if (!reconfig) {
 		restore_front_end_state(recover);
 
@@ -1274,15 +1347,17 @@ int read_slurm_conf(int recover, bool reconfig)
 	 * plugin. Reordering the table must be done before hashing the
 	 * nodes, and before any position-relative bitmaps are created.
 	 */
-	do_reorder_nodes |= slurm_topo_generate_node_ranking();
-	do_reorder_nodes |= select_g_node_ranking(node_record_table_ptr,
-						  node_record_count);
-	if (do_reorder_nodes)
-		_reorder_nodes_by_rank();
-	else
-		_reorder_nodes_by_name();
+	if (!in_place) {
+		do_reorder_nodes |= slurm_topo_generate_node_ranking();
+		do_reorder_nodes |= select_g_node_ranking(node_record_table_ptr,
+							  node_record_count);
+		if (do_reorder_nodes)
+			_reorder_nodes_by_rank();
+		else
+			_reorder_nodes_by_name();
 
-	rehash_node();
+		rehash_node();
+	}
 	slurm_topo_build_config();
 	route_g_reconfigure();
 	if (reconfig)
@@ -1290,7 +1365,8 @@ int read_slurm_conf(int recover, bool reconfig)
 	cpu_freq_reconfig();
 
 	rehash_jobs();
-	_set_slurmd_addr();
+	if (!in_place)
+		_set_slurmd_addr();
 
 	_stat_slurm_dirs();
 
@@ -1312,7 +1388,11 @@ int read_slurm_conf(int recover, bool reconfig)
 	 * Set standard features and preserve the plugin controlled ones.
 	 * A reconfig always imply load the state from slurm.conf
 	 */
-	if (reconfig) {		/* Preserve state from memory */
+	if (in_place) {		/* Records were left as they are */
+		load_last_job_id();
+		reset_first_job_id();
+		(void) slurm_sched_g_reconfig();
+	} else if (reconfig) {	/* Preserve state from memory */
 		if (old_node_table_ptr) {
 			info("restoring original state of nodes");
 			_set_features(old_node_table_ptr, old_node_record_count,
@@ -1346,46 +1426,60 @@ int read_slurm_conf(int recover, bool reconfig)
 		reset_first_job_id();
 		(void) slurm_sched_g_reconfig();
 	} else if (recover == 1) {	/* Load job & node state files */
+		gettimeofday(&recover_tv, NULL);
 		(void) load_all_node_state(true);
 		_set_features(node_record_table_ptr, node_record_count,
 			      recover);
+		_log_recover_time("node state", &recover_tv);
 		(void) load_all_front_end_state(true);
+		_log_recover_time("front end state", &recover_tv);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		_log_recover_time("job state", &recover_tv);
 	} else if (recover > 1) {	/* Load node, part & job state files */
+		gettimeofday(&recover_tv, NULL);
 		(void) load_all_node_state(false);
 		_set_features(old_node_table_ptr, old_node_record_count,
 			      recover);
+		_log_recover_time("node state", &recover_tv);
 		(void) load_all_front_end_state(false);
+		_log_recover_time("front end state", &recover_tv);
 		(void) load_all_part_state();
+		_log_recover_time("partition state", &recover_tv);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		_log_recover_time("job state", &recover_tv);
 	}
 
-	_sync_part_prio();
-	_build_bitmaps_pre_select();
-	if ((select_g_node_init(node_record_table_ptr, node_record_count)
-	     != SLURM_SUCCESS)						||
-	    (select_g_block_init(part_list) != SLURM_SUCCESS)		||
-	    (select_g_state_restore(state_save_dir) != SLURM_SUCCESS)	||
-	    (select_g_job_init(job_list) != SLURM_SUCCESS)) {
-		if (test_config) {
-			error("Failed to initialize node selection plugin state");
-			test_config_rc = 1;
-		} else {
-			fatal("Failed to initialize node selection plugin state, "
-			      "Clean start required.");
+	if (!in_place) {
+		_sync_part_prio();
+		_build_bitmaps_pre_select();
+		if ((select_g_node_init(node_record_table_ptr,
+					node_record_count) != SLURM_SUCCESS) ||
+		    (select_g_block_init(part_list) != SLURM_SUCCESS)	    ||
+		    (select_g_state_restore(state_save_dir) != SLURM_SUCCESS) ||
+		    (select_g_job_init(job_list) != SLURM_SUCCESS)) {
+			if (test_config) {
+				error("Failed to initialize node selection plugin state");
+				test_config_rc = 1;
+			} else {
+				fatal("Failed to initialize node selection plugin state, "
+				      "Clean start required.");
+			}
 		}
 	}
 
 	xfree(state_save_dir);
 	_gres_reconfig(reconfig);
-	reset_job_bitmaps();		/* must follow select_g_job_init() */
+	if (!in_place) {
+		reset_job_bitmaps();	/* must follow select_g_job_init() */
 
-	(void) _sync_nodes_to_jobs(reconfig);
-	(void) sync_job_files();
-	_purge_old_node_state(old_node_table_ptr, old_node_record_count);
-	_purge_old_part_state(old_part_list, old_def_part_name);
+		(void) _sync_nodes_to_jobs(reconfig);
+		(void) sync_job_files();
+		_purge_old_node_state(old_node_table_ptr,
+				      old_node_record_count);
+		_purge_old_part_state(old_part_list, old_def_part_name);
+	}
 
 	mpi_params = slurm_get_mpi_params();
 	reserve_port_config(mpi_params);
@@ -1404,33 +1498,38 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	init_requeue_policy();
 
-	/* NOTE: Run restore_node_features before _restore_job_dependencies */
-	restore_node_features(recover);
-
-	if ((node_features_g_count() > 0) &&
-	    (node_features_g_get_node(NULL) != SLURM_SUCCESS)) {
-		error("failed to initialize node features");
-		test_config_rc = 1;
-	}
+	if (!in_place) {
+		/*
+		 * NOTE: Run restore_node_features before
+		 * _restore_job_dependencies
+		 */
+		restore_node_features(recover);
 
-	/*
-	 * _build_bitmaps() must follow node_features_g_get_node() and
-	 * preceed build_features_list_*()
-	 */
-	if ((rc = _build_bitmaps())) {
-		if (test_config) {
-			error("_build_bitmaps failure");
+		if ((node_features_g_count() > 0) &&
+		    (node_features_g_get_node(NULL) != SLURM_SUCCESS)) {
+			error("failed to initialize node features");
 			test_config_rc = 1;
-		} else {
-			fatal("_build_bitmaps failure");
 		}
-	}
 
-	/* Active and available features can be different on -R */
-	if ((node_features_g_count() == 0) && (recover != 2))
-		build_feature_list_eq();
-	else
-		build_feature_list_ne();
+		/*
+		 * _build_bitmaps() must follow node_features_g_get_node() and
+		 * preceed build_features_list_*()
+		 */
+		if ((rc = _build_bitmaps())) {
+			if (test_config) {
+				error("_build_bitmaps failure");
+				test_config_rc = 1;
+			} else {
+				fatal("_build_bitmaps failure");
+			}
+		}
+
+		/* Active and available features can be different on -R */
+		if ((node_features_g_count() == 0) && (recover != 2))
+			build_feature_list_eq();
+		else
+			build_feature_list_ne();
+	}
 
 	/*
 	 * Must be at after nodes and partitons (e.g.
@@ -1440,27 +1539,40 @@ int read_slurm_conf(int recover, bool reconfig)
 	if (!test_config)
 		set_cluster_tres(false);
 
-	_validate_pack_jobs();
-	(void) _sync_nodes_to_comp_job();/* must follow select_g_node_init() */
+	if (!in_place) {
+		_validate_pack_jobs();
+		/* must follow select_g_node_init() */
+		(void) _sync_nodes_to_comp_job();
+	}
 	load_part_uid_allow_list(1);
 
 	if (reconfig) {
-		load_all_resv_state(0);
+		if (!in_place)
+			load_all_resv_state(0);
 	} else {
+		if (recover >= 1)
+			gettimeofday(&recover_tv, NULL);
 		load_all_resv_state(recover);
 		if (recover >= 1) {
+			_log_recover_time("reservation state", &recover_tv);
 			trigger_state_restore();
+			_log_recover_time("trigger state", &recover_tv);
 			(void) slurm_sched_g_reconfig();
 		}
 	}
 	 if (test_config)
 		return error_code;
 
-	/* NOTE: Run load_all_resv_state() before _restore_job_dependencies */
-	_restore_job_dependencies();
+	if (!in_place) {
+		/*
+		 * NOTE: Run load_all_resv_state() before
+		 * _restore_job_dependencies
+		 */
+		_restore_job_dependencies();
 
-	/* sort config_list by weight for scheduling */
-	list_sort(config_list, &list_compare_config);
+		/* sort config_list by weight for scheduling */
+		list_sort(config_list, &list_compare_config);
+	}
 
 	/* Update plugins as possible */
 	rc = _preserve_plugins(&slurmctld_conf,
@@ -1517,12 +1629,84 @@ int read_slurm_conf(int recover, bool reconfig)
 		fatal("Failed to reconfigure mcs plugin");
 
 	_set_response_cluster_rec();
+	lock_stats_enable(xstrcasestr(slurmctld_conf.slurmctld_params,
+				      "lock_stats"));
+
+	if (!in_place) {
+		FREE_NULL_BUFFER(conf_records);
+		conf_records = _pack_conf_records();
+	}
 
 	slurmctld_conf.last_update = time(NULL);
 	END_TIMER2("read_slurm_conf");
 	return error_code;
 }
 
+/*
+ * Read a state save file into the page cache, run as a detached thread so
+ * that the file is read while the state files before it are recovered
+ */
+static void *_prefetch_state_file(void *arg)
+{
+	char *state_file = arg, *buf;
+	ssize_t len;
+	uint64_t total = 0;
+	int fd;
+	DEF_TIMERS;
+
+	START_TIMER;
+	if ((fd = open(state_file, O_RDONLY | O_CLOEXEC)) < 0) {
+		xfree(state_file);
+		return NULL;
+	}
+	buf = xmalloc(PREFETCH_CHUNK);
+	while (1) {
+		len = read(fd, buf, PREFETCH_CHUNK);
+		if ((len < 0) && (errno == EINTR))
+			continue;
+		if (len <= 0)
+			break;
+		total += len;
+	}
+	(void) close(fd);
+	xfree(buf);
+	END_TIMER;
+	debug2("%s: read %"PRIu64" bytes of %s %s",
+	       __func__, total, state_file, TIME_STR);
+	xfree(state_file);
+	return NULL;
+}
+
+/*
+ * Start reading the state save files to be recovered, all at once. They
+ * are still loaded one after the other, as each one refers to the records
+ * of those before it, but no longer wait on the file system in turn.
+ */
+static void _prefetch_state_files(char *state_save_dir, int recover)
+{
+	static const char *state_files[] = {
+		"job_state", "node_state", "front_end_state", "part_state",
+		"resv_state", "trigger_state", NULL
+	};
+	int i;
+
+	for (i = 0; state_files[i]; i++) {
+		if ((recover < 2) && !xstrcmp(state_files[i], "part_state"))
+			continue;
+		slurm_thread_create_detached(NULL, _prefetch_state_file,
+					     xstrdup_printf("%s/%s",
+							    state_save_dir,
+							    state_files[i]));
+	}
+}
+
+/* Log how long recovering a state file took and restart the timer */
+static void _log_recover_time(const char *state, struct timeval *tv)
+{
+	verbose("Recovered %s in %d usec", state, slurm_delta_tv(tv));
+	gettimeofday(tv, NULL);
+}
+
 /* Add feature to list
  * feature_list IN - destination list, either active_feature_list or
  *	avail_feature_list
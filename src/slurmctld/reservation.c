@@ -76,8 +76,10 @@
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/node_scheduler.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/script_launcher.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 
 #define _DEBUG		0
 #define RESV_MAGIC	0x3b82
@@ -2996,6 +2998,7 @@ extern int dump_all_resv_state(void)
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink(new_file);
+		state_stream_queue(reg_file, buffer);
 	}
 	xfree(old_file);
 	xfree(reg_file);
@@ -3342,6 +3345,9 @@ static Buf _open_resv_state_file(char **state_file)
 
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/resv_state");
+
+	if ((buf = state_stream_get(*state_file)))
+		return buf;
 	if (!(buf = create_mmap_buf(*state_file)))
 		error("Could not open reservation state file %s: %m",
 		      *state_file);
@@ -5291,21 +5297,21 @@ static void *_fork_script(void *x)
 	int status, wait_rc;
 	pid_t cpid;
 	uint16_t tm;
+	script_launch_t launch;
 
 	argv[0] = args->script;
 	argv[1] = args->resv_name;
 	argv[2] = NULL;
 	envp[0] = NULL;
 
-	if ((cpid = fork()) < 0) {
+	memset(&launch, 0, sizeof(launch));
+	launch.path = argv[0];
+	launch.argv = argv;
+	launch.env = envp;
+	if ((cpid = script_launcher_start(&launch)) < 0) {
 		error("_fork_script fork error: %m");
 		goto fini;
 	}
-	if (cpid == 0) {
-		setpgid(0, 0);
-		execve(argv[0], argv, envp);
-		exit(127);
-	}
 
 	tm = slurm_get_prolog_timeout();
 	while (1) {
@@ -0,0 +1,578 @@
+/*****************************************************************************\
+ *  script_launcher.c - run scripts from a small helper process
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "src/common/env.h"
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/pack.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/script_launcher.h"
+
+/*
+ * slurmctld and the helper exchange packed messages over a socketpair,
+ * each preceded by its length. slurmctld sends one request per script and
+ * the helper answers with LAUNCH_STARTED once it forked the script, then
+ * with LAUNCH_EXITED once the script ended. The helper exits when the
+ * socket is closed.
+ */
+enum {
+	LAUNCH_STARTED = 1,
+	LAUNCH_EXITED
+};
+
+#define LAUNCH_MAX_MSG	(64 * 1024 * 1024)
+
+typedef struct {
+	uint32_t id;
+	pid_t pid;		/* 0 until started, -1 if the fork failed */
+	int err;		/* errno of the failed fork */
+	bool exited;
+	int status;		/* exit status once exited */
+	bool forgotten;		/* nobody waits for it, see
+				 * script_launcher_forget() */
+} launch_rec_t;
+
+static pthread_mutex_t launch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t launch_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+static List launch_list = NULL;	/* scripts started by the helper */
+static uint32_t launch_id = 0;
+static int launch_fd = -1;
+static bool helper_running = false;
+static pid_t helper_pid = 0;
+static pthread_t reader_tid = 0;
+
+static int sigchld_pipe[2] = { -1, -1 };
+
+/* Run in the forked child, never returns */
+static void _exec_script(script_launch_t *launch)
+{
+	sigset_t set;
+	int i, fd;
+
+	for (i = 0; i < 1024; i++)
+		(void) close(i);
+	if ((launch->flags & SCRIPT_LAUNCH_NULL_STDIO) &&
+	    ((fd = open("/dev/null", O_RDWR)) == STDIN_FILENO)) {
+		(void) dup2(fd, STDOUT_FILENO);
+		(void) dup2(fd, STDERR_FILENO);
+	}
+
+	/* The helper ignores or blocks signals the script should get */
+	(void) signal(SIGCHLD, SIG_DFL);
+	(void) signal(SIGHUP, SIG_DFL);
+	(void) signal(SIGINT, SIG_DFL);
+	(void) signal(SIGPIPE, SIG_DFL);
+	(void) signal(SIGTERM, SIG_DFL);
+	(void) signal(SIGUSR1, SIG_DFL);
+	(void) signal(SIGUSR2, SIG_DFL);
+	sigemptyset(&set);
+	(void) pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+	setpgid(0, 0);
+	if (launch->flags & SCRIPT_LAUNCH_SETSID)
+		setsid();
+	if (launch->flags & SCRIPT_LAUNCH_SET_USER) {
+		bool run_as_self = (launch->uid == getuid());
+
+		if ((initgroups(launch->user_name, launch->gid) == -1) &&
+		    !run_as_self) {
+			error("%s: initgroups: %m", __func__);
+			_exit(127);
+		}
+		if ((setgid(launch->gid) == -1) && !run_as_self) {
+			error("%s: setgid: %m", __func__);
+			_exit(127);
+		}
+		if ((setuid(launch->uid) == -1) && !run_as_self) {
+			error("%s: setuid: %m", __func__);
+			_exit(127);
+		}
+	}
+
+	if (launch->env)
+		execve(launch->path, launch->argv, launch->env);
+	else
+		execv(launch->path, launch->argv);
+	_exit(127);
+}
+
+static int _send_msg(int fd, Buf buffer)
+{
+	uint32_t len = get_buf_offset(buffer), nlen = htonl(len);
+
+	safe_write(fd, &nlen, sizeof(nlen));
+	safe_write(fd, get_buf_data(buffer), len);
+	return SLURM_SUCCESS;
+
+rwfail:
+	return SLURM_ERROR;
+}
+
+static Buf _recv_msg(int fd)
+{
+	uint32_t len, nlen;
+	char *data;
+
+	safe_read(fd, &nlen, sizeof(nlen));
+	len = ntohl(nlen);
+	if (len > LAUNCH_MAX_MSG) {
+		error("%s: message too large (%u bytes)", __func__, len);
+		return NULL;
+	}
+	data = xmalloc(len);
+	safe_read(fd, data, len);
+	return create_buf(data, len);
+
+rwfail:
+	return NULL;
+}
+
+static void _pack_reply(Buf buffer, uint16_t type, uint32_t id, pid_t pid,
+			int value)
+{
+	set_buf_offset(buffer, 0);
+	pack16(type, buffer);
+	pack32(id, buffer);
+	pack32((uint32_t) pid, buffer);
+	pack32((uint32_t) value, buffer);
+}
+
+static void _free_launch(script_launch_t *launch)
+{
+	int i;
+
+	xfree(launch->path);
+	for (i = 0; launch->argv && launch->argv[i]; i++)
+		xfree(launch->argv[i]);
+	xfree(launch->argv);
+	for (i = 0; launch->env && launch->env[i]; i++)
+		xfree(launch->env[i]);
+	xfree(launch->env);
+	xfree(launch->user_name);
+}
+
+static int _unpack_launch(script_launch_t *launch, uint32_t *id, Buf buffer)
+{
+	uint32_t uint32_tmp, cnt;
+	uint16_t have_env;
+
+	memset(launch, 0, sizeof(*launch));
+	safe_unpack32(id, buffer);
+	safe_unpackstr_xmalloc(&launch->path, &uint32_tmp, buffer);
+	safe_unpackstr_array(&launch->argv, &cnt, buffer);
+	safe_unpack16(&have_env, buffer);
+	safe_unpackstr_array(&launch->env, &cnt, buffer);
+	if (have_env && !launch->env)
+		launch->env = xmalloc(sizeof(char *));
+	safe_unpack16(&launch->flags, buffer);
+	safe_unpack32(&uint32_tmp, buffer);
+	launch->uid = uint32_tmp;
+	safe_unpack32(&uint32_tmp, buffer);
+	launch->gid = uint32_tmp;
+	safe_unpackstr_xmalloc(&launch->user_name, &uint32_tmp, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	_free_launch(launch);
+	return SLURM_ERROR;
+}
+
+static void _sigchld_handler(int signo)
+{
+	int save_errno = errno;
+	char c = 0;
+
+	(void) write(sigchld_pipe[1], &c, 1);
+	errno = save_errno;
+}
+
+/* Main loop of the helper process, never returns */
+static void _helper(int fd)
+{
+	struct pollfd pfds[2];
+	struct sigaction sa;
+	script_launch_t launch;
+	Buf buffer, reply = init_buf(64);
+	sigset_t set;
+	uint32_t id;
+	pid_t pid;
+	int i, status;
+	char c[64];
+
+	/* Only slurmctld closing the socket ends the helper */
+	(void) signal(SIGHUP, SIG_IGN);
+	(void) signal(SIGINT, SIG_IGN);
+	(void) signal(SIGPIPE, SIG_IGN);
+	(void) signal(SIGTERM, SIG_IGN);
+	(void) signal(SIGUSR1, SIG_IGN);
+	(void) signal(SIGUSR2, SIG_IGN);
+
+	if (pipe(sigchld_pipe) < 0) {
+		error("%s: pipe: %m", __func__);
+		_exit(1);
+	}
+	fd_set_nonblocking(sigchld_pipe[0]);
+	fd_set_nonblocking(sigchld_pipe[1]);
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = _sigchld_handler;
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigemptyset(&sa.sa_mask);
+	(void) sigaction(SIGCHLD, &sa, NULL);
+	sigemptyset(&set);
+	(void) pthread_sigmask(SIG_SETMASK, &set, NULL);
+
+	pfds[0].fd = fd;
+	pfds[0].events = POLLIN;
+	pfds[1].fd = sigchld_pipe[0];
+	pfds[1].events = POLLIN;
+
+	while (1) {
+		if (poll(pfds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			_exit(1);
+		}
+
+		if (pfds[1].revents) {
+			while (read(sigchld_pipe[0], c, sizeof(c)) > 0)
+				;
+			while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+				_pack_reply(reply, LAUNCH_EXITED, 0, pid,
+					    status);
+				if (_send_msg(fd, reply))
+					_exit(0);
+			}
+		}
+
+		if (!pfds[0].revents)
+			continue;
+		if (!(buffer = _recv_msg(fd)))
+			_exit(0);
+		i = _unpack_launch(&launch, &id, buffer);
+		free_buf(buffer);
+		if (i != SLURM_SUCCESS)
+			_exit(1);
+
+		pid = fork();
+		if (pid == 0)
+			_exec_script(&launch);
+		_pack_reply(reply, LAUNCH_STARTED, id, (pid < 0) ? -1 : pid,
+			    (pid < 0) ? errno : 0);
+		_free_launch(&launch);
+		if (_send_msg(fd, reply))
+			_exit(0);
+	}
+}
+
+static void _free_launch_rec(void *x)
+{
+	launch_rec_t *rec = x;
+
+	xfree(rec);
+}
+
+static int _find_id(void *x, void *key)
+{
+	launch_rec_t *rec = x;
+
+	return (rec->id == *(uint32_t *) key);
+}
+
+static int _find_pid(void *x, void *key)
+{
+	launch_rec_t *rec = x;
+
+	return ((rec->pid > 0) && (rec->pid == *(pid_t *) key));
+}
+
+/* A pid may be reused once its script ended and was reaped */
+static int _find_running_pid(void *x, void *key)
+{
+	launch_rec_t *rec = x;
+
+	return (!rec->exited && _find_pid(x, key));
+}
+
+static int _match_rec(void *x, void *key)
+{
+	return (x == key);
+}
+
+/*
+ * Fail the scripts the helper can no longer report on.
+ * RET 1 to delete the record if nobody waits for it
+ */
+static int _helper_gone(void *x, void *arg)
+{
+	launch_rec_t *rec = x;
+
+	if (!rec->pid) {
+		rec->pid = -1;
+		rec->err = ECHILD;
+	} else if ((rec->pid > 0) && !rec->exited) {
+		error("script launcher ended, exit status of pid %d is unknown",
+		      (int) rec->pid);
+		rec->exited = true;
+		rec->status = 127 << 8;
+	}
+	return rec->forgotten;
+}
+
+/* Read the replies of the helper */
+static void *_reader(void *arg)
+{
+	int fd = *(int *) arg;
+	launch_rec_t *rec;
+	Buf buffer;
+	uint16_t type;
+	uint32_t id, pid, value;
+
+	while ((buffer = _recv_msg(fd))) {
+		if (unpack16(&type, buffer) || unpack32(&id, buffer) ||
+		    unpack32(&pid, buffer) || unpack32(&value, buffer)) {
+			free_buf(buffer);
+			break;
+		}
+		free_buf(buffer);
+
+		slurm_mutex_lock(&launch_mutex);
+		if (type == LAUNCH_STARTED) {
+			if ((rec = list_find_first(launch_list, _find_id,
+						   &id))) {
+				rec->pid = (pid_t) pid;
+				rec->err = (int) value;
+			}
+		} else if ((rec = list_find_first(launch_list,
+						  _find_running_pid, &pid))) {
+			rec->exited = true;
+			rec->status = (int) value;
+			if (rec->forgotten)
+				(void) list_delete_all(launch_list, _match_rec,
+						       rec);
+		}
+		slurm_cond_broadcast(&launch_cond);
+		slurm_mutex_unlock(&launch_mutex);
+	}
+
+	(void) waitpid(helper_pid, NULL, 0);
+
+	slurm_mutex_lock(&launch_mutex);
+	if (helper_running)
+		error("script launcher ended, scripts will be forked from slurmctld");
+	helper_running = false;
+	(void) list_delete_all(launch_list, _helper_gone, NULL);
+	slurm_cond_broadcast(&launch_cond);
+	slurm_mutex_unlock(&launch_mutex);
+
+	return NULL;
+}
+
+extern void script_launcher_init(void)
+{
+	sigset_t set, old_set;
+	int sv[2];
+	pid_t pid;
+
+	slurm_mutex_lock(&launch_mutex);
+	if (helper_running) {
+		slurm_mutex_unlock(&launch_mutex);
+		return;
+	}
+	if (!launch_list)
+		launch_list = list_create(_free_launch_rec);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		error("%s: socketpair: %m", __func__);
+		slurm_mutex_unlock(&launch_mutex);
+		return;
+	}
+	if ((pid = fork()) < 0) {
+		error("%s: fork: %m", __func__);
+		(void) close(sv[0]);
+		(void) close(sv[1]);
+		slurm_mutex_unlock(&launch_mutex);
+		return;
+	}
+	if (pid == 0) {
+		(void) close(sv[0]);
+		_helper(sv[1]);
+	}
+
+	(void) close(sv[1]);
+	fd_set_close_on_exec(sv[0]);
+	launch_fd = sv[0];
+	helper_pid = pid;
+	helper_running = true;
+
+	/* Leave signals to the threads of slurmctld that handle them */
+	sigfillset(&set);
+	(void) pthread_sigmask(SIG_BLOCK, &set, &old_set);
+	slurm_thread_create(&reader_tid, _reader, &launch_fd);
+	(void) pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+	slurm_mutex_unlock(&launch_mutex);
+	debug("script launcher started, pid %d", (int) pid);
+}
+
+extern void script_launcher_fini(void)
+{
+	slurm_mutex_lock(&launch_mutex);
+	if (!helper_pid) {
+		slurm_mutex_unlock(&launch_mutex);
+		return;
+	}
+	helper_running = false;
+	(void) shutdown(launch_fd, SHUT_RDWR);
+	slurm_mutex_unlock(&launch_mutex);
+
+	pthread_join(reader_tid, NULL);
+
+	slurm_mutex_lock(&launch_mutex);
+	(void) close(launch_fd);
+	launch_fd = -1;
+	helper_pid = 0;
+	reader_tid = 0;
+	FREE_NULL_LIST(launch_list);
+	slurm_mutex_unlock(&launch_mutex);
+}
+
+extern pid_t script_launcher_start(script_launch_t *launch)
+{
+	launch_rec_t *rec;
+	Buf buffer;
+	pid_t pid;
+	int cnt, rc;
+
+	slurm_mutex_lock(&launch_mutex);
+	if (!helper_running) {
+		slurm_mutex_unlock(&launch_mutex);
+		if ((pid = fork()) == 0)
+			_exec_script(launch);
+		return pid;
+	}
+	rec = xmalloc(sizeof(launch_rec_t));
+	rec->id = ++launch_id;
+	list_append(launch_list, rec);
+	slurm_mutex_unlock(&launch_mutex);
+
+	buffer = init_buf(1024);
+	pack32(rec->id, buffer);
+	packstr(launch->path, buffer);
+	for (cnt = 0; launch->argv && launch->argv[cnt]; cnt++)
+		;
+	packstr_array(launch->argv, cnt, buffer);
+	pack16((launch->env != NULL), buffer);
+	packstr_array(launch->env, envcount(launch->env), buffer);
+	pack16(launch->flags, buffer);
+	pack32((uint32_t) launch->uid, buffer);
+	pack32((uint32_t) launch->gid, buffer);
+	packstr(launch->user_name, buffer);
+
+	slurm_mutex_lock(&write_mutex);
+	rc = _send_msg(launch_fd, buffer);
+	slurm_mutex_unlock(&write_mutex);
+	free_buf(buffer);
+
+	slurm_mutex_lock(&launch_mutex);
+	if (rc != SLURM_SUCCESS) {
+		/* The reader notices as well, and fails the record */
+		(void) shutdown(launch_fd, SHUT_RDWR);
+	}
+	while (!rec->pid)
+		slurm_cond_wait(&launch_cond, &launch_mutex);
+	pid = rec->pid;
+	if (pid < 0) {
+		errno = rec->err;
+		(void) list_delete_all(launch_list, _match_rec, rec);
+	}
+	slurm_mutex_unlock(&launch_mutex);
+
+	return pid;
+}
+
+extern pid_t script_launcher_waitpid(pid_t pid, int *status, int options)
+{
+	launch_rec_t *rec;
+
+	slurm_mutex_lock(&launch_mutex);
+	if (!launch_list ||
+	    !(rec = list_find_first(launch_list, _find_pid, &pid))) {
+		slurm_mutex_unlock(&launch_mutex);
+		return waitpid(pid, status, options);
+	}
+	while (!rec->exited) {
+		if (options & WNOHANG) {
+			slurm_mutex_unlock(&launch_mutex);
+			return 0;
+		}
+		slurm_cond_wait(&launch_cond, &launch_mutex);
+	}
+	if (status)
+		*status = rec->status;
+	(void) list_delete_all(launch_list, _match_rec, rec);
+	slurm_mutex_unlock(&launch_mutex);
+
+	return pid;
+}
+
+extern void script_launcher_forget(pid_t pid)
+{
+	launch_rec_t *rec;
+
+	slurm_mutex_lock(&launch_mutex);
+	if (launch_list &&
+	    (rec = list_find_first(launch_list, _find_pid, &pid))) {
+		if (rec->exited)
+			(void) list_delete_all(launch_list, _match_rec, rec);
+		else
+			rec->forgotten = true;
+	}
+	slurm_mutex_unlock(&launch_mutex);
+}
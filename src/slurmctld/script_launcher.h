@@ -0,0 +1,95 @@
+/*****************************************************************************\
+ *  script_launcher.h - run scripts from a small helper process
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifndef _SCRIPT_LAUNCHER_H
+#define _SCRIPT_LAUNCHER_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* script_launch_t flags */
+#define SCRIPT_LAUNCH_NULL_STDIO	0x0001	/* stdin/out/err on /dev/null */
+#define SCRIPT_LAUNCH_SETSID		0x0002	/* start a new session */
+#define SCRIPT_LAUNCH_SET_USER		0x0004	/* run as uid/gid/user_name */
+
+typedef struct {
+	char *path;		/* fully qualified program to execute */
+	char **argv;		/* NULL terminated arguments */
+	char **env;		/* NULL terminated environment, or NULL to
+				 * inherit the environment of slurmctld */
+	uint16_t flags;		/* SCRIPT_LAUNCH_* */
+	uid_t uid;		/* used with SCRIPT_LAUNCH_SET_USER */
+	gid_t gid;
+	char *user_name;
+} script_launch_t;
+
+/*
+ * Fork the helper process that scripts are started from. Call this early,
+ * while slurmctld is still small, as forking from a process with a large
+ * address space is slow and can stall its other threads. Scripts are
+ * forked from slurmctld itself if the helper is not running.
+ */
+extern void script_launcher_init(void);
+
+/* Stop the helper process */
+extern void script_launcher_fini(void);
+
+/*
+ * Start a script in its own process group.
+ * RET pid of the script or -1 on error, with errno set
+ */
+extern pid_t script_launcher_start(script_launch_t *launch);
+
+/*
+ * Like waitpid(2) for a script started by script_launcher_start(), only
+ * the WNOHANG option is supported. Other pids are passed on to waitpid().
+ * IN pid - as returned by script_launcher_start()
+ * OUT status - exit status of the script, may be NULL
+ * IN options - 0 or WNOHANG
+ * RET pid once the script ended, 0 if it is still running with WNOHANG,
+ *     or -1 on error, with errno set
+ */
+extern pid_t script_launcher_waitpid(pid_t pid, int *status, int options);
+
+/*
+ * Tell that script_launcher_waitpid() will not be called for pid, so that
+ * its exit status is dropped once it ends rather than kept for a caller.
+ * IN pid - as returned by script_launcher_start()
+ */
+extern void script_launcher_forget(pid_t pid);
+
+#endif
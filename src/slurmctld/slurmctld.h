@@ -1968,6 +1968,9 @@ extern int num_pending_job_array_tasks(uint32_t array_job_id);
  *	machine independent form (for network transmission)
  * OUT buffer_ptr - the pointer is set to the allocated buffer.
  * OUT buffer_size - set to size of the buffer in bytes
+ * IN/OUT chunks - if not NULL, a large dump is split into further
+ *	self-contained buffers (Buf) appended to this list, to be sent
+ *	after *buffer_ptr with slurm_send_node_msg_chunked()
  * IN show_flags - job filtering options
  * IN uid - uid of user making request (for partition filtering)
  * IN filter_uid - pack only jobs belonging to this user if not NO_VAL
@@ -1977,7 +1980,7 @@ extern int num_pending_job_array_tasks(uint32_t array_job_id);
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
  *	whenever the data format changes
  */
-extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
+extern void pack_all_jobs(char **buffer_ptr, int *buffer_size, List chunks,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version);
 
@@ -2600,6 +2603,15 @@ extern int validate_job_create_req(job_desc_msg_t * job_desc, uid_t submit_uid,
  */
 extern void validate_jobs_on_node(slurm_node_registration_status_msg_t *reg_msg);
 
+/*
+ * validate_jobs_on_nodes - validate_jobs_on_node() for several nodes at
+ *	once, looking for missing jobs with one pass over the job list
+ * IN reg_msgs - node registration messages
+ * IN reg_cnt - count of reg_msgs
+ */
+extern void validate_jobs_on_nodes(
+	slurm_node_registration_status_msg_t **reg_msgs, int reg_cnt);
+
 /*
  * validate_node_specs - validate the node's specifications as valid,
  *	if not set state to down, in any case update last_response
@@ -0,0 +1,503 @@
+/*****************************************************************************\
+ *  state_stream.c - keep a copy of the state save files in the backup
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "slurm/slurm_errno.h"
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_auth.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmctld/locks.h"
+#include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/state_stream.h"
+
+/* seconds to wait before connecting again to a backup that failed */
+#define STREAM_RETRY	10
+
+typedef struct {
+	char *name;		/* base name of the file */
+	char *data;
+	uint32_t size;
+	time_t write_time;	/* mtime of the file the copy was taken from */
+	uint32_t write_nsec;
+	uint64_t seq;		/* order in which the copies were queued */
+} state_copy_t;
+
+typedef struct {
+	int fd;			/* connection to the backup, or -1 */
+	uint64_t sent_seq;	/* copies up to this one were sent */
+	time_t next_try;	/* do not connect again before this time */
+} stream_peer_t;
+
+/* Copies to send, on the primary */
+static pthread_mutex_t stream_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stream_cond = PTHREAD_COND_INITIALIZER;
+static bool streaming = false;
+static state_copy_t *send_copies = NULL;
+static int send_cnt = 0;
+static uint64_t stream_seq = 0;
+
+/* Copies received, on a backup */
+static pthread_mutex_t recv_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool receiving = true;
+static state_copy_t *recv_copies = NULL;
+static int recv_cnt = 0;
+
+static const char *_base_name(const char *state_file)
+{
+	const char *base = strrchr(state_file, '/');
+
+	return base ? (base + 1) : state_file;
+}
+
+static state_copy_t *_find_copy(state_copy_t *copies, int cnt,
+				const char *name)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		if (!xstrcmp(copies[i].name, name))
+			return &copies[i];
+	}
+	return NULL;
+}
+
+static state_copy_t *_add_copy(state_copy_t **copies, int *cnt,
+			       const char *name)
+{
+	state_copy_t *copy;
+
+	if ((copy = _find_copy(*copies, *cnt, name)))
+		return copy;
+	xrecalloc(*copies, *cnt + 1, sizeof(state_copy_t));
+	copy = &(*copies)[(*cnt)++];
+	copy->name = xstrdup(name);
+	return copy;
+}
+
+static void _free_copies(state_copy_t **copies, int *cnt)
+{
+	int i;
+
+	for (i = 0; i < *cnt; i++) {
+		xfree((*copies)[i].name);
+		xfree((*copies)[i].data);
+	}
+	xfree(*copies);
+	*cnt = 0;
+}
+
+/*
+ * Duplicate the copies queued after sent_seq, call with stream_lock held
+ * OUT cnt - number of copies returned
+ * OUT max_seq - latest copy queued
+ */
+static state_copy_t *_pending_copies(uint64_t sent_seq, int *cnt,
+				     uint64_t *max_seq)
+{
+	state_copy_t *copies = NULL;
+	int i;
+
+	*cnt = 0;
+	*max_seq = stream_seq;
+	for (i = 0; i < send_cnt; i++) {
+		state_copy_t *copy;
+
+		if (send_copies[i].seq <= sent_seq)
+			continue;
+		if (!copies)
+			copies = xcalloc(send_cnt, sizeof(state_copy_t));
+		copy = &copies[(*cnt)++];
+		copy->name = xstrdup(send_copies[i].name);
+		copy->data = xmalloc(send_copies[i].size);
+		memcpy(copy->data, send_copies[i].data, send_copies[i].size);
+		copy->size = send_copies[i].size;
+		copy->write_time = send_copies[i].write_time;
+		copy->write_nsec = send_copies[i].write_nsec;
+	}
+	return copies;
+}
+
+static int _send_copy(int fd, state_copy_t *copy)
+{
+	slurm_msg_t req, resp;
+	state_stream_msg_t stream_msg;
+	int rc;
+
+	memset(&stream_msg, 0, sizeof(stream_msg));
+	stream_msg.name = copy->name;
+	stream_msg.write_time = copy->write_time;
+	stream_msg.write_nsec = copy->write_nsec;
+	stream_msg.size = copy->size;
+	stream_msg.data = copy->data;
+
+	slurm_msg_t_init(&req);
+	slurm_msg_t_init(&resp);
+	req.msg_type = REQUEST_STATE_STREAM;
+	req.data = &stream_msg;
+
+	if (slurm_send_node_msg(fd, &req) < 0)
+		return SLURM_ERROR;
+	if (slurm_receive_msg(fd, &resp, 0))
+		return SLURM_ERROR;
+	if (resp.msg_type == RESPONSE_SLURM_RC)
+		rc = ((return_code_msg_t *) resp.data)->return_code;
+	else
+		rc = SLURM_UNEXPECTED_MSG_ERROR;
+	slurm_free_msg_members(&resp);
+	return rc;
+}
+
+/*
+ * Send the copies a backup does not have yet, connecting to it first if
+ * needed. A new connection gets every copy again.
+ * RET true if the backup is up to date
+ */
+static bool _send_peer(stream_peer_t *peer, int inx)
+{
+	/* Locks: Read config */
+	slurmctld_lock_t config_read_lock = { .conf = READ_LOCK };
+	state_copy_t *copies;
+	uint64_t max_seq;
+	slurm_addr_t addr;
+	time_t now = time(NULL);
+	int cnt, i, rc = SLURM_SUCCESS;
+
+	if (peer->fd < 0) {
+		if (now < peer->next_try)
+			return false;
+		lock_slurmctld(config_read_lock);
+		slurm_set_addr(&addr, slurmctld_conf.slurmctld_port,
+			       slurmctld_conf.control_addr[inx]);
+		unlock_slurmctld(config_read_lock);
+		if ((peer->fd = slurm_open_msg_conn(&addr)) < 0) {
+			debug("%s: can not connect to backup controller %d: %m",
+			      __func__, inx);
+			peer->next_try = now + STREAM_RETRY;
+			return false;
+		}
+		peer->sent_seq = 0;
+	}
+
+	slurm_mutex_lock(&stream_lock);
+	copies = _pending_copies(peer->sent_seq, &cnt, &max_seq);
+	slurm_mutex_unlock(&stream_lock);
+
+	for (i = 0; i < cnt; i++) {
+		if (rc == SLURM_SUCCESS) {
+			rc = _send_copy(peer->fd, &copies[i]);
+			if (rc != SLURM_SUCCESS) {
+				error("%s: sending %s to backup controller %d: %s",
+				      __func__, copies[i].name, inx,
+				      slurm_strerror(rc ? rc : errno));
+			} else {
+				debug3("%s: sent %s (%u bytes) to backup controller %d",
+				       __func__, copies[i].name,
+				       copies[i].size, inx);
+			}
+		}
+		xfree(copies[i].name);
+		xfree(copies[i].data);
+	}
+	xfree(copies);
+
+	if (rc != SLURM_SUCCESS) {
+		(void) close(peer->fd);
+		peer->fd = -1;
+		peer->next_try = now + STREAM_RETRY;
+		return false;
+	}
+	peer->sent_seq = max_seq;
+	return true;
+}
+
+static void *_stream_thread(void *no_data)
+{
+	/* Locks: Read config */
+	slurmctld_lock_t config_read_lock = { .conf = READ_LOCK };
+	stream_peer_t *peers;
+	struct timespec ts = {0, 0};
+	int peer_cnt, i;
+	bool pending, sent_all;
+
+	lock_slurmctld(config_read_lock);
+	peer_cnt = slurmctld_conf.control_cnt;
+	unlock_slurmctld(config_read_lock);
+
+	peers = xcalloc(peer_cnt, sizeof(stream_peer_t));
+	for (i = 0; i < peer_cnt; i++)
+		peers[i].fd = -1;
+
+	slurm_mutex_lock(&stream_lock);
+	while (streaming) {
+		pending = false;
+		for (i = 0; i < peer_cnt; i++) {
+			if ((i != backup_inx) &&
+			    (peers[i].sent_seq < stream_seq))
+				pending = true;
+		}
+		if (!pending) {
+			slurm_cond_wait(&stream_cond, &stream_lock);
+			continue;
+		}
+		slurm_mutex_unlock(&stream_lock);
+
+		sent_all = true;
+		for (i = 0; i < peer_cnt; i++) {
+			if ((i != backup_inx) && !_send_peer(&peers[i], i))
+				sent_all = false;
+		}
+
+		slurm_mutex_lock(&stream_lock);
+		if (!sent_all && streaming) {
+			/* Try the backups that failed again later */
+			ts.tv_sec = time(NULL) + 1;
+			slurm_cond_timedwait(&stream_cond, &stream_lock, &ts);
+		}
+	}
+	_free_copies(&send_copies, &send_cnt);
+	slurm_mutex_unlock(&stream_lock);
+
+	for (i = 0; i < peer_cnt; i++) {
+		if (peers[i].fd >= 0)
+			(void) close(peers[i].fd);
+	}
+	xfree(peers);
+
+	return NULL;
+}
+
+extern void state_stream_start(void)
+{
+	slurm_mutex_lock(&recv_lock);
+	receiving = false;
+	_free_copies(&recv_copies, &recv_cnt);
+	slurm_mutex_unlock(&recv_lock);
+
+	if (slurmctld_conf.control_cnt < 2) {
+		debug("No backup controllers, not streaming state files.");
+		return;
+	}
+
+	slurm_mutex_lock(&stream_lock);
+	if (!streaming) {
+		streaming = true;
+		slurm_thread_create_detached(NULL, _stream_thread, NULL);
+	}
+	slurm_mutex_unlock(&stream_lock);
+}
+
+extern void state_stream_stop(void)
+{
+	slurm_mutex_lock(&stream_lock);
+	if (streaming) {
+		streaming = false;
+		slurm_cond_signal(&stream_cond);
+	}
+	slurm_mutex_unlock(&stream_lock);
+
+	slurm_mutex_lock(&recv_lock);
+	receiving = true;
+	slurm_mutex_unlock(&recv_lock);
+}
+
+extern void state_stream_queue(const char *state_file, Buf buffer)
+{
+	state_copy_t *copy;
+	struct stat stat_buf;
+	uint32_t size = get_buf_offset(buffer);
+
+	slurm_mutex_lock(&stream_lock);
+	if (!streaming) {
+		slurm_mutex_unlock(&stream_lock);
+		return;
+	}
+	/*
+	 * The backup only uses the copy if the file on disk is still this
+	 * one. Without its identity, leave the backup to read the file.
+	 */
+	if (stat(state_file, &stat_buf)) {
+		error("%s: stat(%s): %m", __func__, state_file);
+		slurm_mutex_unlock(&stream_lock);
+		return;
+	}
+	copy = _add_copy(&send_copies, &send_cnt, _base_name(state_file));
+	xfree(copy->data);
+	copy->data = xmalloc(size);
+	memcpy(copy->data, get_buf_data(buffer), size);
+	copy->size = size;
+	copy->write_time = stat_buf.st_mtim.tv_sec;
+	copy->write_nsec = stat_buf.st_mtim.tv_nsec;
+	copy->seq = ++stream_seq;
+	slurm_cond_signal(&stream_cond);
+	slurm_mutex_unlock(&stream_lock);
+}
+
+/* Keep the copy of a file sent by the primary */
+static int _recv_copy(slurm_msg_t *msg)
+{
+	state_stream_msg_t *stream_msg = msg->data;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+	state_copy_t *copy;
+
+	if (!validate_slurm_user(uid)) {
+		error("Security violation, REQUEST_STATE_STREAM from uid=%d",
+		      uid);
+		return ESLURM_USER_ID_MISSING;
+	}
+	if (!stream_msg->name || !stream_msg->size)
+		return SLURM_ERROR;
+
+	slurm_mutex_lock(&recv_lock);
+	if (!receiving) {
+		slurm_mutex_unlock(&recv_lock);
+		return ESLURM_DISABLED;
+	}
+	copy = _add_copy(&recv_copies, &recv_cnt, stream_msg->name);
+	xfree(copy->data);
+	copy->data = stream_msg->data;
+	stream_msg->data = NULL;
+	copy->size = stream_msg->size;
+	copy->write_time = stream_msg->write_time;
+	copy->write_nsec = stream_msg->write_nsec;
+	slurm_mutex_unlock(&recv_lock);
+
+	debug3("%s: received %s (%u bytes)", __func__, stream_msg->name,
+	       stream_msg->size);
+	return SLURM_SUCCESS;
+}
+
+/* RET true once the next message can be read from fd */
+static bool _wait_for_msg(int fd)
+{
+	struct pollfd pfd;
+	bool wait = true;
+	int rc;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (wait && !slurmctld_config.shutdown_time) {
+		if ((rc = poll(&pfd, 1, 1000)) > 0)
+			return true;
+		if ((rc < 0) && (errno != EINTR))
+			return false;
+		slurm_mutex_lock(&recv_lock);
+		wait = receiving;
+		slurm_mutex_unlock(&recv_lock);
+	}
+	return false;
+}
+
+static void *_recv_thread(void *arg)
+{
+	int fd = (int) (intptr_t) arg;
+	slurm_msg_t msg;
+	int rc;
+
+	while (_wait_for_msg(fd)) {
+		slurm_msg_t_init(&msg);
+		if (slurm_receive_msg(fd, &msg, 0)) {
+			slurm_free_msg_members(&msg);
+			break;
+		}
+		if (msg.msg_type == REQUEST_STATE_STREAM)
+			rc = _recv_copy(&msg);
+		else
+			rc = ESLURM_IN_STANDBY_MODE;
+		slurm_send_rc_msg(&msg, rc);
+		slurm_free_msg_members(&msg);
+		if (rc != SLURM_SUCCESS)
+			break;
+	}
+	(void) close(fd);
+
+	return NULL;
+}
+
+extern bool state_stream_accept(slurm_msg_t *msg)
+{
+	int rc = _recv_copy(msg);
+
+	slurm_send_rc_msg(msg, rc);
+	if (rc != SLURM_SUCCESS)
+		return false;
+	slurm_thread_create_detached(NULL, _recv_thread,
+				     (void *) (intptr_t) msg->conn_fd);
+	return true;
+}
+
+extern Buf state_stream_get(const char *state_file)
+{
+	const char *name = _base_name(state_file);
+	state_copy_t *copy;
+	struct stat stat_buf;
+	char *data;
+	Buf buffer = NULL;
+
+	slurm_mutex_lock(&recv_lock);
+	if (!(copy = _find_copy(recv_copies, recv_cnt, name)) ||
+	    !copy->data) {
+		slurm_mutex_unlock(&recv_lock);
+		return NULL;
+	}
+	/* Any file on disk but the one the copy was taken from wins */
+	if (stat(state_file, &stat_buf) ||
+	    (stat_buf.st_mtim.tv_sec != copy->write_time) ||
+	    (stat_buf.st_mtim.tv_nsec != copy->write_nsec) ||
+	    (stat_buf.st_size != copy->size)) {
+		info("%s does not match the copy sent by the primary controller",
+		     state_file);
+	} else {
+		data = xmalloc(copy->size);
+		memcpy(data, copy->data, copy->size);
+		buffer = create_buf(data, copy->size);
+		info("Recovering %s from the copy sent by the primary controller",
+		     name);
+	}
+	slurm_mutex_unlock(&recv_lock);
+
+	return buffer;
+}
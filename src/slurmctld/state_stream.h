@@ -0,0 +1,88 @@
+/*****************************************************************************\
+ *  state_stream.h - keep a copy of the state save files in the backup
+ *****************************************************************************
+ *  Copyright (C) 2019 SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+
+#ifndef _SLURMCTLD_STATE_STREAM_H
+#define _SLURMCTLD_STATE_STREAM_H
+
+#include <stdbool.h>
+
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_defs.h"
+
+/*
+ * The primary slurmctld sends each state save file it has written to every
+ * backup controller over a connection kept open for it. The backups keep
+ * the last copy of every file in memory and recover from it when taking
+ * over, rather than reading StateSaveLocation again. A copy is only used
+ * while the file on disk has the modification time (to the nanosecond)
+ * and size of the file it was taken from, otherwise (e.g. the primary
+ * wrote it but could not send it) the file is read from disk.
+ */
+
+/*
+ * Start sending state files to the backup controllers, run on the primary.
+ * Copies received while this controller was a backup are dropped.
+ */
+extern void state_stream_start(void);
+
+/* Stop sending state files, and accept them again as a backup */
+extern void state_stream_stop(void);
+
+/*
+ * Send a state save file that was just written to the backup controllers.
+ * Only the last copy of each file not yet sent is kept.
+ * Call with the state files locked, right after the file is renamed.
+ * IN state_file - path of the file written
+ * IN buffer - its contents
+ */
+extern void state_stream_queue(const char *state_file, Buf buffer);
+
+/*
+ * Handle a REQUEST_STATE_STREAM received by a backup controller. The
+ * connection is kept open for the following files.
+ * RET true if the connection is now owned by the state stream, false if
+ *	the caller must close it
+ */
+extern bool state_stream_accept(slurm_msg_t *msg);
+
+/*
+ * Return the copy of a state save file sent by the primary, or NULL if
+ * there is none or the file on disk is not the one it was taken from.
+ * IN state_file - path of the file to recover
+ */
+extern Buf state_stream_get(const char *state_file);
+
+#endif
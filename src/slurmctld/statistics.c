@@ -39,7 +39,9 @@
 #include <stdio.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
+#include "src/common/conn_cache.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
 #include "src/common/xstring.h"
@@ -56,6 +58,9 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	int agent_queue_size;
 	int agent_count;
 	int slurmdbd_queue_size;
+	buf_pool_stats_t buf_pool_stats;
+	rpc_compress_stats_t compress_stats;
+	conn_cache_stats_t conn_cache_stats;
 	time_t now = time(NULL);
 
 	buffer_ptr[0] = NULL;
@@ -137,6 +142,25 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_active, buffer);
 			pack32(slurmctld_diag_stats.backfilled_pack_jobs,
 			       buffer);
+
+			get_buf_pool_stats(&buf_pool_stats, false);
+			pack64(buf_pool_stats.hits, buffer);
+			pack64(buf_pool_stats.misses, buffer);
+			pack64(buf_pool_stats.returns, buffer);
+			pack64(buf_pool_stats.drops, buffer);
+			pack32(buf_pool_stats.cached, buffer);
+			pack32(buf_pool_stats.cached_max, buffer);
+
+			slurm_get_compress_stats(&compress_stats, false);
+			pack64(compress_stats.msg_cnt, buffer);
+			pack64(compress_stats.bytes_raw, buffer);
+			pack64(compress_stats.bytes_sent, buffer);
+
+			conn_cache_get_stats(&conn_cache_stats, false);
+			pack64(conn_cache_stats.opened, buffer);
+			pack64(conn_cache_stats.reused, buffer);
+			pack64(conn_cache_stats.reconnects, buffer);
+			pack32(conn_cache_stats.cached, buffer);
 		}
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		parts_packed = resp;
@@ -244,6 +268,10 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	get_buf_pool_stats(NULL, true);
+	slurm_get_compress_stats(NULL, true);
+	conn_cache_get_stats(NULL, true);
+	lock_stats_reset();
 
 	last_proc_req_start = time(NULL);
 }
@@ -43,7 +43,6 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <grp.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -60,8 +59,10 @@
 #include "src/common/xstring.h"
 
 #include "src/slurmctld/locks.h"
+#include "src/slurmctld/script_launcher.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
+#include "src/slurmctld/state_stream.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 #define MAX_PROG_TIME 300	/* maximum run time for program */
@@ -123,6 +124,9 @@ typedef struct trig_mgr_info {
 /* Prototype for ListDelF */
 void _trig_del(void *x) {
 	trig_mgr_info_t * tmp = (trig_mgr_info_t *) x;
+	/* Purged or cleared while its program still runs */
+	if (tmp->child_pid)
+		script_launcher_forget(tmp->child_pid);
 	xfree(tmp->res_id);
 	xfree(tmp->orig_res_id);
 	xfree(tmp->program);
@@ -891,6 +895,7 @@ extern int trigger_state_save(void)
 			       new_file, reg_file);
 		}
 		(void) unlink(new_file);
+		state_stream_queue(reg_file, buffer);
 	}
 	xfree(old_file);
 	xfree(reg_file);
@@ -910,6 +915,9 @@ static Buf _open_trigger_state_file(char **state_file)
 
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/trigger_state");
+
+	if ((buf = state_stream_get(*state_file)))
+		return buf;
 	if (!(buf = create_mmap_buf(*state_file)))
 		error("Could not open trigger state file %s: %m",
 		      *state_file);
@@ -1489,6 +1497,7 @@ static void _trigger_run_program(trig_mgr_info_t *trig_in)
 	uid_t uid;
 	gid_t gid;
 	pid_t child_pid;
+	script_launch_t launch;
 	int i;
 
 	if (!_validate_trigger(trig_in))
@@ -1521,34 +1530,18 @@ static void _trigger_run_program(trig_mgr_info_t *trig_in)
 	snprintf(user_name, sizeof(user_name), "%s", uname);
 	xfree(uname);
 
-	child_pid = fork();
-	if (child_pid > 0) {
+	memset(&launch, 0, sizeof(launch));
+	launch.path = program;
+	launch.argv = args;
+	launch.flags = SCRIPT_LAUNCH_SETSID | SCRIPT_LAUNCH_SET_USER;
+	launch.uid = uid;
+	launch.gid = gid;
+	launch.user_name = user_name;
+	child_pid = script_launcher_start(&launch);
+	if (child_pid > 0)
 		trig_in->child_pid = child_pid;
-	} else if (child_pid == 0) {
-		int i;
-		bool run_as_self = (uid == slurmctld_conf.slurm_user_id);
-
-		for (i = 0; i < 1024; i++)
-			(void) close(i);
-		setpgid(0, 0);
-		setsid();
-		if ((initgroups(user_name, gid) == -1) && !run_as_self) {
-			error("trigger: initgroups: %m");
-			exit(1);
-		}
-		if ((setgid(gid) == -1) && !run_as_self){
-			error("trigger: setgid: %m");
-			exit(1);
-		}
-		if ((setuid(uid) == -1) && !run_as_self) {
-			error("trigger: setuid: %m");
-			exit(1);
-		}
-		execv(program, args);
-		exit(1);
-	} else {
+	else
 		error("fork: %m");
-	}
 	xfree(program);
 	for (i = 0; i < 64; i++)
 		xfree(args[i]);
@@ -1675,8 +1668,9 @@ extern void trigger_process(void)
 			    MAX_PROG_TIME)) {
 			if (trig_in->child_pid != 0) {
 				killpg(trig_in->child_pid, SIGKILL);
-				rc = waitpid(trig_in->child_pid, &prog_stat,
-					     WNOHANG);
+				rc = script_launcher_waitpid(
+					trig_in->child_pid, &prog_stat,
+					WNOHANG);
 				if ((rc > 0) && prog_stat) {
 					info("trigger uid=%u type=%s:%s "
 					     "exit=%u:%u",
@@ -1703,7 +1697,8 @@ extern void trigger_process(void)
 		} else if (trig_in->state == 2) {
 			/* Elimiate zombie processes right away.
 			 * Purge trigger entry above MAX_PROG_TIME later */
-			rc = waitpid(trig_in->child_pid, &prog_stat, WNOHANG);
+			rc = script_launcher_waitpid(trig_in->child_pid,
+						     &prog_stat, WNOHANG);
 			if ((rc > 0) && prog_stat) {
 				info("trigger uid=%u type=%s:%s exit=%u:%u",
 				     trig_in->user_id,
@@ -188,6 +188,7 @@ static void _rpc_timelimit(slurm_msg_t *);
 static void _rpc_reattach_tasks(slurm_msg_t *);
 static void _rpc_suspend_job(slurm_msg_t *msg);
 static void _rpc_terminate_job(slurm_msg_t *);
+static void _rpc_agent_composite(slurm_msg_t *msg);
 static void _rpc_update_time(slurm_msg_t *);
 static void _rpc_shutdown(slurm_msg_t *msg);
 static void _rpc_reconfig(slurm_msg_t *msg);
@@ -450,6 +451,11 @@ slurmd_req(slurm_msg_t *msg)
 		debug2("Processing RPC: RESPONSE_MESSAGE_COMPOSITE");
 		msg_aggr_resp(msg);
 		break;
+	case REQUEST_AGENT_COMPOSITE:
+		debug2("Processing RPC: REQUEST_AGENT_COMPOSITE");
+		last_slurmctld_msg = time(NULL);
+		_rpc_agent_composite(msg);
+		break;
 	default:
 		error("slurmd_req: invalid request msg type %d",
 		      msg->msg_type);
@@ -3122,6 +3128,65 @@ _enforce_job_mem_limit(void)
 	xfree(job_mem_info_ptr);
 }
 
+/*
+ * Fold our own ping reply and the replies of the nodes we forwarded the
+ * ping to into one, so that the controller handles one reply per subtree.
+ * Nodes that failed to answer are left in ret_list on their own.
+ */
+static ping_tree_resp_msg_t *_fold_ping_replies(List ret_list,
+						ping_slurmd_resp_msg_t *ping_resp)
+{
+	ping_tree_resp_msg_t *ping_tree, *sub_tree;
+	ping_slurmd_resp_msg_t *sub_resp;
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	hostlist_t hl;
+	int size;
+
+	size = forward_resp_cnt(ret_list) + 1;
+	ping_tree = xmalloc(sizeof(ping_tree_resp_msg_t));
+	ping_tree->cpu_load = xcalloc(size, sizeof(uint32_t));
+	ping_tree->free_mem = xcalloc(size, sizeof(uint64_t));
+	ping_tree->cpu_load[0] = ping_resp->cpu_load;
+	ping_tree->free_mem[0] = ping_resp->free_mem;
+	ping_tree->node_cnt = 1;
+	hl = hostlist_create(conf->node_name);
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->type == RESPONSE_PING_SLURMD) {
+			sub_resp = ret_data_info->data;
+			hostlist_push_host(hl, ret_data_info->node_name);
+			ping_tree->cpu_load[ping_tree->node_cnt] =
+				sub_resp->cpu_load;
+			ping_tree->free_mem[ping_tree->node_cnt] =
+				sub_resp->free_mem;
+			ping_tree->node_cnt++;
+		} else if (ret_data_info->type == RESPONSE_PING_TREE) {
+			sub_tree = ret_data_info->data;
+			hostlist_push(hl, sub_tree->node_list);
+			memcpy(ping_tree->cpu_load + ping_tree->node_cnt,
+			       sub_tree->cpu_load,
+			       sub_tree->node_cnt * sizeof(uint32_t));
+			memcpy(ping_tree->free_mem + ping_tree->node_cnt,
+			       sub_tree->free_mem,
+			       sub_tree->node_cnt * sizeof(uint64_t));
+			ping_tree->node_cnt += sub_tree->node_cnt;
+		} else
+			continue;
+		list_delete_item(itr);
+	}
+	list_iterator_destroy(itr);
+
+	/* Hosts are not sorted, node_list must stay in array order */
+	ping_tree->node_list = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	debug2("%s: folded ping replies of %u nodes, %d left on their own",
+	       __func__, ping_tree->node_cnt, list_count(ret_list));
+
+	return ping_tree;
+}
+
 static int
 _rpc_ping(slurm_msg_t *msg)
 {
@@ -3156,13 +3221,24 @@ _rpc_ping(slurm_msg_t *msg)
 	} else {
 		slurm_msg_t resp_msg;
 		ping_slurmd_resp_msg_t ping_resp;
+		ping_tree_resp_msg_t *ping_tree = NULL;
 		get_cpu_load(&ping_resp.cpu_load);
 		get_free_mem(&ping_resp.free_mem);
 		slurm_msg_t_copy(&resp_msg, msg);
 		resp_msg.msg_type = RESPONSE_PING_SLURMD;
 		resp_msg.data     = &ping_resp;
 
+		if (resp_msg.forward_struct &&
+		    (msg->protocol_version >= SLURM_20_02_PROTOCOL_VERSION)) {
+			forward_wait(&resp_msg);
+			ping_tree = _fold_ping_replies(resp_msg.ret_list,
+						       &ping_resp);
+			resp_msg.msg_type = RESPONSE_PING_TREE;
+			resp_msg.data     = ping_tree;
+		}
+
 		slurm_send_node_msg(msg->conn_fd, &resp_msg);
+		slurm_free_ping_tree_resp(ping_tree);
 	}
 
 	/* Take this opportunity to enforce any job memory limits */
@@ -3977,6 +4053,152 @@ _rpc_timelimit(slurm_msg_t *msg)
 	_rpc_terminate_job(msg);
 }
 
+/* State shared by the parts of one REQUEST_AGENT_COMPOSITE */
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	List resp_list;		/* replies of the parts */
+	int running;		/* parts whose handler has not returned */
+	int refs;		/* running parts plus the dispatcher */
+} agent_comp_t;
+
+typedef struct {
+	agent_comp_t *comp;
+	slurm_msg_t *msg;
+} agent_comp_part_t;
+
+static void _agent_comp_release(agent_comp_t *comp)
+{
+	bool last;
+
+	slurm_mutex_lock(&comp->mutex);
+	last = (--comp->refs == 0);
+	slurm_mutex_unlock(&comp->mutex);
+	if (!last)
+		return;
+
+	FREE_NULL_LIST(comp->resp_list);
+	slurm_mutex_destroy(&comp->mutex);
+	slurm_cond_destroy(&comp->cond);
+	xfree(comp);
+}
+
+static void *_agent_comp_part(void *arg)
+{
+	agent_comp_part_t *part = arg;
+	agent_comp_t *comp = part->comp;
+	slurm_msg_t *msg = part->msg;
+
+	slurmd_req(msg);
+	if (msg->conn_fd >= 0)
+		(void) close(msg->conn_fd);
+	msg->ret_list = NULL;
+	slurm_free_comp_msg_list(msg);
+
+	slurm_mutex_lock(&comp->mutex);
+	comp->running--;
+	slurm_cond_signal(&comp->cond);
+	slurm_mutex_unlock(&comp->mutex);
+	_agent_comp_release(comp);
+	xfree(part);
+
+	return NULL;
+}
+
+/*
+ * Run each part of a REQUEST_AGENT_COMPOSITE as if it had come in a message
+ * of its own, and send the replies of all parts back at once. The parts
+ * reply through a shared ret_list rather than on the connection, so a part
+ * that goes on working once it has replied (as job termination does) keeps
+ * running after the composite reply is sent.
+ */
+static void _rpc_agent_composite(slurm_msg_t *msg)
+{
+	composite_msg_t *req = msg->data;
+	composite_msg_t resp;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+	agent_comp_t *comp;
+	agent_comp_part_t *part;
+	slurm_msg_t *part_msg, resp_msg;
+	struct timespec ts;
+	time_t deadline;
+	int cnt = 0;
+
+	if (!_slurm_authorized_user(uid)) {
+		error("Security violation: agent composite RPC from uid %d",
+		      uid);
+		slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+		return;
+	}
+
+	comp = xmalloc(sizeof(agent_comp_t));
+	slurm_mutex_init(&comp->mutex);
+	slurm_cond_init(&comp->cond, NULL);
+	comp->resp_list = list_create(slurm_free_comp_msg_list);
+	comp->refs = 1;
+
+	while ((part_msg = list_pop(req->msg_list))) {
+		cnt++;
+		part_msg->ret_list = comp->resp_list;
+		if ((part_msg->msg_type != REQUEST_TERMINATE_JOB)  &&
+		    (part_msg->msg_type != REQUEST_KILL_PREEMPTED) &&
+		    (part_msg->msg_type != REQUEST_KILL_TIMELIMIT)) {
+			error("%s: invalid part msg type %s", __func__,
+			      rpc_num2string(part_msg->msg_type));
+			slurm_send_rc_msg(part_msg, EINVAL);
+			part_msg->ret_list = NULL;
+			slurm_free_comp_msg_list(part_msg);
+			continue;
+		}
+		part_msg->auth_cred = g_slurm_auth_dup(msg->auth_cred);
+		part_msg->auth_index = msg->auth_index;
+		part_msg->address = msg->address;
+		part_msg->orig_addr = msg->orig_addr;
+		part_msg->conn_fd = dup(msg->conn_fd);
+
+		part = xmalloc(sizeof(agent_comp_part_t));
+		part->comp = comp;
+		part->msg = part_msg;
+		slurm_mutex_lock(&comp->mutex);
+		comp->refs++;
+		comp->running++;
+		slurm_mutex_unlock(&comp->mutex);
+		slurm_thread_create_detached(NULL, _agent_comp_part, part);
+	}
+
+	/*
+	 * Wait for every part to reply (or return without replying), leaving
+	 * slurmctld time to read our reply before its own timeout.
+	 */
+	deadline = time(NULL) + MAX(slurm_get_msg_timeout() / 2, 1);
+	slurm_mutex_lock(&comp->mutex);
+	while (comp->running && (list_count(comp->resp_list) < cnt) &&
+	       (time(NULL) < deadline)) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += 10 * 1000 * 1000;
+		if (ts.tv_nsec >= 1000 * 1000 * 1000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000 * 1000 * 1000;
+		}
+		slurm_cond_timedwait(&comp->cond, &comp->mutex, &ts);
+	}
+	resp.msg_list = list_create(slurm_free_comp_msg_list);
+	list_transfer(resp.msg_list, comp->resp_list);
+	slurm_mutex_unlock(&comp->mutex);
+
+	if (list_count(resp.msg_list) < cnt)
+		debug("%s: %d of %d parts replied in time", __func__,
+		      list_count(resp.msg_list), cnt);
+
+	slurm_msg_t_copy(&resp_msg, msg);
+	resp_msg.msg_type = RESPONSE_AGENT_COMPOSITE;
+	resp_msg.data = &resp;
+	slurm_send_node_msg(msg->conn_fd, &resp_msg);
+	FREE_NULL_LIST(resp.msg_list);
+
+	_agent_comp_release(comp);
+}
+
 static void  _rpc_pid2jid(slurm_msg_t *msg)
 {
 	job_id_request_msg_t *req = (job_id_request_msg_t *) msg->data;
@@ -53,6 +53,7 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <grp.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
 #include <stdlib.h>
@@ -60,6 +61,7 @@
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -68,6 +70,7 @@
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/bitstring.h"
+#include "src/common/conn_cache.h"
 #include "src/common/cpu_frequency.h"
 #include "src/common/daemonize.h"
 #include "src/common/fd.h"
@@ -124,6 +127,7 @@
 #endif
 
 #define MAX_THREADS		256
+#define MAX_IDLE_CONNS		8
 
 #define _free_and_set(__dst, __src) \
 	xfree(__dst); __dst = __src
@@ -145,11 +149,19 @@ static int             active_threads = 0;
 static pthread_mutex_t active_mutex   = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  active_cond    = PTHREAD_COND_INITIALIZER;
 
+/*
+ * count of connections kept open waiting for another request, these are
+ * not active threads until a request arrives
+ */
+static int             idle_conns     = 0;
+
 static pthread_mutex_t fork_mutex     = PTHREAD_MUTEX_INITIALIZER;
 
 typedef struct connection {
 	int fd;
 	slurm_addr_t *cli_addr;
+	bool idle;		/* wait for a request before servicing it */
+	conn_session_t *session; /* credential verified on this connection */
 } conn_t;
 
 /*
@@ -187,6 +199,7 @@ static uint64_t  _get_int(const char *my_str);
 static void      _handle_connection(int fd, slurm_addr_t *client);
 static void      _hup_handler(int);
 static void      _increment_thd_count(void);
+static bool      _keep_connection(conn_t *con, slurm_msg_t *msg);
 static void      _init_conf(void);
 static void      _install_fork_handlers(void);
 static bool      _is_core_spec_cray(void);
@@ -550,16 +563,117 @@ static void _handle_connection(int fd, slurm_addr_t *cli)
 	slurm_thread_create_detached(NULL, _service_connection, arg);
 }
 
+/*
+ * Hand a connection whose request asked for it to be kept open to a new
+ * thread that waits for the next request on it. The new thread starts
+ * waiting right away on its own descriptor, so the next request does not
+ * wait for work this request does after its reply is sent. The credential
+ * of msg goes with it, the sender may repeat it on the next request.
+ * RET true if the connection is kept, false if the caller closes it
+ */
+static bool _keep_connection(conn_t *con, slurm_msg_t *msg)
+{
+	conn_t *arg;
+	int fd;
+
+	slurm_mutex_lock(&active_mutex);
+	if (_shutdown || (idle_conns >= MAX_IDLE_CONNS)) {
+		slurm_mutex_unlock(&active_mutex);
+		return false;
+	}
+	idle_conns++;
+	slurm_mutex_unlock(&active_mutex);
+
+	if ((fd = dup(con->fd)) < 0) {
+		error("%s: dup: %m", __func__);
+		slurm_mutex_lock(&active_mutex);
+		idle_conns--;
+		slurm_mutex_unlock(&active_mutex);
+		return false;
+	}
+	fd_set_close_on_exec(fd);
+
+	arg = xmalloc(sizeof(conn_t));
+	arg->fd = fd;
+	arg->cli_addr = xmalloc(sizeof(slurm_addr_t));
+	memcpy(arg->cli_addr, con->cli_addr, sizeof(slurm_addr_t));
+	arg->idle = true;
+	/* As the sender, only start a session on requests not forwarded */
+	if (!msg->forward_struct &&
+	    (!con->session ||
+	     (g_slurm_auth_verify_session(msg->auth_cred, con->session->cred)
+	      != SLURM_SUCCESS))) {
+		arg->session = conn_session_create(
+			g_slurm_auth_dup(msg->auth_cred));
+	} else {
+		arg->session = con->session;
+		con->session = NULL;
+	}
+	slurm_thread_create_detached(NULL, _service_connection, arg);
+
+	return true;
+}
+
+/*
+ * Wait for another request on a kept connection. The controller drops
+ * idle connections after SlurmdTimeout, wait a little longer than that.
+ * RET true if a request is ready to read
+ */
+static bool _wait_for_request(int fd)
+{
+	struct pollfd pfd;
+	int timeout, rc;
+	char c;
+
+	timeout = conf->slurmd_timeout ? conf->slurmd_timeout : 300;
+	timeout += 2 * slurm_get_msg_timeout();
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while ((rc = poll(&pfd, 1, timeout * 1000)) < 0) {
+		if (errno != EINTR)
+			return false;
+	}
+	if ((rc == 0) || _shutdown)
+		return false;
+
+	/* The controller closing the connection also wakes us up */
+	return (recv(fd, &c, 1, MSG_PEEK) > 0);
+}
+
 static void *
 _service_connection(void *arg)
 {
 	conn_t *con = (conn_t *) arg;
-	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	slurm_msg_t *msg;
 	int rc = SLURM_SUCCESS;
 
+	if (con->idle) {
+		bool ready = _wait_for_request(con->fd);
+
+		slurm_mutex_lock(&active_mutex);
+		idle_conns--;
+		slurm_mutex_unlock(&active_mutex);
+		if (!ready) {
+			(void) close(con->fd);
+			conn_session_destroy(con->session);
+			xfree(con->cli_addr);
+			xfree(con);
+			return NULL;
+		}
+		if (!conn_session_valid(con->session)) {
+			conn_session_destroy(con->session);
+			con->session = NULL;
+		}
+		_increment_thd_count();
+	}
+
+	msg = xmalloc(sizeof(slurm_msg_t));
 	debug3("in the service_connection");
 	slurm_msg_t_init(msg);
-	if ((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr, msg, 0))
+	if ((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr, msg, 0,
+						con->session ?
+						con->session->cred : NULL))
 	   != SLURM_SUCCESS) {
 		error("service_connection: slurm_receive_msg: %m");
 		/*
@@ -572,6 +686,11 @@ _service_connection(void *arg)
 	}
 	debug2("Start processing RPC: %s", rpc_num2string(msg->msg_type));
 
+	/* The reply tells the sender whether we kept the connection */
+	if ((msg->flags & SLURM_MSG_KEEP_CONN) &&
+	    (!conn_cache_msg_type(msg->msg_type) || !_keep_connection(con, msg)))
+		msg->flags &= ~SLURM_MSG_KEEP_CONN;
+
 	if (msg->msg_type != MESSAGE_COMPOSITE)
 		slurmd_req(msg);
 
@@ -579,6 +698,7 @@ cleanup:
 	if ((msg->conn_fd >= 0) && close(msg->conn_fd) < 0)
 		error ("close(%d): %m", con->fd);
 
+	conn_session_destroy(con->session);
 	xfree(con->cli_addr);
 	xfree(con);
 	debug2("Finish processing RPC: %s", rpc_num2string(msg->msg_type));
@@ -0,0 +1,99 @@
+/* Benchmark of src/common/bitstring.c whole bitstring operations.
+ *
+ * Reports nanoseconds per call for bitstrings of 1k, 10k, 100k and 1M bits
+ * using the word kernels selected for this CPU. Run with SLURM_BITSTR_SCALAR
+ * set in the environment to measure the portable kernels for comparison.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <src/common/bitstring.h>
+
+/* Roughly the same amount of work for every bitstring size */
+#define BENCH_WORDS	(64 * 1024 * 1024)
+
+static volatile int64_t sink;
+
+static double _now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double) ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static void _fill(bitstr_t *b, bitoff_t nbits, unsigned int seed)
+{
+	bitoff_t i;
+
+	srand(seed);
+	for (i = 0; i < nbits; i++) {
+		if (rand() & 1)
+			bit_set(b, i);
+	}
+}
+
+static void _report(const char *op, bitoff_t nbits, int iters, double start)
+{
+	printf("%-14s %8"BITSTR_FMT" bits %10.1f ns/op\n",
+	       op, nbits, (_now() - start) / iters);
+}
+
+int
+main(int argc, char *argv[])
+{
+	bitoff_t sizes[] = { 1000, 10000, 100000, 1000000 };
+	int i, j, iters;
+	double start;
+
+	printf("bitstring kernels: %s\n", bit_simd_name());
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		bitoff_t nbits = sizes[i];
+		bitstr_t *b1 = bit_alloc(nbits);
+		bitstr_t *b2 = bit_alloc(nbits);
+		bitstr_t *b3 = bit_alloc(nbits);
+
+		_fill(b1, nbits, 1);
+		_fill(b2, nbits, 2);
+		bit_nset(b3, nbits / 2, nbits - 1);
+		iters = BENCH_WORDS / ((nbits + 63) / 64);
+
+		start = _now();
+		for (j = 0; j < iters; j++)
+			sink += bit_set_count(b1);
+		_report("bit_set_count", nbits, iters, start);
+
+		start = _now();
+		for (j = 0; j < iters; j++)
+			sink += bit_overlap(b1, b2);
+		_report("bit_overlap", nbits, iters, start);
+
+		start = _now();
+		for (j = 0; j < iters; j++)
+			sink += bit_super_set(b1, b2);
+		_report("bit_super_set", nbits, iters, start);
+
+		start = _now();
+		for (j = 0; j < iters; j++)
+			bit_and(b3, b1);
+		_report("bit_and", nbits, iters, start);
+
+		start = _now();
+		for (j = 0; j < iters; j++)
+			bit_or(b3, b2);
+		_report("bit_or", nbits, iters, start);
+
+		bit_clear_all(b3);
+		bit_set(b3, nbits - 1);
+		start = _now();
+		for (j = 0; j < iters; j++)
+			sink += bit_ffs(b3);
+		_report("bit_ffs", nbits, iters, start);
+
+		bit_free(b1);
+		bit_free(b2);
+		bit_free(b3);
+	}
+
+	return 0;
+}
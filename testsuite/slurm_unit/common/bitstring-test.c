@@ -1,6 +1,7 @@
 /* Test of src/bitstring.c 
  */
 #include <stdlib.h>
+#include <string.h>
 #include <src/common/bitstring.h>
 #include <sys/time.h>
 #include <testsuite/dejagnu.h>
@@ -24,6 +25,11 @@
 int
 main(int argc, char *argv[])
 {
+#ifdef BITSTR_SCALAR_TEST
+	/* Check the portable word kernels against the same results */
+	setenv("SLURM_BITSTR_SCALAR", "1", 1);
+	TEST(!strcmp(bit_simd_name(), "scalar"), "scalar word kernels");
+#endif
 	note("Testing static decl");
 	{
 		bitstr_t bit_decl(bs, 65);
@@ -207,6 +213,65 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing word kernels against bit_test");
+	{
+		bitoff_t sizes[] = { 1, 63, 64, 65, 255, 256, 257, 1000, 4099 };
+		int i;
+
+		note(bit_simd_name());
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			bitoff_t n = sizes[i], bit;
+			bitstr_t *bs = bit_alloc(n);
+			bitstr_t *bs2 = bit_alloc(n);
+			bitstr_t *bs3;
+			int32_t cnt = 0, cnt2 = 0;
+
+			for (bit = 0; bit < n; bit++) {
+				if ((bit % 3) == 0) {
+					bit_set(bs, bit);
+					cnt++;
+				}
+				if ((bit % 5) == 0) {
+					bit_set(bs2, bit);
+					if ((bit % 3) == 0)
+						cnt2++;
+				}
+			}
+			TEST(bit_set_count(bs) == cnt, "bit_set_count");
+			TEST(bit_overlap(bs, bs2) == cnt2, "bit_overlap");
+			TEST(bit_ffs(bs2) == 0, "bit_ffs");
+
+			bs3 = bit_copy(bs);
+			bit_and(bs3, bs2);
+			TEST(bit_set_count(bs3) == cnt2, "bit_and");
+			TEST(bit_super_set(bs3, bs), "bit_super_set");
+			TEST(bit_super_set(bs3, bs2), "bit_super_set");
+			TEST((n < 4) || !bit_super_set(bs, bs3),
+			     "bit_super_set");
+			bit_or(bs3, bs);
+			TEST(bit_equal(bs3, bs), "bit_or");
+			bit_and_not(bs3, bs2);
+			TEST(bit_set_count(bs3) == (cnt - cnt2), "bit_and_not");
+			TEST(bit_and_not_count(bs, bs2) == (cnt - cnt2),
+			     "bit_and_not_count");
+			TEST(bit_and3_count(bs, bs2, bs) == cnt2,
+			     "bit_and3_count");
+			TEST(bit_and3_count(bs, bs2, bs3) == 0,
+			     "bit_and3_count");
+			TEST(bit_overlap_any(bs, bs2), "bit_overlap_any");
+			TEST(!bit_overlap_any(bs3, bs2), "bit_overlap_any");
+
+			bit_clear_all(bs3);
+			TEST(bit_ffs(bs3) == -1, "bit_ffs");
+			bit_set(bs3, n - 1);
+			TEST(bit_ffs(bs3) == (n - 1), "bit_ffs");
+
+			bit_free(bs);
+			bit_free(bs2);
+			bit_free(bs3);
+		}
+	}
+
 	totals();
 	return failed;
 }
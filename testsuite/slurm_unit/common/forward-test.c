@@ -0,0 +1,206 @@
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "src/common/forward.h"
+#include "src/common/hostlist.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/read_config.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/slurm_route.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* dejagnu.h has a wait() of its own, which clashes with <sys/wait.h> */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst)				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+#define NODES "n[1-16]"
+
+/* A local port nothing listens on, so that every send fails at once */
+static int _closed_port(void)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int fd, port;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+	getsockname(fd, (struct sockaddr *) &addr, &len);
+	port = ntohs(addr.sin_port);
+	close(fd);
+	return port;
+}
+
+/*
+ * Write a slurm.conf using route/topology with two leaf switches of eight
+ * nodes, all of them unreachable
+ */
+static void _write_conf(char *dir)
+{
+	char *file = NULL, *plugin_dir = NULL;
+	FILE *fp;
+
+	xstrfmtcat(plugin_dir,
+		   "%s/src/plugins/auth/none/.libs:"
+		   "%s/src/plugins/route/topology/.libs:"
+		   "%s/src/plugins/select/linear/.libs:"
+		   "%s/src/plugins/topology/tree/.libs",
+		   TOP_BUILDDIR, TOP_BUILDDIR, TOP_BUILDDIR, TOP_BUILDDIR);
+
+	xstrfmtcat(file, "%s/slurm.conf", dir);
+	fp = fopen(file, "w");
+	fprintf(fp, "ClusterName=test\n"
+		"SlurmctldHost=localhost\n"
+		"AuthType=auth/none\n"
+		"PluginDir=%s\n"
+		"RoutePlugin=route/topology\n"
+		"SelectType=select/linear\n"
+		"TopologyPlugin=topology/tree\n"
+		"TreeWidth=2\n"
+		"MessageTimeout=1\n"
+		"SlurmdPort=%d\n"
+		"NodeName=%s NodeAddr=127.0.0.[1-16]\n",
+		plugin_dir, _closed_port(), NODES);
+	fclose(fp);
+	setenv("SLURM_CONF", file, 1);
+	xfree(file);
+
+	xstrfmtcat(file, "%s/topology.conf", dir);
+	fp = fopen(file, "w");
+	fprintf(fp, "SwitchName=s1 Nodes=n[1-8]\n"
+		"SwitchName=s2 Nodes=n[9-16]\n"
+		"SwitchName=top Switches=s[1-2]\n");
+	fclose(fp);
+	xfree(file);
+	xfree(plugin_dir);
+}
+
+static void _remove_conf(char *dir)
+{
+	char *file = NULL;
+
+	xstrfmtcat(file, "%s/slurm.conf", dir);
+	unlink(file);
+	xfree(file);
+	xstrfmtcat(file, "%s/topology.conf", dir);
+	unlink(file);
+	xfree(file);
+	rmdir(dir);
+}
+
+/* Check that hl was emptied into sublists holding each node once */
+static void _test_split(hostlist_t hl, char *msg)
+{
+	hostlist_t all = hostlist_create(NULL), *sp_hl = NULL;
+	int i, count = 0, nodes = hostlist_count(hl), rc;
+	char *str;
+
+	rc = route_g_split_hostlist(hl, &sp_hl, &count, 0);
+	TEST(rc != SLURM_SUCCESS, msg);
+	TEST(hostlist_count(hl) != 0, "split empties the hostlist");
+	for (i = 0; i < count; i++) {
+		hostlist_push_list(all, sp_hl[i]);
+		hostlist_destroy(sp_hl[i]);
+	}
+	xfree(sp_hl);
+	hostlist_uniq(all);
+	str = hostlist_ranged_string_xmalloc(all);
+	TEST((hostlist_count(all) != nodes) || xstrcmp(str, NODES),
+	     "split holds every node once");
+	xfree(str);
+	hostlist_destroy(all);
+}
+
+/*
+ * Send to nodes that all refuse the connection, so that the head of every
+ * subtree fails and the rest of it is sent to through new forwarders.
+ * Each node must be reported exactly once.
+ */
+static void _test_reroute(char *msg)
+{
+	hostlist_t hl = hostlist_create(NODES), seen = hostlist_create(NULL);
+	slurm_msg_t req;
+	ret_data_info_t *ret_data_info;
+	ListIterator itr;
+	List ret_list;
+	int failed_cnt = 0;
+	char *str;
+
+	slurm_msg_t_init(&req);
+	req.msg_type = REQUEST_PING;
+	req.protocol_version = SLURM_PROTOCOL_VERSION;
+	ret_list = start_msg_tree(hl, &req, 2000);
+	TEST(!ret_list, msg);
+	if (ret_list) {
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			hostlist_push_host(seen, ret_data_info->node_name);
+			if (ret_data_info->type == RESPONSE_FORWARD_FAILED)
+				failed_cnt++;
+		}
+		list_iterator_destroy(itr);
+		TEST(list_count(ret_list) != 16, "one response per node");
+		TEST(failed_cnt != 16, "every node failed");
+		hostlist_uniq(seen);
+		str = hostlist_ranged_string_xmalloc(seen);
+		TEST(xstrcmp(str, NODES), "each node responded once");
+		xfree(str);
+		FREE_NULL_LIST(ret_list);
+	}
+	hostlist_destroy(seen);
+	hostlist_destroy(hl);
+}
+
+int main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+	char dir[] = "/tmp/forward-test.XXXXXX";
+	hostlist_t hl;
+
+	/* Failed sends are expected, keep their errors out of the output */
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("forward-test", log_opts, 0, NULL);
+
+	if (!mkdtemp(dir)) {
+		fail("mkdtemp");
+		totals();
+		return 1;
+	}
+	_write_conf(dir);
+	slurm_conf_init(NULL);
+
+	hl = hostlist_create(NODES);
+	_test_split(hl, "split by leaf switch");
+	hostlist_destroy(hl);
+	hl = hostlist_create(NODES);
+	_test_split(hl, "split found in cache");
+	hostlist_destroy(hl);
+
+	_test_reroute("reroute after failed subtree heads");
+	_test_reroute("reroute with cached splits");
+
+	route_fini();
+	_remove_conf(dir);
+
+	totals();
+	return failed;
+}
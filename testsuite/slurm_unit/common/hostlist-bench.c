@@ -0,0 +1,132 @@
+/* Benchmark of src/common/hostlist.c on large host lists.
+ *
+ * Reports the time taken by hostlist create, push, sort, uniq, find,
+ * ranged string and hostset insert on lists of 1k, 10k and 100k hosts.
+ * Hosts are pushed one at a time in a scattered order with every tenth
+ * host missing, which is how bitmap2node_name() sees a fragmented
+ * allocation on a large cluster.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <src/common/hostlist.h>
+#include <src/common/macros.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+static volatile long sink;
+
+static double _now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double) ts.tv_sec * 1e3) + (ts.tv_nsec / 1e6);
+}
+
+static void _report(const char *op, int nhosts, double start)
+{
+	printf("%-22s %7d hosts %10.2f ms\n", op, nhosts, _now() - start);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int sizes[] = { 1000, 10000, 100000 };
+	int i, j, k, nhosts, *order;
+	char host[64], *str;
+	hostlist_t hl, hl2;
+	hostset_t hs;
+	double start;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		nhosts = sizes[i];
+
+		/* Stride through the node table so pushes arrive unsorted */
+		order = malloc(sizeof(int) * nhosts);
+		for (j = 0, k = 0; j < nhosts; j++) {
+			order[j] = k;
+			k = (k + 7919) % nhosts;
+		}
+
+		/* Single ranges are limited in size, build one per 10k hosts */
+		str = NULL;
+		for (j = 0; j < nhosts; j += 10000) {
+			xstrfmtcat(str, "%snode[%06d-%06d]", str ? "," : "",
+				   j, MIN(j + 10000, nhosts) - 1);
+		}
+		start = _now();
+		hl = hostlist_create(str);
+		_report("hostlist_create", nhosts, start);
+		if (hostlist_count(hl) != nhosts) {
+			printf("hostlist_create count mismatch %d != %d\n",
+			       hostlist_count(hl), nhosts);
+			exit(1);
+		}
+		hostlist_destroy(hl);
+		xfree(str);
+
+		start = _now();
+		hl = hostlist_create(NULL);
+		for (j = 0; j < nhosts; j++) {
+			if ((order[j] % 10) == 9)
+				continue;
+			snprintf(host, sizeof(host), "node%06d", order[j]);
+			hostlist_push_host(hl, host);
+		}
+		_report("hostlist_push_host", nhosts, start);
+
+		hl2 = hostlist_copy(hl);
+		start = _now();
+		hostlist_sort(hl);
+		_report("hostlist_sort", nhosts, start);
+
+		start = _now();
+		hostlist_sort(hl);
+		_report("hostlist_sort (sorted)", nhosts, start);
+
+		/* Every host twice, unsorted */
+		hostlist_push_list(hl2, hl);
+		start = _now();
+		hostlist_uniq(hl2);
+		_report("hostlist_uniq", nhosts, start);
+		if (hostlist_count(hl2) != hostlist_count(hl)) {
+			printf("hostlist_uniq count mismatch %d != %d\n",
+			       hostlist_count(hl2), hostlist_count(hl));
+			exit(1);
+		}
+		hostlist_destroy(hl2);
+
+		start = _now();
+		for (j = 0; j < 1000; j++) {
+			snprintf(host, sizeof(host), "node%06d",
+				 order[j % nhosts]);
+			sink += hostlist_find(hl, host);
+		}
+		_report("hostlist_find x1000", nhosts, start);
+
+		start = _now();
+		str = hostlist_ranged_string_xmalloc(hl);
+		_report("hostlist_ranged_string", nhosts, start);
+		hostlist_destroy(hl);
+
+		start = _now();
+		hs = hostset_create(NULL);
+		for (j = 0; j < nhosts; j++) {
+			snprintf(host, sizeof(host), "node%06d", order[j]);
+			hostset_insert(hs, host);
+		}
+		_report("hostset_insert", nhosts, start);
+		if (hostset_count(hs) != nhosts) {
+			printf("hostset_insert count mismatch %d != %d\n",
+			       hostset_count(hs), nhosts);
+			exit(1);
+		}
+		hostset_destroy(hs);
+
+		xfree(str);
+		free(order);
+	}
+
+	return 0;
+}
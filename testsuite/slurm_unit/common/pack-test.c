@@ -29,6 +29,7 @@ int main (int argc, char *argv[])
 	int data_size;
 	long double test_double = 1340664754944.2132312, test_double2;
 	uint64_t test64;
+	buf_pool_stats_t pool_stats;
 
 	buffer = init_buf (0);
         pack16(test16, buffer);
@@ -83,6 +84,26 @@ int main (int argc, char *argv[])
 	xfree(outstring);
 
 	free_buf(buffer);
+
+	/* A pooled buffer must come back with the requested size, zeroed */
+	get_buf_pool_stats(NULL, true);
+	buffer = init_buf(BUF_SIZE);
+	memset(get_buf_data(buffer), 0xff, BUF_SIZE);
+	free_buf(buffer);
+	buffer = init_buf(BUF_SIZE);
+	TEST(size_buf(buffer) != BUF_SIZE, "pooled buffer size");
+	for (byte_cnt = 0; byte_cnt < BUF_SIZE; byte_cnt++) {
+		if (get_buf_data(buffer)[byte_cnt])
+			break;
+	}
+	TEST(byte_cnt != BUF_SIZE, "pooled buffer zeroed");
+	free_buf(buffer);
+
+	get_buf_pool_stats(&pool_stats, false);
+	TEST(pool_stats.hits < 1, "buffer pool hit");
+	TEST(pool_stats.returns != 2, "buffer pool return");
+	TEST(pool_stats.cached != 1, "buffer pool cached");
+
 	totals();
 	return failed;
 
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "src/common/pack.h"
+#include "src/common/parse_config.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst)				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+static int _parse_item(void **dest, slurm_parser_enum_t type,
+		       const char *key, const char *value,
+		       const char *line, char **leftover)
+{
+	*dest = xstrdup(value);
+	return 1;
+}
+
+static void _destroy_item(void *ptr)
+{
+	xfree(ptr);
+}
+
+static void _pack_item(const char *key, void *data, Buf buffer)
+{
+	packstr(data, buffer);
+}
+
+static int _unpack_item(const char *key, void **data, Buf buffer)
+{
+	uint32_t uint32_tmp;
+
+	safe_unpackstr_xmalloc((char **) data, &uint32_tmp, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	return SLURM_ERROR;
+}
+
+static s_p_options_t options[] = {
+	{"Name", S_P_STRING},
+	{"Count", S_P_UINT16},
+	{"Size", S_P_UINT32},
+	{"Big", S_P_UINT64},
+	{"Delta", S_P_LONG},
+	{"Flag", S_P_BOOLEAN},
+	{"Ratio", S_P_DOUBLE},
+	{"Unset", S_P_STRING},
+	{"Alias", S_P_ARRAY},
+	{"Item", S_P_ARRAY, _parse_item, _destroy_item},
+	{NULL}
+};
+
+static char conf[] =
+	"Name=cluster\n"
+	"Count=7\n"
+	"Size=42\n"
+	"Big=12345678901\n"
+	"Delta=-3\n"
+	"Flag=yes\n"
+	"Ratio=0.5\n"
+	"Alias=x\n"
+	"Item=a\n"
+	"Item=b\n";
+
+int main(int argc, char *argv[])
+{
+	char file[] = "/tmp/parse-config-test.XXXXXX";
+	s_p_hashtbl_t *hashtbl, *copy;
+	uint32_t hash_val = 0, len, size;
+	uint64_t big;
+	uint16_t count;
+	long delta;
+	bool flag;
+	double ratio;
+	char *str = NULL;
+	void **items;
+	int fd, cnt, rc;
+	Buf buffer;
+
+	if ((fd = mkstemp(file)) < 0) {
+		fail("mkstemp");
+		totals();
+		return 1;
+	}
+	if (write(fd, conf, strlen(conf)) != strlen(conf))
+		fail("write");
+	close(fd);
+
+	hashtbl = s_p_hashtbl_create(options);
+	TEST(s_p_parse_file(hashtbl, &hash_val, file, false) != SLURM_SUCCESS,
+	     "parse file");
+	unlink(file);
+
+	buffer = init_buf(0);
+	TEST(s_p_pack_values(hashtbl, _pack_item, buffer) != SLURM_SUCCESS,
+	     "s_p_pack_values");
+	len = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+
+	copy = s_p_hashtbl_create(options);
+	rc = s_p_unpack_values(copy, _unpack_item, buffer);
+	TEST(rc != SLURM_SUCCESS, "s_p_unpack_values");
+	TEST(get_buf_offset(buffer) != len, "whole buffer unpacked");
+
+	TEST(!s_p_get_string(&str, "Name", copy) || xstrcmp(str, "cluster"),
+	     "string round trip");
+	xfree(str);
+	TEST(!s_p_get_uint16(&count, "Count", copy) || (count != 7),
+	     "uint16 round trip");
+	TEST(!s_p_get_uint32(&size, "Size", copy) || (size != 42),
+	     "uint32 round trip");
+	TEST(!s_p_get_uint64(&big, "Big", copy) || (big != 12345678901ULL),
+	     "uint64 round trip");
+	TEST(!s_p_get_long(&delta, "Delta", copy) || (delta != -3),
+	     "long round trip");
+	TEST(!s_p_get_boolean(&flag, "Flag", copy) || !flag,
+	     "boolean round trip");
+	TEST(!s_p_get_double(&ratio, "Ratio", copy) || (ratio != 0.5),
+	     "double round trip");
+	TEST(s_p_get_string(&str, "Unset", copy), "unset value stays unset");
+	xfree(str);
+	TEST(!s_p_get_array(&items, &cnt, "Alias", copy) || (cnt != 1) ||
+	     xstrcmp(items[0], "x"), "array round trip");
+	TEST(!s_p_get_array(&items, &cnt, "Item", copy) || (cnt != 2) ||
+	     xstrcmp(items[0], "a") || xstrcmp(items[1], "b"),
+	     "handler array round trip");
+	s_p_hashtbl_destroy(copy);
+
+	/* The values can only be unpacked into an empty table */
+	set_buf_offset(buffer, 0);
+	TEST(s_p_unpack_values(hashtbl, _unpack_item, buffer) == SLURM_SUCCESS,
+	     "unpack into a table with values fails");
+
+	/* A truncated buffer is an error, not a partial configuration */
+	set_buf_offset(buffer, 0);
+	buffer->size = 20;
+	copy = s_p_hashtbl_create(options);
+	TEST(s_p_unpack_values(copy, _unpack_item, buffer) == SLURM_SUCCESS,
+	     "truncated buffer fails");
+	s_p_hashtbl_destroy(copy);
+
+	free_buf(buffer);
+	s_p_hashtbl_destroy(hashtbl);
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,164 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Built in, to look at the records kept for the scripts */
+#include "src/slurmctld/script_launcher.c"
+
+/* dejagnu.h has a wait() of its own, which clashes with <sys/wait.h> */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {			\
+	if (_tst)				\
+		fail( _msg );       \
+	else					\
+		pass( _msg );       \
+} while (0)
+
+#define SCRIPT_CNT 32
+
+static pid_t _start(char *cmd, char **env)
+{
+	char *argv[] = { "/bin/sh", "-c", cmd, NULL };
+	script_launch_t launch;
+
+	memset(&launch, 0, sizeof(launch));
+	launch.path = argv[0];
+	launch.argv = argv;
+	launch.env = env;
+	launch.flags = SCRIPT_LAUNCH_NULL_STDIO;
+	return script_launcher_start(&launch);
+}
+
+/* RET exit code of cmd, -1 if it did not exit */
+static int _run(char *cmd, char **env)
+{
+	pid_t pid = _start(cmd, env);
+	int status = 0;
+
+	if ((pid <= 0) || (script_launcher_waitpid(pid, &status, 0) != pid) ||
+	    !WIFEXITED(status))
+		return -1;
+	return WEXITSTATUS(status);
+}
+
+static int _record_cnt(void)
+{
+	int cnt;
+
+	slurm_mutex_lock(&launch_mutex);
+	cnt = launch_list ? list_count(launch_list) : 0;
+	slurm_mutex_unlock(&launch_mutex);
+	return cnt;
+}
+
+/* Wait up to 10 seconds for the helper to report on every script */
+static int _wait_records(int cnt)
+{
+	int i;
+
+	for (i = 0; (i < 1000) && (_record_cnt() != cnt); i++)
+		usleep(10000);
+	return _record_cnt();
+}
+
+static void _test_scripts(char *msg)
+{
+	char *env[] = { "TEST_VAR=value", NULL };
+	char *empty_env[] = { NULL };
+	pid_t pids[SCRIPT_CNT], pid;
+	int i, status = 0, bad = 0;
+
+	TEST(_run("exit 3", NULL) != 3, msg);
+	TEST(_run("test \"$TEST_VAR\" = value", env) != 0,
+	     "environment is passed");
+	TEST(_run("test -z \"$TEST_VAR\"", empty_env) != 0,
+	     "empty environment is passed");
+	TEST(_run("exec /nonexistent", NULL) != 127,
+	     "failed exec exit code");
+
+	pid = _start("exec sleep 30", NULL);
+	TEST((pid <= 0) || (script_launcher_waitpid(pid, &status, WNOHANG)),
+	     "WNOHANG while the script runs");
+	kill(pid, SIGKILL);
+	TEST((script_launcher_waitpid(pid, &status, 0) != pid) ||
+	     !WIFSIGNALED(status) || (WTERMSIG(status) != SIGKILL),
+	     "killed script status");
+
+	for (i = 0; i < SCRIPT_CNT; i++)
+		pids[i] = _start("exit 5", NULL);
+	for (i = SCRIPT_CNT - 1; i >= 0; i--) {
+		if ((pids[i] <= 0) ||
+		    (script_launcher_waitpid(pids[i], &status, 0) != pids[i]) ||
+		    !WIFEXITED(status) || (WEXITSTATUS(status) != 5))
+			bad++;
+	}
+	TEST(bad, "concurrent scripts");
+	TEST(_record_cnt(), "waited scripts leave no record");
+}
+
+/* Scripts nobody waits for must not be kept */
+static void _test_forget(void)
+{
+	pid_t pid;
+
+	pid = _start("sleep 0.2", NULL);
+	script_launcher_forget(pid);
+	TEST(_wait_records(0), "forget a running script");
+
+	pid = _start("exit 0", NULL);
+	slurm_mutex_lock(&launch_mutex);
+	while (!((launch_rec_t *) list_peek(launch_list))->exited)
+		slurm_cond_wait(&launch_cond, &launch_mutex);
+	slurm_mutex_unlock(&launch_mutex);
+	script_launcher_forget(pid);
+	TEST(_record_cnt(), "forget an ended script");
+
+	/* A pid not started by the launcher is ignored */
+	script_launcher_forget(getpid());
+}
+
+int main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+	int status = 0;
+	pid_t pid;
+
+	/* The helper ending is expected, keep its error out of the output */
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("script-launcher-test", log_opts, 0, NULL);
+
+	/* Without the helper, scripts are forked from this process */
+	_test_scripts("exit code without helper");
+
+	script_launcher_init();
+	TEST(!helper_running, "helper started");
+	_test_scripts("exit code from helper");
+	_test_forget();
+
+	/* Scripts still running when the helper ends are failed */
+	pid = _start("exec sleep 30", NULL);
+	kill(helper_pid, SIGKILL);
+	slurm_mutex_lock(&launch_mutex);
+	while (helper_running)
+		slurm_cond_wait(&launch_cond, &launch_mutex);
+	slurm_mutex_unlock(&launch_mutex);
+	TEST((script_launcher_waitpid(pid, &status, WNOHANG) != pid) ||
+	     !WIFEXITED(status) || (WEXITSTATUS(status) != 127),
+	     "helper gone fails running scripts");
+	kill(pid, SIGKILL);
+	_test_scripts("exit code after helper ended");
+
+	script_launcher_fini();
+	TEST(launch_list, "records freed");
+
+	totals();
+	return failed;
+}